@@ -1,3 +1,6 @@
+# RTX stages and subgroup operations need SPIR-V 1.3+; the device requires Vulkan 1.3 anyway
+set(VOX_SHADER_FLAGS "-V" "--target-env" "vulkan1.2")
+
 # Utility function to compile GLSL -> SPIR-V and expose the generated .spv files
 # Usage: compile_shaders(<out-dir> <src-dir> <shader1> <shader2> ...)
 function(compile_shaders OUT_DIR SRC_DIR)
@@ -12,16 +15,10 @@ function(compile_shaders OUT_DIR SRC_DIR)
     set(in ${SRC_DIR}/${shader})
     # keep original shader filename (triangle.vert -> triangle.vert.spv)
     set(out ${OUT_DIR}/${shader}.spv)
-    
-    # Determine if this is an RTX shader and add appropriate flags
-    set(shader_flags "-V")
-    if(shader MATCHES "\\.(rgen|rchit|rmiss|rint|rahit)$")
-      set(shader_flags "-V" "--target-env" "vulkan1.2")
-    endif()
-    
+
     add_custom_command(
       OUTPUT ${out}
-      COMMAND ${GLSLANG_VALIDATOR} ${shader_flags} ${in} -o ${out}
+      COMMAND ${GLSLANG_VALIDATOR} ${VOX_SHADER_FLAGS} ${in} -o ${out}
       DEPENDS ${in}
       COMMENT "Compiling ${shader} to SPIR-V"
     )
@@ -30,4 +27,21 @@ function(compile_shaders OUT_DIR SRC_DIR)
 
   add_custom_target(Shaders ALL DEPENDS ${spv_files})
   set(COMPILED_SHADER_SPVS ${spv_files} PARENT_SCOPE)
-endfunction()
\ No newline at end of file
+endfunction()
+
+# One ctest per shader compiling it with the flags above, so builds without
+# the viewer (and CI) still catch shader errors
+# Usage: add_shader_tests(<src-dir> <shader1> <shader2> ...)
+function(add_shader_tests SRC_DIR)
+  find_program(GLSLANG_VALIDATOR glslangValidator)
+  if (NOT GLSLANG_VALIDATOR)
+    message(STATUS "glslangValidator not found: shader compile tests skipped")
+    return()
+  endif()
+
+  foreach(shader IN LISTS ARGN)
+    add_test(NAME Shader.${shader}
+             COMMAND ${GLSLANG_VALIDATOR} ${VOX_SHADER_FLAGS} ${SRC_DIR}/${shader}
+                     -o ${CMAKE_CURRENT_BINARY_DIR}/${shader}.spv)
+  endforeach()
+endfunction()
@@ -3,6 +3,7 @@
 #include "vox/Window.h"
 #include "vox/VulkanRenderer.h"
 #include <memory>
+#include <string>
 
 namespace vox {
 
@@ -14,6 +15,14 @@ public:
     bool init();
     int run();
 
+    // GPU image check: draws scenePath in each node encoding (dense, sparse,
+    // bricks) from the reference view and diffs the frame against
+    // CpuRenderer. 0 when at most maxDiffPercent of the pixels differ by
+    // more than the tolerance in every encoding, kSkipped when there is no
+    // window or Vulkan device to draw with.
+    int compareWithCpuReference(const std::string& scenePath, float maxDiffPercent);
+    static constexpr int kSkipped = 77; // ctest SKIP_RETURN_CODE
+
 private:
     Window m_window;
     std::unique_ptr<VulkanRenderer> m_renderer;
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace vox {
+
+// Flat open-addressing map from packed color to palette index (linear
+// probing, power-of-two capacity, load factor <= 1/2). Scenes have few
+// distinct colors, so the whole table usually stays in L1 while every
+// voxel of a load probes it.
+class ColorTable {
+public:
+    static constexpr uint32_t kNotFound = ~0u;
+
+    void clear() {
+        m_slots.clear();
+        m_count = 0;
+    }
+
+    size_t size() const { return m_count; }
+    size_t memoryBytes() const { return m_slots.capacity() * sizeof(Slot); }
+
+    void reserve(size_t count) {
+        size_t capacity = 16;
+        while (capacity < count * 2) capacity <<= 1;
+        if (capacity > m_slots.size()) rehash(capacity);
+    }
+
+    uint32_t find(uint32_t color) const {
+        if (m_slots.empty()) return kNotFound;
+        const size_t mask = m_slots.size() - 1;
+        for (size_t i = slotOf(color, mask);; i = (i + 1) & mask) {
+            const Slot& s = m_slots[i];
+            if (s.index == kNotFound || s.color == color) return s.index;
+        }
+    }
+
+    // Index stored for color; inserts index when the color is new
+    uint32_t findOrInsert(uint32_t color, uint32_t index) {
+        if ((m_count + 1) * 2 > m_slots.size()) rehash(m_slots.empty() ? 16 : m_slots.size() * 2);
+        const size_t mask = m_slots.size() - 1;
+        for (size_t i = slotOf(color, mask);; i = (i + 1) & mask) {
+            Slot& s = m_slots[i];
+            if (s.index == kNotFound) {
+                s.color = color;
+                s.index = index;
+                ++m_count;
+                return index;
+            }
+            if (s.color == color) return s.index;
+        }
+    }
+
+private:
+    struct Slot {
+        uint32_t color;
+        uint32_t index; // kNotFound marks an empty slot
+    };
+    std::vector<Slot> m_slots;
+    size_t m_count = 0;
+
+    static size_t slotOf(uint32_t color, size_t mask) {
+        uint32_t h = color * 0x9E3779B1u;
+        return (h ^ (h >> 15)) & mask;
+    }
+
+    void rehash(size_t capacity) {
+        std::vector<Slot> old(capacity, Slot{0, kNotFound});
+        old.swap(m_slots);
+        const size_t mask = capacity - 1;
+        for (const Slot& s : old) {
+            if (s.index == kNotFound) continue;
+            size_t i = slotOf(s.color, mask);
+            while (m_slots[i].index != kNotFound) i = (i + 1) & mask;
+            m_slots[i] = s;
+        }
+    }
+};
+
+} // namespace vox
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "vox/ShaderParams.h"
+#include <cstdint>
+#include <vector>
+
+namespace vox {
+
+class SparseVoxelOctree;
+class ThreadPool;
+
+// 8-bit RGB, rows top to bottom in the GPU storage image's order
+struct CpuImage {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> rgb;
+};
+
+// Pixels of two images whose largest channel difference exceeds a
+// tolerance (GPU frames against the reference, vox --compare-gpu)
+struct ImageDiff {
+    uint64_t pixels = 0;    // 0 when the sizes differ
+    uint64_t differing = 0;
+    uint32_t maxDelta = 0;  // largest channel difference seen
+};
+
+ImageDiff diffImages(const CpuImage& a, const CpuImage& b, uint32_t tolerance);
+
+// Headless reference renderer: the compute shader's primary-ray shading
+// (camera, key/fill/ambient light, spatial light grid, emissive self
+// lighting, debug modes 1-4) evaluated on the CPU from the same ShaderParams
+// and push constants. Rays are exact (OctreePacketTracer), without the GPU's
+// distance LOD and DDA epsilons, so the output is the golden image that
+// traversal changes are diffed against. Grid overlays (debugMask bits 0-1)
+// are not drawn.
+class CpuRenderer {
+public:
+    static constexpr uint32_t kTileSize = 16;
+
+    // Builds the light grid from the tree's emissive voxels; call
+    // updateLights() after edits change them
+    explicit CpuRenderer(const SparseVoxelOctree& tree);
+    void updateLights();
+
+    // Tiles are spread over pool with parallelForStealing(); the calling
+    // thread works too. camera.gridSize of 0 means the tree's full extent.
+    CpuImage render(const ShaderParams& params, const CameraParams& camera,
+                    uint32_t width, uint32_t height, ThreadPool& pool) const;
+
+private:
+    const SparseVoxelOctree& m_tree;
+    std::vector<uint32_t> m_lightGrid; // buildLightGrid() layout
+};
+
+} // namespace vox
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "vox/SparseVoxelOctree.h"
+#include <cstdint>
+#include <string>
+
+namespace vox {
+
+struct CpuRenderOptions {
+    std::string outPath;                // .png or .ppm
+    std::string scenePath = "../test.vox"; // .vox, .obj or .svo, loaded like the Scene field does
+    uint32_t width = 800;
+    uint32_t height = 600;
+    uint32_t threads = 0;               // 0 = every core (ThreadPool)
+    bool freeCamera = false;            // false: the startup orbit view, frozen at t = 0
+    glm::vec3 cameraPos{0.0f};          // grid units, like the free-fly camera
+    glm::vec3 cameraTarget{0.0f};
+    float fov = 45.0f;                  // vertical, degrees
+};
+
+// Headless: render a scene with CpuRenderer, without a window or GPU
+int renderCpuReference(const CpuRenderOptions& options);
+
+// Headless: import a dense raw volume and write it as a .svo scene,
+// which the Scene field (or a file drop) then loads directly. A non-zero
+// pageLevel builds it paged instead (SparseVoxelOctree::setPagedBuild), with
+// svoPath as the base path of the .svo top tree and the .pages file.
+int importRawVolume(const std::string& rawPath, const RawVolumeDesc& desc, const std::string& svoPath,
+                    uint32_t pageLevel = 0);
+
+// Headless: generate a procedural stress scene at depth and write it as
+// a .svo scene, so profiling runs need no asset files. pageLevel as above.
+int generateScene(const ProceduralSceneDesc& desc, uint32_t depth, const std::string& svoPath,
+                  uint32_t pageLevel = 0);
+
+// Runs argv[1] if it is one of the headless commands above (shared by vox
+// and the GPU-free vox-cpu). Returns the exit code, or -1 when argv[1] is
+// not a headless command.
+int runHeadlessCommand(int argc, char** argv);
+
+// Usage lines of the headless commands
+void printHeadlessUsage();
+
+} // namespace vox
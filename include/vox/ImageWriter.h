@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace vox {
+
+// 8-bit RGB images, rows top to bottom, 3 bytes per pixel. PNGs are written
+// with uncompressed deflate blocks: larger than an encoder would make them,
+// but without a dependency and bit-exact for image diffs.
+bool writePpm(const std::string& path, const uint8_t* rgb, uint32_t width, uint32_t height);
+bool writePng(const std::string& path, const uint8_t* rgb, uint32_t width, uint32_t height);
+
+// PNG for a .png extension, PPM otherwise
+bool writeImage(const std::string& path, const uint8_t* rgb, uint32_t width, uint32_t height);
+
+} // namespace vox
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace vox {
+
+// Spatial light grid (binding 6) over a gridSize^3 volume:
+// [dimX, dimY, dimZ, lightCount] + [offset, count] per cell + light indices.
+// A light is listed in every cell within 1.5 cells of its center; indices
+// point into getEmissiveVoxels().
+constexpr uint32_t kLightGridDim = 16;
+
+std::vector<uint32_t> buildLightGrid(const std::vector<glm::uvec3>& emissiveVoxels, uint32_t gridSize);
+
+} // namespace vox
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace vox {
+
+// Read-only memory mapping of a whole file (falls back to reading it into
+// memory where mmap is unavailable). The mapping lives until close().
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen() const { return m_data != nullptr; }
+    const uint8_t* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+    // 64-bit FNV-1a of the file contents (cache keys)
+    uint64_t hash() const;
+
+private:
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+    bool m_mapped = false;          // m_data comes from mmap rather than m_fallback
+    std::vector<uint8_t> m_fallback;
+};
+
+} // namespace vox
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "vox/SparseVoxelOctree.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace vox {
+
+// Instruction sets the packet tracer has kernels for
+enum class PacketKernel : uint32_t {
+    Scalar = 0, // SparseVoxelOctree::raycast(), one ray at a time
+    Sse41 = 1,  // 4 rays per packet
+    Avx2 = 2,   // 8 rays per packet
+};
+
+inline const char* packetKernelName(PacketKernel kernel) {
+    switch (kernel) {
+    case PacketKernel::Sse41: return "SSE4.1";
+    case PacketKernel::Avx2: return "AVX2";
+    default: return "scalar";
+    }
+}
+
+// Widest kernel both this build and the running CPU support
+PacketKernel detectPacketKernel();
+
+// CPU ray caster for GPU-less jobs (thumbnails, lightmap baking). Consecutive
+// rays are traced together as one packet: slab tests, exit planes and cell
+// steps run across all lanes in SIMD registers, and a lane whose cell lies in
+// the node another lane just fetched reuses it. Results match
+// SparseVoxelOctree::raycast() exactly, so order rays coherently (image
+// tiles, probe grids) for speed only. The tree must not change while tracing;
+// separate tracers may run on separate threads.
+class OctreePacketTracer {
+public:
+    // Falls back to detectPacketKernel() when kernel is not available
+    explicit OctreePacketTracer(const SparseVoxelOctree& tree, PacketKernel kernel = detectPacketKernel());
+
+    PacketKernel kernel() const { return m_kernel; }
+    uint32_t packetWidth() const;
+
+    void trace(const Ray* rays, size_t count, RayHit* hits) const;
+    std::vector<RayHit> trace(const std::vector<Ray>& rays) const {
+        std::vector<RayHit> hits(rays.size());
+        trace(rays.data(), rays.size(), hits.data());
+        return hits;
+    }
+
+private:
+    const SparseVoxelOctree& m_tree;
+    PacketKernel m_kernel;
+};
+
+} // namespace vox
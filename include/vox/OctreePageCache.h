@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace vox {
+
+// Page file (.pages) written by OctreePageWriter (savePagedFiles() and paged
+// builds, see SparseVoxelOctree::setPagedBuild()): this
+// header, the pages (64-byte aligned: node words, then LOD colors), then one
+// OctreePageEntry per page at indexOffset.
+struct OctreePageFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t pageCount;
+    uint32_t maxPageNodes; // largest page; GPU pool slots are this big
+    uint64_t indexOffset;
+};
+
+struct OctreePageEntry {
+    uint64_t offset;
+    uint32_t nodeCount;
+    uint32_t reserved;
+};
+
+// One subtree below the page level in dense node format. Index 0 is the
+// page root's child block; internal words hold page-local child indices, so
+// a page placed at node index base needs base added to them.
+struct OctreePage {
+    std::vector<uint32_t> nodes;
+    std::vector<uint32_t> lodColors; // parallel to nodes
+};
+
+// Writes a page file front to back: each page goes out when it is appended,
+// the index and header on finish(). The file is built as <path>.tmp and only
+// moved to path by a successful finish(); an unfinished one is removed.
+class OctreePageWriter {
+public:
+    ~OctreePageWriter();
+
+    bool open(const std::string& path);
+    bool append(const OctreePage& page); // becomes page pageCount() - 1
+    bool finish();
+
+    uint32_t pageCount() const { return static_cast<uint32_t>(m_index.size()); }
+    uint32_t maxPageNodes() const { return m_header.maxPageNodes; }
+    uint64_t bytesWritten() const { return m_written; }
+
+private:
+    static constexpr uint64_t kAlignment = 64;
+
+    std::ofstream m_file;
+    std::string m_path;
+    OctreePageFileHeader m_header{};
+    std::vector<OctreePageEntry> m_index;
+    uint64_t m_written = 0;
+
+    void align();
+    void discard();
+};
+
+// Host-side LRU cache over a page file. Pages are read on demand and the
+// least recently used ones are dropped once the budget is exceeded; a page
+// handed out stays valid while its shared_ptr is held.
+class OctreePageCache {
+public:
+    static constexpr char kMagic[4] = {'V', 'S', 'P', 'G'};
+    static constexpr uint32_t kVersion = 1;
+
+    bool open(const std::string& path, size_t budgetBytes);
+    bool isOpen() const { return m_file.is_open(); }
+
+    uint32_t pageCount() const { return static_cast<uint32_t>(m_index.size()); }
+    uint32_t maxPageNodes() const { return m_maxPageNodes; }
+
+    // Null if the page cannot be read
+    std::shared_ptr<const OctreePage> acquire(uint32_t page);
+
+    size_t residentBytes() const { return m_residentBytes; }
+    uint64_t hits() const { return m_hits; }
+    uint64_t misses() const { return m_misses; }
+
+private:
+    struct Slot {
+        std::shared_ptr<const OctreePage> page;
+        std::list<uint32_t>::iterator lru; // valid while page is set
+    };
+
+    std::ifstream m_file;
+    std::vector<OctreePageEntry> m_index;
+    std::vector<Slot> m_slots;  // indexed by page
+    std::list<uint32_t> m_lru;  // most recently used first
+    uint32_t m_maxPageNodes = 0;
+    size_t m_budgetBytes = 0;
+    size_t m_residentBytes = 0;
+    uint64_t m_hits = 0;
+    uint64_t m_misses = 0;
+};
+
+} // namespace vox
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "vox/SparseVoxelOctree.h"
+#include "vox/ThreadPool.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace vox {
+
+struct SceneLoadRequest {
+    std::string voxPath;                 // .vox or .obj scene, or a prebuilt .svo (e.g. from --import-raw)
+    std::string svoPath;                 // processed-tree cache keyed by the .vox hash; empty = none
+    uint32_t depth = 11;
+    NodeOrder nodeOrder = NodeOrder::BreadthFirst;
+    NodeFormat cacheFormat = NodeFormat::SparseMask; // node encoding stored in the cache
+    bool mergeIdenticalSubtrees = true;
+    bool fallbackToTestScene = false;    // a .vox that fails to load yields the test scene
+    bool diffSource = false;             // hot reload: only diffed into the current tree, so no LOD colors
+    bool solidFill = false;              // .obj: voxelize closed meshes as solids, not just their surface
+};
+
+// Loads a scene on a background thread: .svo cache or .vox/.obj import, subtree
+// merging, cache write and LOD colors, so the finished tree can go
+// straight to the GPU. Only one load runs at a time.
+class SceneLoader {
+public:
+    SceneLoader();
+    ~SceneLoader(); // waits for a running load (it stops at the next stage)
+
+    SceneLoader(const SceneLoader&) = delete;
+    SceneLoader& operator=(const SceneLoader&) = delete;
+
+    // False if a load is still running
+    bool start(const SceneLoadRequest& request);
+
+    bool busy() const { return m_busy.load(std::memory_order_acquire); }
+
+    // The finished tree, once; null while loading, after a failure, or
+    // when nothing was started. request receives the request it came from.
+    std::unique_ptr<SparseVoxelOctree> takeResult(SceneLoadRequest* request = nullptr);
+
+    // Current stage ("Importing test.vox", "Failed: ..."), for the GUI
+    std::string status() const;
+
+    // Runs a request on the calling thread (the loader's worker uses this too)
+    static std::unique_ptr<SparseVoxelOctree> load(const SceneLoadRequest& request,
+                                                   const std::function<void(const std::string&)>& progress = {},
+                                                   const std::atomic<bool>* cancel = nullptr);
+
+private:
+    std::atomic<bool> m_busy{false};
+    std::atomic<bool> m_cancel{false};
+    mutable std::mutex m_mutex;
+    std::unique_ptr<SparseVoxelOctree> m_result;
+    SceneLoadRequest m_resultRequest;
+    std::string m_status;
+
+    ThreadPool m_worker{1}; // last: joined before the state its task uses goes away
+
+    void setStatus(const std::string& status);
+};
+
+} // namespace vox
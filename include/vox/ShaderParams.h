@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+
+namespace vox {
+
+// Shading uniforms (binding 5, std140), shared by the GPU shaders and the
+// CPU reference renderer
+struct ShaderParams {
+    glm::vec4 bgColor{0.05f, 0.05f, 0.08f, 0.0f};
+    glm::vec4 keyDir{glm::normalize(glm::vec3(0.6f, 0.8f, 0.4f)), 0.6f};     // xyz direction, w weight
+    glm::vec4 fillDir{glm::normalize(glm::vec3(-0.3f, -0.5f, -0.2f)), 0.2f}; // xyz direction, w weight
+    glm::vec4 params0{0.3f, 4.0f, 6.0f, 0.02f};   // ambient, emissiveSelf, emissiveDirect, attenFactor
+    glm::vec4 params1{1.0f, 0.0f, 0.0f, 0.001f};  // attenBias, maxLights, debugMode, ddaEps
+    glm::vec4 params2{0.0002f, 0.0f, 0.0f, 0.0f}; // ddaEpsScale, nodeFormat, lodMinOccupancy, countNodeFetches
+    glm::uvec4 nodeAddress{0u}; // node/LOD buffer device addresses (lo, hi) past maxStorageBufferRange, else 0
+    glm::uvec4 paging{0u};      // page request capacity (0 = fully resident), frame stamp, reserved
+};
+
+// Camera push constants of raytrace.comp / raytrace.rgen
+struct CameraParams {
+    float time = 0.0f;      // orbit angle source while not under manual control
+    uint32_t debugMask = 0; // bit0 = draw subgrids, bit1 = draw root bounds, bit2 = manual control, bit3 = free-fly camera
+    float distance = 400.0f; // from the grid center (orbit mode)
+    float yaw = 0.0f;
+    float pitch = 0.4f;
+    float fov = 45.0f;       // vertical, degrees
+    float gridSize = 0.0f;
+    uint32_t statsSlot = 0;  // index into the binding 8 fetch counters
+    glm::vec3 cameraPos{0.0f}; // free-fly camera
+    uint32_t octreeDepth = 11; // levels the GPU descent walks (SparseVoxelOctree::getDepth())
+    glm::vec3 cameraDir{1.0f, 0.0f, 0.0f};
+    uint32_t streamedNodes = 0; // node words resident while a scene streams in, 0 = all
+};
+
+} // namespace vox
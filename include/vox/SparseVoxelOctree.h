@@ -3,16 +3,171 @@
 #include <glm/glm.hpp>
 #include <vector>
 #include <cstdint>
+#include <functional>
 #include <string>
-#include <unordered_map>
+#include <memory>
+#include "vox/ColorTable.h"
 
 namespace vox {
 
+class MappedFile;
+struct OctreePage;
+
 // Simple dense octree node: 8 children or leaf voxel color
 struct OctreeNode {
     static constexpr uint32_t LEAF_BIT = 0x80000000u;
-    static constexpr uint32_t HOMOGENEOUS_BIT = 0x40000000u;
-    uint32_t data; // bit31: isLeaf, bit30: homogeneous, bits[29:0]: child pointer or color index
+    static constexpr uint32_t HOMOGENEOUS_BIT = 0x40000000u; // leaf collapsed from 8 equal children
+    static constexpr uint32_t FAR_BIT = 0x40000000u;   // internal node: payload is a far pointer slot
+    static constexpr uint32_t BRICK_BIT = 0x40000000u; // internal word of encodeBrickNodes(): points at a brick
+    static constexpr uint32_t PAYLOAD_MASK = 0x3FFFFFFFu;
+    uint32_t data; // bit31: isLeaf, bit30: homogeneous/far, bits[29:0]: child pointer, far slot or color index
+};
+
+// GPU node encodings understood by raytrace.comp / raytrace.rchit (ShaderParams params2.y)
+enum class NodeFormat : uint32_t {
+    Dense = 0,      // getNodes(): every internal node owns 8 consecutive children
+    SparseMask = 1, // encodeSparseNodes(): child groups store only occupied octants
+    Bricks = 2,     // encodeBrickNodes(): dense nodes down to the brick level, then 8^3 bitmask bricks
+};
+
+inline const char* nodeFormatName(NodeFormat format) {
+    switch (format) {
+    case NodeFormat::SparseMask: return "sparse child-mask";
+    case NodeFormat::Bricks: return "brick map";
+    default: return "dense";
+    }
+}
+
+// Placement of child blocks in the node array. Parents always precede
+// their children; the orders differ in which blocks end up adjacent.
+enum class NodeOrder : uint32_t {
+    BreadthFirst = 0, // level by level (the builder's native order)
+    DepthFirst = 1,   // pre-order: each subtree is contiguous
+    VanEmdeBoas = 2,  // recursive half-height blocking: top subtree, then bottom subtrees
+};
+
+inline const char* nodeOrderName(NodeOrder order) {
+    switch (order) {
+    case NodeOrder::DepthFirst: return "depth-first";
+    case NodeOrder::VanEmdeBoas: return "van Emde Boas";
+    default: return "breadth-first";
+    }
+}
+
+// Dense raw volume (CT scans, simulation output): samples with x fastest,
+// then y, then z, after headerBytes of anything else. Volume axes are grid
+// axes.
+struct RawVolumeDesc {
+    glm::uvec3 size{0u};
+    uint32_t bytesPerSample = 1;   // 1 = uint8, 2 = uint16 little-endian
+    uint64_t headerBytes = 0;
+    // Transfer function: samples below threshold are empty, the rest map
+    // linearly from [threshold, maxValue] onto palette (low to high)
+    uint32_t threshold = 1;
+    uint32_t maxValue = 0;         // 0 = largest value of the sample type
+    std::vector<uint32_t> palette; // EERGBB, at most 255 entries; empty = grey ramp
+};
+
+// Stress scenes for profiling traversal and memory at full scale
+enum class ProceduralScene {
+    Terrain,    // fBm value-noise heightfield: one big connected surface
+    City,       // street grid of box buildings with window facades
+    PointCloud, // isolated cells scattered uniformly: little to collapse
+    Menger,     // Menger sponge: surface at every scale, nothing uniform
+};
+
+inline const char* proceduralSceneName(ProceduralScene scene) {
+    switch (scene) {
+    case ProceduralScene::City: return "city";
+    case ProceduralScene::PointCloud: return "points";
+    case ProceduralScene::Menger: return "menger";
+    default: return "terrain";
+    }
+}
+
+// The same desc at the same depth always gives the same tree
+struct ProceduralSceneDesc {
+    ProceduralScene scene = ProceduralScene::Terrain;
+    uint64_t seed = 1;
+    float emissiveDensity = 0.0f; // share of exposed cells that emit (City: of the windows)
+    float pointDensity = 0.001f;  // PointCloud: share of cells holding a point
+};
+
+// Input voxel for bulk construction: grid position + packed EERGBB color
+struct Voxel {
+    glm::uvec3 pos;
+    uint32_t color;
+};
+
+// GPU-ready sparse node words (and their LOD colors) viewed in place
+struct SparseNodeSpan {
+    const uint32_t* nodes = nullptr;
+    const uint32_t* lodColors = nullptr;
+    size_t count = 0;
+};
+
+// Half-open range of element indices touched by edits
+struct DirtyRange {
+    size_t begin;
+    size_t end;
+};
+
+// CPU ray query in grid coordinates (one unit per voxel). dir need not be
+// normalized; t is measured in multiples of it.
+struct Ray {
+    glm::vec3 origin;
+    glm::vec3 dir;
+    float maxT;
+};
+
+struct RayHit {
+    bool hit = false;
+    float t = 0.0f;            // entry distance into the hit voxel (0 if the origin is inside it)
+    glm::uvec3 voxel{0u};      // voxel at the entry point
+    glm::ivec3 normal{0};      // face entered through; zero if the origin is inside
+    uint32_t color = 0;        // EERGBB
+};
+
+// Nodes from the root down to the last cell a query descended to, so the
+// next descent can start below their deepest shared ancestor. nodes[k] sits
+// at depth k and covers 2^(getDepth() - k) voxels per axis.
+struct OctreeCursor {
+    uint32_t nodes[32] = {};
+    uint32_t depth = 0; // deepest valid entry
+    glm::uvec3 cell{0u};
+    bool valid = false;
+};
+
+// Shape and memory footprint of a tree (SparseVoxelOctree::computeStats()).
+// Per-level vectors are indexed by depth below the root (root = 0); a block
+// shared by several parents in a DAG is counted once, at the first level it
+// is reached from.
+struct OctreeStats {
+    uint32_t depth = 0;
+    uint64_t totalNodes = 0;       // words in getNodes()
+    uint64_t reachableNodes = 0;
+    uint64_t orphanedNodes = 0;    // unreachable from the root; compactNodes() drops them
+    std::vector<uint64_t> nodesPerLevel;
+    std::vector<uint64_t> leavesPerLevel;
+    std::vector<uint64_t> emptyPerLevel;
+    uint64_t internalNodes = 0;
+    uint64_t leafNodes = 0;
+    uint64_t emptyNodes = 0;
+    double leafRatio = 0.0;        // of reachable nodes
+    double emptyRatio = 0.0;
+    uint64_t homogeneousLeaves = 0; // nodes collapsed by markHomogeneousNodes() or edits
+    uint64_t sharedBlocks = 0;     // child blocks with more than one parent (DAG)
+    uint64_t pageRoots = 0;        // paged top tree: subtrees living in the page file
+    uint64_t farPointers = 0;
+    uint64_t paletteSize = 0;
+    uint64_t emissiveVoxels = 0;
+    NodeFormat gpuFormat = NodeFormat::Dense;
+    uint64_t hostBytes = 0;        // allocated by the tree's arrays
+    uint64_t gpuNodeBytes = 0;     // node words in gpuFormat
+    uint64_t gpuBytes = 0;         // node + LOD + palette + far pointer + emissive buffers
+
+    // One JSON object, keys named like the fields
+    std::string toJson() const;
 };
 
 // Sparse voxel octree with fixed grid of voxels at leaves
@@ -23,32 +178,321 @@ public:
     // Populate dummy test scene: some colored voxel blocks
     void generateTestScene();
 
-    // Load from MagicaVoxel .vox file
+    // Load a MagicaVoxel .vox file: every model instance of the scene graph
+    // (nTRN/nGRP/nSHP, hidden nodes and layers skipped) with its rotation and
+    // translation, converted to Y-up and moved to the grid origin. A model
+    // placed several times at the same offset within an aligned power-of-two
+    // block is built once and its subtree shared by all those placements.
     bool loadFromVoxFile(const std::string& filepath);
 
+    // Voxelize a Wavefront .obj at this tree's depth, scaled uniformly to
+    // fill the grid: conservative surface voxelization (every leaf cell a
+    // triangle touches) and, with solidFill, the cells it encloses (parity
+    // along +z, so the mesh should be closed). Vertex colors ("v x y z r g
+    // b") or the material's Kd go into the palette at 5 bits per channel.
+    // Triangles are binned into z slabs and x/y tiles; the tiles of a slab
+    // are rasterized in parallel (setBuildThreads) and each slab goes
+    // straight into the bottom-up builder.
+    bool loadFromObjFile(const std::string& filepath, bool solidFill = false);
+
+    // Stream a dense raw volume slab by slab: each leaf cell takes the
+    // highest of its 2x2x2 samples through the transfer function, and every
+    // slab is built bottom-up into 32^3-voxel subtrees, so memory holds one
+    // slab of cells and the finished tree, never the dense grid. The depth
+    // grows to fit the volume.
+    static constexpr uint32_t kRawBlockLevels = 5;
+    bool loadFromRawVolume(const std::string& filepath, const RawVolumeDesc& desc);
+
+    // Fill the whole grid at the current depth with a seeded stress scene.
+    // Cells are evaluated in parallel (setBuildThreads) one slab at a time
+    // and go straight into the bottom-up builder, so memory holds one slab
+    // and the finished tree. Needs depth kRawBlockLevels..20.
+    bool generateProceduralScene(const ProceduralSceneDesc& desc);
+
+    // Native .svo cache: the final node array, palette, emissive list and LOD
+    // colors in 64-byte aligned sections, plus the sparse GPU encoding when
+    // gpuFormat asks for it. sourceHash keys the cache to the file it came from.
+    bool saveSvoFile(const std::string& filepath, uint64_t sourceHash,
+                     NodeFormat gpuFormat = NodeFormat::SparseMask) const;
+
+    // Map a .svo file and bulk-copy its sections (no per-node processing;
+    // every section carries a checksum instead). Fails without touching the
+    // tree on a bad/old file or, when expectedHash is non-zero, a different
+    // source hash. A damaged sparse encoding is dropped rather than failing.
+    bool loadFromSvoFile(const std::string& filepath, uint64_t expectedHash = 0);
+
+    // Out-of-core split for scenes larger than host RAM: the subtree under
+    // every internal node at pageLevel (root = 0) goes to <basePath>.pages
+    // (see OctreePageCache) and the levels above it to <basePath>.svo. In that
+    // top tree a page root is FAR_BIT | page with a far pointer of 0 until a
+    // pager makes the page resident, so its LOD color still shades the
+    // subtree. Needs computeLodColors().
+    static constexpr uint32_t kDefaultPageLevel = 4;
+    bool savePagedFiles(const std::string& basePath, uint32_t pageLevel = kDefaultPageLevel) const;
+
+    // While basePath is set (empty = off), the dense importers (raw volume,
+    // OBJ, procedural) build straight into that layout: each layer of page
+    // subtrees goes to <basePath>.pages as soon as its slabs are built and is
+    // dropped, so memory never holds the whole tree. The tree ends up as the
+    // top tree and is also written to <basePath>.svo. Needs a page level in
+    // [1, depth - kRawBlockLevels].
+    void setPagedBuild(const std::string& basePath, uint32_t pageLevel = kDefaultPageLevel);
+
+    // True for a top tree loaded from savePagedFiles(). The CPU sees its pages
+    // as empty, so edits and passes that rewrite nodes refuse to run on it.
+    bool isPagedTop() const { return m_pagedTop; }
+
+    // Sparse encoding still mapped from the last loadFromSvoFile(); empty once
+    // the tree changes. Valid while the octree lives.
+    SparseNodeSpan getCachedSparseNodes() const { return m_cachedSparse; }
+
+    // Replace the tree with the given voxels in one bottom-up pass (Morton-sorted).
+    // Later duplicates of the same cell win, like repeated setVoxel calls.
+    void buildFromVoxels(const Voxel* voxels, size_t count);
+    void buildFromVoxels(const std::vector<Voxel>& voxels) { buildFromVoxels(voxels.data(), voxels.size()); }
+
+    // Palette variant: Voxel::color is an index into palette (e.g. the 256 .vox
+    // entries), so each entry is resolved once instead of hashing every voxel.
+    // Voxels whose index is past paletteSize are skipped.
+    void buildFromVoxels(const Voxel* voxels, size_t count, const uint32_t* palette, size_t paletteSize);
+
+    // Edits. Leaves cover 2x2x2 voxels, so every edit acts on whole leaf
+    // cells. fillBox takes an inclusive corner pair clamped to the grid;
+    // collapsed nodes are expanded and subtrees shared by a DAG are copied on
+    // write, and nodes that become uniform collapse again. Touched node
+    // indices are recorded for takeDirtyNodeRanges(). An emissive fill adds
+    // lights on the shell of the box, at most kMaxEditLights per call.
+    static constexpr uint64_t kMaxEditLights = 4096;
+    void setVoxel(glm::uvec3 pos, uint32_t color);
+    void clearVoxel(glm::uvec3 pos);
+    void fillBox(glm::uvec3 minCorner, glm::uvec3 maxCorner, uint32_t color);
+    void clearBox(glm::uvec3 minCorner, glm::uvec3 maxCorner);
+
+    // Hot reload: turn this tree into target (same depth, e.g. the re-import
+    // of the same file) by walking both at once and editing only the regions
+    // that differ, so dirty tracking sees just those nodes. The emissive list
+    // is taken over from target. False, with nothing changed, if the depths
+    // differ; changedRegions receives the number of edited regions.
+    bool applyDiff(const SparseVoxelOctree& target, size_t* changedRegions = nullptr);
+
+    // Granularity of dirty node tracking (4 KB of node words)
+    static constexpr size_t kDirtyPageNodes = 1024;
+
+    // Coalesced node ranges written since the last call (indices into
+    // getNodes() and getLodColors()); clears the record. Passes that move
+    // nodes (build, compaction, subtree merging) mark the whole array.
+    std::vector<DirtyRange> takeDirtyNodeRanges();
+    bool hasDirtyNodes() const { return m_allNodesDirty || m_dirtyPageCount > 0; }
+
+    // First palette entry added since the last call (getColors().size() if none)
+    size_t takeDirtyColorsBegin();
+
+    // First far pointer slot appended or rewritten by edits since the last
+    // call (getFarPointers().size() if none)
+    size_t takeDirtyFarBegin();
+
+    // True once if the emissive voxel list changed since the last call
+    bool takeEmissiveDirty();
+
+    // Worker threads for buildFromVoxels/markHomogeneousNodes (0 = hardware
+    // concurrency, 1 = serial). Large builds are split into 8^splitLevel
+    // subtrees; the node array is byte-identical to the serial build.
+    void setBuildThreads(uint32_t threads, uint32_t splitLevel = 1);
+
+    // Node order that compactNodes() lays the tree out in (and loadFromSvoFile
+    // reports for cached trees). Set it before loading.
+    void setNodeOrder(NodeOrder order) { m_nodeOrder = order; }
+    NodeOrder getNodeOrder() const { return m_nodeOrder; }
+
+    // Rebuild the node array in the given order and make it the current one.
+    // DAG blocks are placed once, after all of their parents, and unreachable
+    // blocks are dropped. Returns bytes saved.
+    size_t relayoutNodes(NodeOrder order);
+
+    // CPU queries for gameplay and tools (picking, collision). They only read
+    // the tree, so any number of threads may call them while it is not being
+    // modified. Positions outside the grid are empty; so are the pages of a
+    // paged top tree.
+    bool isSolid(glm::uvec3 pos) const;
+    bool getColor(glm::uvec3 pos, uint32_t& color) const; // false if empty
+
+    // Stackless traversal: each step descends to the empty node around the
+    // ray and skips its whole box, resuming from the deepest ancestor it
+    // shares with the next cell instead of the root.
+    RayHit raycast(const glm::vec3& origin, const glm::vec3& dir, float maxT) const;
+
+    // Word of the deepest node containing cell (inside the grid): a leaf, or
+    // an empty node of (1 << getDepth()) >> cursor.depth voxels per axis.
+    // Building block for the queries above and the packet tracer.
+    uint32_t descend(glm::uvec3 cell, OctreeCursor& cursor) const;
+
+    // Batched form: one traversal path is carried from ray to ray, so
+    // coherent rays (picking grids, collision probes) skip the upper levels
+    void raycast(const Ray* rays, size_t count, RayHit* hits) const;
+    std::vector<RayHit> raycast(const std::vector<Ray>& rays) const {
+        std::vector<RayHit> hits(rays.size());
+        raycast(rays.data(), rays.size(), hits.data());
+        return hits;
+    }
+
     // Get octree nodes (GPU upload)
     const std::vector<OctreeNode>& getNodes() const { return m_nodes; }
     
+    // Sparse child-mask encoding of the tree. An internal node's word points at
+    // a child group: a header word (bits[7:0] valid mask, bits[15:8] leaf mask)
+    // followed by one word per occupied octant in octant order, so child i is at
+    // group + 1 + popcount(valid & ((1 << i) - 1)). Leaves keep the dense format.
+    // Groups follow the block order of getNodes(), so the node order carries over.
+    // When lodColors is given it receives getLodColors() remapped to the
+    // sparse word indices (group header words get 0). Empty when the
+    // encoding itself outgrows the 30-bit payload.
+    std::vector<uint32_t> encodeSparseNodes(std::vector<uint32_t>* lodColors = nullptr) const;
+
+    // Brick-map encoding: the bottom kBrickLevels levels of the tree are
+    // replaced by bricks of 8x8x8 leaf cells. Nodes down to getBrickLevel()
+    // keep the dense format; an internal node at that level becomes
+    // BRICK_BIT | record, and the record (appended after all node blocks) is
+    // 16 occupancy words (cell bit x*64 + y*8 + z) followed by one palette
+    // index per occupied cell in bit order. A ray then walks a brick with a
+    // cell DDA instead of three more pointer hops. Blocks shared by a DAG
+    // share their record. Empty when the tree is too shallow for bricks or
+    // the encoding outgrows the 30-bit payload.
+    // lodColors works as for encodeSparseNodes (brick record words get 0).
+    static constexpr uint32_t kBrickLevels = 3;
+    uint32_t getBrickLevel() const { return m_depth > kBrickLevels + 1 ? m_depth - 1 - kBrickLevels : 0; }
+    std::vector<uint32_t> encodeBrickNodes(std::vector<uint32_t>* lodColors = nullptr) const;
+
+    // Pre-filtered color per node, parallel to getNodes(): 0xOORRGGBB with the
+    // occupied fraction of the node's volume in the high byte (0 = empty,
+    // 255 = solid) and the occupancy-weighted average RGB of its voxels.
+    // Distance LOD shades a truncated descent with it.
+    void computeLodColors();
+    const std::vector<uint32_t>& getLodColors() const { return m_lodColors; }
+
     // Get voxel colors (EERGBB, emissive in high byte)
     const std::vector<uint32_t>& getColors() const { return m_colors; }
 
     // Emissive voxel positions (grid coordinates)
     const std::vector<glm::uvec3>& getEmissiveVoxels() const { return m_emissiveVoxels; }
     
+    // Child block indices that do not fit the 30-bit payload. An internal
+    // word with FAR_BIT holds a slot in this table instead of the pointer
+    // (ESVO-style escape), so node indices are 32-bit end to end. Empty
+    // unless the tree has more than 2^30 nodes; smaller trees keep the plain
+    // format.
+    const std::vector<uint32_t>& getFarPointers() const { return m_farPointers; }
+
+    // Child block of a node word (0 for leaves and empty nodes)
+    uint32_t childPointer(uint32_t data) const {
+        if (data & OctreeNode::LEAF_BIT) return 0;
+        const uint32_t payload = data & OctreeNode::PAYLOAD_MASK;
+        return (data & OctreeNode::FAR_BIT) ? m_farPointers[payload] : payload;
+    }
+
     uint32_t getDepth() const { return m_depth; }
     uint32_t getRootNodeIndex() const { return 0; }
     
     // Mark homogeneous nodes for optimization
     void markHomogeneousNodes();
 
+    // Remove nodes no longer reachable from the root (e.g. children of collapsed
+    // homogeneous nodes) and rewrite child pointers. Orders other than
+    // breadth-first go through relayoutNodes(). Returns bytes saved.
+    size_t compactNodes();
+
+    // Merge identical subtrees bottom-up so parents share one copy of each
+    // distinct 8-child block, turning the tree into a DAG. Blocks are
+    // compared with their leaf palette indices, so this is not a
+    // geometry-only DAG: equal shapes in different colors stay separate.
+    // The traversal stays unchanged. Compacts afterwards; returns bytes saved.
+    size_t mergeIdenticalSubtrees();
+
+    // True once mergeIdenticalSubtrees() has run
+    bool hasMergedSubtrees() const { return m_mergedSubtrees; }
+
+    // Walk the tree once and report its shape and footprint. The GPU figure
+    // is for uploading in gpuFormat, which encodes the tree for the sparse
+    // and brick formats, so keep those out of per-frame code.
+    OctreeStats computeStats(NodeFormat gpuFormat = NodeFormat::Dense) const;
+
 private:
     uint32_t m_depth;
     std::vector<OctreeNode> m_nodes;
     std::vector<uint32_t> m_colors; // Color palette (unique colors only)
-    std::unordered_map<uint32_t, uint32_t> m_colorToIndex; // Color -> palette index
+    ColorTable m_colorToIndex; // Color -> palette index
     std::vector<glm::uvec3> m_emissiveVoxels;
+    std::vector<uint32_t> m_lodColors; // parallel to m_nodes, empty until computeLodColors()
+    std::vector<uint32_t> m_farPointers; // see getFarPointers(); rebuilt by every pass that moves nodes
+    std::vector<uint32_t> m_freeFarSlots; // far slots of nodes collapsed by edits, reused by later edits
+    uint32_t m_farPointerBase = OctreeNode::PAYLOAD_MASK + 1; // first child index stored as a far pointer
+    uint32_t m_buildThreads = 0;
+    uint32_t m_buildSplitLevel = 1;
+    std::string m_pagedBuildPath; // setPagedBuild(), empty = off
+    uint32_t m_pagedBuildLevel = kDefaultPageLevel;
+    NodeOrder m_nodeOrder = NodeOrder::BreadthFirst;
+    std::vector<uint64_t> m_levelOffsets; // level start indices from buildFromVoxels, empty once edited
+    bool m_mergedSubtrees = false;
+    bool m_sharedBlocks = false; // blocks may have several parents (merged subtrees, instanced .vox models)
+    bool m_pagedTop = false;
+    std::shared_ptr<MappedFile> m_svoMapping; // backs m_cachedSparse
+    SparseNodeSpan m_cachedSparse;
+
+    // Blocks below this index may have several parents (DAG) and are copied
+    // before an edit writes into them; blocks appended by edits are owned
+    size_t m_sharedBlockLimit = 0;
+    // A copied block points back at older children, breaking the "children
+    // after parents" order the bottom-up passes rely on; compaction restores it
+    // through relayoutNodes()
+    bool m_childOrderBroken = false;
+
+    std::vector<uint64_t> m_dirtyPages; // bitmap of kDirtyPageNodes pages
+    size_t m_dirtyPageCount = 0;
+    bool m_allNodesDirty = true;
+    size_t m_colorsDirtyBegin = 0;
+    size_t m_farDirtyBegin = 0;
+    bool m_emissiveDirty = true;
+
+    void clearTree(); // empty root, palette and flags of a fresh build
+    void dropCachedEncoding();
+    bool rejectPagedTop(const char* pass) const; // true (and logs) on a paged top tree
+    void markNodesDirty(size_t begin, size_t end);
+    void markAllNodesDirty();
+
+    void editBox(glm::uvec3 minCorner, glm::uvec3 maxCorner, uint32_t leafWord);
+    bool editNode(uint32_t nodeIdx, glm::uvec3 nodeMin, uint32_t nodeSize,
+                  glm::uvec3 boxMin, glm::uvec3 boxMax, uint32_t leafWord); // true if the subtree changed
+    uint32_t appendChildBlock(const uint32_t* words, const uint32_t* lodColors); // lodColors null = filter words
+    uint32_t pointerWord(uint32_t child, std::vector<uint32_t>& farPointers) const; // appends a slot when far
+    uint32_t editPointerWord(uint32_t child, uint32_t oldData); // reuses oldData's or a freed slot when far
+    void releaseFarSlot(uint32_t data); // data is being overwritten by an edit
+    void addEmissiveShell(glm::uvec3 cellMin, glm::uvec3 cellMax); // inclusive leaf cell range
+    // Parent word of a block built bottom-up: collapsed like
+    // markHomogeneousNodes() when uniform, else the appended block
+    uint32_t packChildBlock(const uint32_t* words);
+
+    // Streaming bottom-up build shared by the dense importers. Slab s holds
+    // the 2^(kRawBlockLevels - 1) leaf cell layers from z = s * that on;
+    // fillSlab writes its cell values (0 = empty, else a voxel of
+    // valueColors[v]) into a zeroed array with the given strides, padded to
+    // whole blocks. Every slab is reduced to subtrees right away, so only
+    // one is held; a paged build (setPagedBuild) also writes out and drops
+    // each finished layer of pages. Replaces the tree; returns solid cells,
+    // or kSlabBuildFailed if fillSlab or the paged output failed.
+    using CellSlabFill = std::function<bool(uint32_t slab, uint16_t* cells, size_t rowStride, size_t layerStride)>;
+    static constexpr uint64_t kSlabBuildFailed = ~0ull;
+    uint64_t buildFromCellSlabs(glm::uvec3 cells, const std::vector<uint32_t>& valueColors, const CellSlabFill& fillSlab);
+    // Subtree under block in page-local indices, breadth-first; false past
+    // the 30-bit pointer range. Needs LOD colors for the nodes it copies.
+    bool collectPage(uint32_t block, OctreePage& page) const;
+
+    // Instancing: append another tree's nodes and palette (returns its root
+    // word rewritten for this tree), then point the empty node at level
+    // (root = 0) around origin at it, creating the internal nodes above
+    uint32_t appendSubtree(const SparseVoxelOctree& sub);
+    bool graftNode(glm::uvec3 origin, uint32_t level, uint32_t word);
+    void eraseEmissiveIn(glm::uvec3 boxMin, glm::uvec3 boxMax);
+    uint32_t filterLodColor(uint32_t data) const;
 
-    void setVoxel(glm::uvec3 pos, uint32_t color);
     uint32_t getOrAddColor(uint32_t color);
 };
 
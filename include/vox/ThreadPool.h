@@ -0,0 +1,48 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vox {
+
+// Fixed-size worker pool for CPU-side scene processing
+class ThreadPool {
+public:
+    explicit ThreadPool(uint32_t threadCount = 0); // 0 = hardware concurrency
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    uint32_t size() const { return static_cast<uint32_t>(m_workers.size()); }
+
+    // Queue a task; it runs on some worker eventually
+    void submit(std::function<void()> task);
+
+    // Run fn(i) for every i in [0, count) and block until all are done.
+    // The calling thread helps, so this is safe to call from a worker.
+    void parallelFor(size_t count, const std::function<void(size_t)>& fn);
+
+    // Like parallelFor, but each participating thread starts on its own
+    // contiguous slice of [0, count) and, once that runs dry, steals the upper
+    // half of the largest slice left. Neighbouring indices (image tiles) stay
+    // on one thread and the shared counter stops being a contention point.
+    void parallelForStealing(size_t count, const std::function<void(size_t)>& fn);
+
+private:
+    std::vector<std::thread> m_workers;
+    std::deque<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_stopping = false;
+
+    void workerLoop();
+};
+
+} // namespace vox
@@ -5,10 +5,19 @@
 #include <vector>
 #include <memory>
 #include <chrono>
+#include <filesystem>
+#include <string>
 #include <glm/glm.hpp>
+#include "vox/ShaderParams.h"
 
 namespace vox {
 class SparseVoxelOctree;
+class OctreePageCache;
+class SceneLoader;
+struct OctreeStats;
+struct CpuImage;
+enum class NodeFormat : uint32_t;
+enum class NodeOrder : uint32_t;
 }
 
 namespace vox {
@@ -49,6 +58,29 @@ public:
 
     bool valid() const { return m_initialized; }
 
+    // CPU-side scene; edits made through it are uploaded at the start of the next frame
+    SparseVoxelOctree* octree() { return m_octree.get(); }
+
+    // Import a .vox scene in the background (cached next to it as .svo). The
+    // current scene keeps rendering until the new one is swapped in; false
+    // while another load is running.
+    bool loadScene(const std::string& voxPath, bool fallbackToTestScene = false);
+
+    // GPU image check against CpuRenderer (vox --compare-gpu). The reference
+    // view is the orbit start without bloom, scaling or hot reload, so every
+    // frame of it is the same.
+    void setReferenceView();
+    // A load is running or its node words are still streaming in
+    bool sceneLoading() const;
+    // voxPath was swapped in and all of its node words are on the GPU
+    bool sceneLoaded(const std::string& voxPath) const;
+    // Re-uploads the tree; false if it fell back to another encoding
+    bool setNodeFormat(NodeFormat format);
+    // Waits for the GPU and reads back the last traced frame
+    bool captureFrame(CpuImage& image);
+    // CpuRenderer image of the view the next frame draws
+    CpuImage renderCpuFrame();
+
 private:
     SDL_Window* m_window = nullptr;
     bool m_initialized = false;
@@ -116,6 +148,12 @@ private:
     float m_bloomIntensity = 0.6f;
     float m_bloomRadius = 2.0f;
 
+    // GUI voxel edit box (inclusive grid coordinates)
+    int m_editMin[3] = { 0, 0, 0 };
+    int m_editMax[3] = { 15, 15, 15 };
+    float m_editColor[3] = { 1.0f, 0.5f, 0.2f };
+    bool m_editEmissive = false;
+
     // camera / input-controlled parameters
     float m_distance = 400.0f;      // distance from target
     float m_yaw = 0.0f;             // horizontal angle (radians)
@@ -136,10 +174,167 @@ private:
     float m_freeFlyPitch = 0.0f;
 
     // Octree data buffers
+    NodeFormat m_nodeFormat;            // GPU node encoding uploaded to binding 1
+    NodeOrder m_nodeOrder;              // block layout of the node array (cache locality)
+    bool m_mergeIdenticalSubtrees = true; // share identical (same-color) subtrees as a DAG after loading
+    VkDeviceSize m_octreeNodesBytes = 0;
     VkBuffer m_octreeNodesBuffer = VK_NULL_HANDLE;
     VkDeviceMemory m_octreeNodesMemory = VK_NULL_HANDLE;
     VkBuffer m_octreeColorsBuffer = VK_NULL_HANDLE;
     VkDeviceMemory m_octreeColorsMemory = VK_NULL_HANDLE;
+    VkBuffer m_octreeLodBuffer = VK_NULL_HANDLE;     // per-node LOD colors, indexed like the node buffer
+    VkDeviceMemory m_octreeLodMemory = VK_NULL_HANDLE;
+    void* m_octreeNodesMapped = nullptr;            // persistently mapped for patches; null when device-local
+    void* m_octreeColorsMapped = nullptr;
+    void* m_octreeLodMapped = nullptr;
+    VkDeviceSize m_octreeNodesCapacity = 0;         // allocated bytes; node and LOD buffers share it
+    VkDeviceSize m_octreeColorsCapacity = 0;
+    VkBuffer m_octreeFarBuffer = VK_NULL_HANDLE;    // far pointer table (binding 9), see getFarPointers()
+    VkDeviceMemory m_octreeFarMemory = VK_NULL_HANDLE;
+    void* m_octreeFarMapped = nullptr;
+    VkDeviceSize m_octreeFarCapacity = 0;
+    size_t m_octreeFarCount = 0;                    // far pointers currently uploaded
+    VkDeviceSize m_maxStorageBufferRange = 0;       // larger node arrays are read by device address
+
+    // Host-visible, coherent and persistently mapped; usage with
+    // SHADER_DEVICE_ADDRESS also allocates device-addressable memory
+    bool createMappedBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
+                            VkBuffer& buffer, VkDeviceMemory& memory, void*& mapped);
+    // Device-local and a transfer destination, filled through writeBuffer()
+    bool createDeviceBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer& buffer, VkDeviceMemory& memory);
+    bool allocateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+                        VkBuffer& buffer, VkDeviceMemory& memory);
+    bool reserveOctreeBuffers(VkDeviceSize nodeCapacity, VkDeviceSize colorCapacity, VkDeviceSize farCapacity);
+    bool uploadOctree();
+    bool uploadLights();
+    void destroyOctreeBuffers();
+    void writeOctreeDescriptors();
+    void syncOctreeEdits();
+    void waitForLastFrame();                        // previous submission done with the mapped buffers
+    void waitForFrame(uint64_t frameValue);
+
+    // Discrete GPUs keep the octree and light buffers device-local. Writes
+    // go to one half of a host-visible staging buffer and the next frame's
+    // command buffer copies them over before tracing; a half is refilled
+    // once the frame that copied out of it has retired, and a full half is
+    // flushed with a one-off submit. On unified memory (integrated GPUs,
+    // lavapipe) the buffers stay host-visible and writes go straight in.
+    static constexpr VkDeviceSize kStagingBytes = 64ull << 20; // per half: a frame of streamed nodes + LOD
+    struct StagedCopy {
+        VkBuffer buffer;
+        VkBufferCopy region;
+    };
+    bool m_deviceLocalBuffers = false;
+    VkBuffer m_stagingBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory m_stagingMemory = VK_NULL_HANDLE;
+    void* m_stagingMapped = nullptr;
+    uint32_t m_stagingHalf = 0;
+    VkDeviceSize m_stagingUsed = 0;                 // bytes of the current half taken
+    uint64_t m_stagingRetire[2] = {};               // frame value that copies out of each half, 0 = free
+    std::vector<StagedCopy> m_stagedCopies;
+    void chooseBufferMemory();                      // sets m_deviceLocalBuffers from the memory heaps
+    // mapped non-null: copy straight in; else stage a copy into buffer
+    void writeBuffer(VkBuffer buffer, void* mapped, VkDeviceSize offset, const void* data, VkDeviceSize bytes);
+    void recordStagedCopies(VkCommandBuffer cmd);   // into this frame's command buffer, before tracing
+    void flushStagedCopies();                       // one-off submit; waits for it
+    void cmdCopyStaged(VkCommandBuffer cmd);
+    void dropStagedCopies(VkBuffer buffer);         // buffer is about to be destroyed
+    void destroyStaging();
+
+    // Background scene loading: the finished tree replaces m_octree between
+    // frames and its dense node words then stream in array order, a bounded
+    // range per frame, so breadth-first trees show their coarse levels first.
+    // Child blocks past the streamed range shade their LOD color (CameraParams::streamedNodes).
+    static constexpr VkDeviceSize kStreamBytesPerFrame = 32ull << 20;
+    std::unique_ptr<SceneLoader> m_sceneLoader;
+    char m_scenePath[256] = "../test.vox";
+    size_t m_streamedNodes = 0;                     // node words resident on the GPU
+    size_t m_streamNodeCount = 0;                   // node words being streamed, 0 = none
+
+    void pollSceneLoader();
+    bool beginSceneStream();
+    void streamOctreeNodes();
+
+    // Hot reload: the loaded .vox is checked for a new write time a few
+    // times a second, re-imported in the background when it changed and
+    // diffed into m_octree, so only the edited node pages go to the GPU
+    bool m_hotReload = true;
+    std::string m_loadedScenePath;                  // watched file, empty = none
+    std::filesystem::file_time_type m_loadedSceneTime{};
+    std::filesystem::file_time_type m_requestedSceneTime{}; // of the load in flight
+    std::chrono::high_resolution_clock::time_point m_nextReloadCheck{};
+    bool m_solidFillMeshes = false; // .obj scenes are filled, not just their surface
+
+    void checkSceneReload();
+    bool applySceneReload(const SparseVoxelOctree& tree);
+
+    // Out-of-core paging: a top tree whose far table is the page table, and
+    // a fixed pool of page slots behind it in the node/LOD buffers. Rays that
+    // reach a missing page shade its LOD color and request it (binding 10).
+    static constexpr uint32_t kPageRequestCapacity = 1024;
+    static constexpr uint32_t kPageUploadsPerFrame = 16;
+    std::unique_ptr<OctreePageCache> m_pageCache;   // null unless a paged octree was opened
+    VkDeviceSize m_pagePoolBytes = 512ull << 20;    // GPU page slots
+    size_t m_pageCacheBytes = 1ull << 30;           // host LRU cache
+    uint32_t m_pageSlotNodes = 0;
+    uint32_t m_pageSlotCount = 0;
+    uint32_t m_pageSlotBase = 0;                    // node index of slot 0 (top tree size)
+    std::vector<uint32_t> m_slotPage;               // page held by each slot
+    std::vector<uint32_t> m_pageSlot;               // slot holding each page
+    uint32_t m_pageFrame = 1;                       // stamp rays write for the pages they use
+    uint32_t m_pagesResident = 0;
+    VkBuffer m_pageFeedbackBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory m_pageFeedbackMemory = VK_NULL_HANDLE;
+    void* m_pageFeedbackMapped = nullptr;
+
+    bool openPagedOctree();
+    void savePagedOctree();
+    bool createPageFeedback();
+    void destroyPageFeedback();
+    void resetPageSlots();
+    void updatePageResidency();
+
+    // Push constants for the current view; the CPU reference renderer gets
+    // the same ones
+    CameraParams currentCamera();
+    void renderCpuReference();
+
+    // Traversal statistics: GPU timestamps around the trace dispatch and a
+    // node-fetch counter (binding 8), one slot per swapchain image
+    static constexpr uint32_t kStatsSlots = 8;
+    VkQueryPool m_traceQueryPool = VK_NULL_HANDLE;
+    float m_timestampPeriod = 0.0f;                 // ns per tick; 0 = queue has no timestamps
+    VkBuffer m_traceStatsBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory m_traceStatsMemory = VK_NULL_HANDLE;
+    void* m_traceStatsMapped = nullptr;
+    bool m_slotTimed[kStatsSlots] = {};             // slot has timestamps from its last submission
+    int32_t m_slotBenchOrder[kStatsSlots] = {};     // node order a benchmark frame measured, -1 = none
+    float m_gpuTraceMs = 0.0f;
+
+    // Node-order benchmark: fly the orbit path once per NodeOrder and compare
+    // GPU trace time and node fetches per frame
+    struct NodeOrderBenchmark {
+        bool active = false;
+        uint32_t order = 0;        // NodeOrder being measured
+        uint32_t frame = 0;        // frames submitted for it (warmup included)
+        double gpuMs[3] = {};
+        uint64_t nodeFetches[3] = {};
+        uint32_t samples[3] = {};
+        bool savedManual = false;
+        bool savedFreeFly = false;
+        float savedYaw = 0.0f;
+        float savedPitch = 0.0f;
+    } m_bench;
+    bool m_benchHasResults = false;
+    std::unique_ptr<OctreeStats> m_octreeStats;     // last "Octree stats" snapshot for the GUI
+
+    bool createTraceStats();
+    void destroyTraceStats();
+    void collectTraceStats(uint32_t slot);
+    void startNodeOrderBenchmark();
+    void advanceNodeOrderBenchmark();
+    void finishNodeOrderBenchmark();
+    void applyNodeOrder(NodeOrder order);
 
     VkBuffer m_emissiveBuffer = VK_NULL_HANDLE;
     VkDeviceMemory m_emissiveMemory = VK_NULL_HANDLE;
@@ -150,21 +345,7 @@ private:
     VkBuffer m_shaderParamsBuffer = VK_NULL_HANDLE;
     VkDeviceMemory m_shaderParamsMemory = VK_NULL_HANDLE;
 
-    struct ShaderParamsCPU {
-        glm::vec4 bgColor;
-        glm::vec4 keyDir;
-        glm::vec4 fillDir;
-        glm::vec4 params0; // ambient, emissiveSelf, emissiveDirect, attenFactor
-        glm::vec4 params1; // attenBias, maxLights, debugMode, ddaEps
-        glm::vec4 params2; // ddaEpsScale, reserved, reserved, reserved
-    } m_shaderParams{
-        glm::vec4(0.05f, 0.05f, 0.08f, 0.0f),
-        glm::vec4(glm::normalize(glm::vec3(0.6f, 0.8f, 0.4f)), 0.6f),
-        glm::vec4(glm::normalize(glm::vec3(-0.3f, -0.5f, -0.2f)), 0.2f),
-        glm::vec4(0.3f, 4.0f, 6.0f, 0.02f),
-        glm::vec4(1.0f, 0.0f, 0.0f, 0.001f),
-        glm::vec4(0.0002f, 0.0f, 0.0f, 0.0f)
-    };
+    ShaderParams m_shaderParams;
     
     // RTX ray tracing
     bool m_useRTX = false;
@@ -23,6 +23,7 @@ public:
     bool consumeDebugLightingToggle();
     bool consumeCameraToggle();
     bool consumeGUIToggle();
+    bool consumeDroppedFile(std::string &outPath); // last file dropped on the window
     
     // Continuous key states (level-triggered)
     bool isKeyW() const { return m_keyW; }
@@ -63,6 +64,7 @@ private:
     bool m_debugLightingPressed = false;
     bool m_cameraTogglePressed = false;
     bool m_guiTogglePressed = false;
+    std::string m_droppedFile;
     
     // Continuous key states (level-triggered)
     bool m_keyW = false;
@@ -1,9 +1,14 @@
 #define GLM_ENABLE_EXPERIMENTAL
 #include "vox/Application.h"
+#include "vox/CpuRenderer.h"
+#include "vox/ImageWriter.h"
+#include "vox/SparseVoxelOctree.h"
 #include "imgui.h"
+#include <chrono>
 #include <glm/glm.hpp>
 #include <glm/gtx/string_cast.hpp>
 #include <iostream>
+#include <string>
 
 namespace vox {
 
@@ -41,6 +46,12 @@ int Application::run() {
             m_renderer->recreateSwapchain();
         }
 
+        // A .vox dropped on the window loads in the background
+        std::string droppedFile;
+        if (m_window.consumeDroppedFile(droppedFile) && m_renderer) {
+            m_renderer->loadScene(droppedFile);
+        }
+
         // grid toggle
         if (m_window.consumeGridToggle()) {
             if (m_renderer) m_renderer->toggleGridOverlay();
@@ -164,4 +175,70 @@ int Application::run() {
     return 0;
 }
 
+int Application::compareWithCpuReference(const std::string& scenePath, float maxDiffPercent) {
+    // Channel difference a pixel may show without counting: the GPU rounds
+    // through the sRGB image and steps with DDA epsilons the reference lacks
+    constexpr uint32_t kTolerance = 8;
+    constexpr auto kLoadTimeout = std::chrono::minutes(5);
+
+    if (!init()) {
+        std::cerr << "No window or Vulkan device: GPU image check skipped\n";
+        return kSkipped;
+    }
+    m_renderer->setReferenceView();
+
+    // The startup scene is still loading; draw until it is in, then load the
+    // scene under test the same way
+    bool running = true;
+    const auto deadline = std::chrono::steady_clock::now() + kLoadTimeout;
+    auto drawUntil = [&](auto&& done) {
+        while (running && !done()) {
+            if (std::chrono::steady_clock::now() > deadline) return false;
+            m_window.pollEvents(running);
+            m_renderer->drawFrame();
+        }
+        return running;
+    };
+    if (!drawUntil([&] { return !m_renderer->sceneLoading(); }) || !m_renderer->loadScene(scenePath) ||
+        !drawUntil([&] { return m_renderer->sceneLoaded(scenePath); })) {
+        std::cerr << "Failed to load " << scenePath << "\n";
+        return 1;
+    }
+
+    const CpuImage reference = m_renderer->renderCpuFrame();
+    const NodeFormat formats[] = { NodeFormat::Dense, NodeFormat::SparseMask, NodeFormat::Bricks };
+    const char* const names[] = { "dense", "sparse", "bricks" };
+    int failed = 0;
+    for (size_t f = 0; f < 3; ++f) {
+        CpuImage frame;
+        if (!m_renderer->setNodeFormat(formats[f])) {
+            std::cerr << nodeFormatName(formats[f]) << ": encoding not available for " << scenePath << "\n";
+            ++failed;
+            continue;
+        }
+        // A second frame so staged uploads of the first have landed either way
+        m_renderer->drawFrame();
+        m_renderer->drawFrame();
+        if (!m_renderer->captureFrame(frame)) {
+            std::cerr << nodeFormatName(formats[f]) << ": frame readback failed\n";
+            ++failed;
+            continue;
+        }
+        const ImageDiff diff = diffImages(frame, reference, kTolerance);
+        const double percent = diff.pixels ? 100.0 * diff.differing / diff.pixels : 100.0;
+        const bool ok = diff.pixels != 0 && percent <= maxDiffPercent;
+        std::cout << nodeFormatName(formats[f]) << ": " << diff.differing << "/" << diff.pixels
+                  << " pixels differ (" << percent << "%, max channel delta " << diff.maxDelta << ") "
+                  << (ok ? "ok" : "FAILED") << std::endl;
+        if (!ok) {
+            // Left in the working directory to look at
+            const std::string path = std::string("gpu_") + names[f] + ".png";
+            writeImage(path, frame.rgb.data(), frame.width, frame.height);
+            writeImage("cpu_reference.png", reference.rgb.data(), reference.width, reference.height);
+            ++failed;
+        }
+    }
+    return failed == 0 ? 0 : 1;
+}
+
 } // namespace vox
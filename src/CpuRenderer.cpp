@@ -0,0 +1,220 @@
+#include "vox/CpuRenderer.h"
+#include "vox/LightGrid.h"
+#include "vox/OctreePacketTracer.h"
+#include "vox/SparseVoxelOctree.h"
+#include "vox/ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+namespace vox {
+
+namespace {
+
+struct Hit {
+    glm::vec3 albedo;
+    float emissive;
+    glm::vec3 normal;
+    glm::vec3 position;
+};
+
+// computeAABBNormal() of the shader, for rays starting inside a voxel
+glm::vec3 boxNormal(glm::vec3 point, glm::vec3 boxMin, glm::vec3 boxMax) {
+    const glm::vec3 local = (point - (boxMin + boxMax) * 0.5f) / ((boxMax - boxMin) * 0.5f + 0.0001f);
+    const glm::vec3 a = glm::abs(local);
+    if (a.x >= a.y && a.x >= a.z) return glm::vec3(local.x < 0.0f ? -1.0f : 1.0f, 0.0f, 0.0f);
+    if (a.y >= a.z) return glm::vec3(0.0f, local.y < 0.0f ? -1.0f : 1.0f, 0.0f);
+    return glm::vec3(0.0f, 0.0f, local.z < 0.0f ? -1.0f : 1.0f);
+}
+
+// Direct light of the emissive voxels listed around the hit, in the order
+// and with the limits of the shader: current cell, then its 6 face
+// neighbours; only lights below index 128 are deduplicated
+float emissiveLight(const std::vector<uint32_t>& grid, const std::vector<glm::uvec3>& lights,
+                    const ShaderParams& params, float gridSize, const Hit& hit) {
+    const glm::ivec3 gridDim(grid[0], grid[1], grid[2]);
+    const float cellSize = gridSize / static_cast<float>(gridDim.x);
+    const glm::ivec3 cellCoord(glm::clamp(hit.position / cellSize, glm::vec3(0.0f), glm::vec3(gridDim - 1)));
+    const uint32_t totalCells = static_cast<uint32_t>(gridDim.x * gridDim.y * gridDim.z);
+    const uint32_t lightDataStart = 4u + totalCells * 2u;
+
+    const float maxLightDist2 = 400.0f * 400.0f;
+    const uint32_t maxLights = static_cast<uint32_t>(params.params1.y);
+    uint32_t lightsProcessed = 0;
+    uint32_t processed[4] = {0u, 0u, 0u, 0u};
+    float total = 0.0f;
+
+    static const glm::ivec3 neighbors[7] = {
+        glm::ivec3(0, 0, 0), glm::ivec3(1, 0, 0), glm::ivec3(-1, 0, 0),
+        glm::ivec3(0, 1, 0), glm::ivec3(0, -1, 0), glm::ivec3(0, 0, 1), glm::ivec3(0, 0, -1)
+    };
+    for (const glm::ivec3& offset : neighbors) {
+        const glm::ivec3 cell = cellCoord + offset;
+        if (cell.x < 0 || cell.y < 0 || cell.z < 0 || cell.x >= gridDim.x || cell.y >= gridDim.y || cell.z >= gridDim.z) {
+            continue;
+        }
+
+        const uint32_t headerIdx = 4u + static_cast<uint32_t>(cell.x + cell.y * gridDim.x + cell.z * gridDim.x * gridDim.y) * 2u;
+        const uint32_t lightOffset = grid[headerIdx];
+        const uint32_t lightCount = grid[headerIdx + 1];
+        for (uint32_t i = 0; i < lightCount; ++i) {
+            const uint32_t lightIdx = grid[lightDataStart + lightOffset + i];
+            if (lightIdx < 128u) {
+                const uint32_t bit = 1u << (lightIdx % 32u);
+                if (processed[lightIdx / 32u] & bit) continue;
+                processed[lightIdx / 32u] |= bit;
+            }
+
+            const glm::vec3 toLight = glm::vec3(lights[lightIdx]) + 0.5f - hit.position;
+            const float dist2 = glm::dot(toLight, toLight);
+            if (dist2 < 1e-4f || dist2 > maxLightDist2) continue;
+
+            const float ndotl = std::max(glm::dot(hit.normal, toLight / std::sqrt(dist2)), 0.0f);
+            const float atten = 1.0f / (params.params1.x + params.params0.w * dist2);
+            total += ndotl * params.params0.z * atten; // intensity 255/255
+            if (maxLights > 0 && ++lightsProcessed >= maxLights) return total;
+        }
+    }
+    return total;
+}
+
+uint8_t toUnorm8(float v) {
+    return static_cast<uint8_t>(std::lround(std::min(std::max(v, 0.0f), 1.0f) * 255.0f));
+}
+
+} // namespace
+
+CpuRenderer::CpuRenderer(const SparseVoxelOctree& tree) : m_tree(tree) {
+    updateLights();
+}
+
+void CpuRenderer::updateLights() {
+    m_lightGrid = buildLightGrid(m_tree.getEmissiveVoxels(), 1u << m_tree.getDepth());
+}
+
+CpuImage CpuRenderer::render(const ShaderParams& params, const CameraParams& camera,
+                             uint32_t width, uint32_t height, ThreadPool& pool) const {
+    CpuImage image;
+    image.width = width;
+    image.height = height;
+    image.rgb.resize(static_cast<size_t>(width) * height * 3);
+    if (width == 0 || height == 0) return image;
+
+    // Camera, as in the shader's main()
+    const float gridSize = camera.gridSize > 0.0f ? camera.gridSize : static_cast<float>(1u << m_tree.getDepth());
+    const glm::vec3 target(gridSize * 0.5f);
+    glm::vec3 camPos, camDir;
+    if (camera.debugMask & 8u) {
+        camPos = camera.cameraPos;
+        camDir = glm::normalize(camera.cameraDir);
+    } else {
+        const bool manual = (camera.debugMask & 4u) != 0;
+        const float yaw = manual ? camera.yaw : camera.time * 0.5f;
+        const float pitch = manual ? camera.pitch : 0.4f;
+        camPos = target + camera.distance * glm::vec3(std::cos(pitch) * std::sin(yaw), std::sin(pitch),
+                                                      std::cos(pitch) * std::cos(yaw));
+        camDir = glm::normalize(target - camPos);
+    }
+    const glm::vec3 camRight = glm::normalize(glm::cross(camDir, glm::vec3(0.0f, 1.0f, 0.0f)));
+    const glm::vec3 camUp = glm::normalize(glm::cross(camRight, camDir));
+    const float aspect = static_cast<float>(width) / static_cast<float>(height);
+    const float scale = std::tan(glm::radians(camera.fov) * 0.5f);
+    const glm::vec3 toGrid = target - camPos;
+    const bool farAway = glm::length(toGrid) > gridSize * 2.0f;
+
+    const glm::vec3 keyLight = glm::normalize(glm::vec3(params.keyDir));
+    const glm::vec3 fillLight = glm::normalize(glm::vec3(params.fillDir));
+    const glm::vec3 background(params.bgColor);
+    const int debugMode = static_cast<int>(params.params1.z);
+    const std::vector<glm::uvec3>& lights = m_tree.getEmissiveVoxels();
+
+    const uint32_t tilesX = (width + kTileSize - 1) / kTileSize;
+    const uint32_t tilesY = (height + kTileSize - 1) / kTileSize;
+    pool.parallelForStealing(static_cast<size_t>(tilesX) * tilesY, [&](size_t tile) {
+        const uint32_t x0 = static_cast<uint32_t>(tile % tilesX) * kTileSize;
+        const uint32_t y0 = static_cast<uint32_t>(tile / tilesX) * kTileSize;
+        const uint32_t x1 = std::min(x0 + kTileSize, width);
+        const uint32_t y1 = std::min(y0 + kTileSize, height);
+
+        // Row-major rays of the tile trace as coherent packets
+        Ray rays[kTileSize * kTileSize];
+        RayHit hits[kTileSize * kTileSize];
+        uint32_t pixels[kTileSize * kTileSize];
+        size_t count = 0;
+        for (uint32_t y = y0; y < y1; ++y) {
+            for (uint32_t x = x0; x < x1; ++x) {
+                const float u = static_cast<float>(x) / static_cast<float>(width);
+                const float v = static_cast<float>(y) / static_cast<float>(height);
+                const glm::vec3 dir = glm::normalize(camDir + camRight * (u - 0.5f) * aspect * scale +
+                                                     camUp * (v - 0.5f) * scale);
+                uint8_t* out = &image.rgb[(static_cast<size_t>(y) * width + x) * 3];
+                if (farAway && glm::dot(dir, toGrid) < 0.0f) {
+                    // Pointing away from the grid
+                    out[0] = toUnorm8(background.x);
+                    out[1] = toUnorm8(background.y);
+                    out[2] = toUnorm8(background.z);
+                    continue;
+                }
+                rays[count] = Ray{camPos, dir, std::numeric_limits<float>::infinity()};
+                pixels[count++] = y * width + x;
+            }
+        }
+        OctreePacketTracer(m_tree).trace(rays, count, hits);
+
+        for (size_t i = 0; i < count; ++i) {
+            glm::vec3 color = background;
+            if (hits[i].hit) {
+                const uint32_t packed = hits[i].color;
+                Hit hit;
+                hit.albedo = glm::vec3((packed >> 16) & 0xFFu, (packed >> 8) & 0xFFu, packed & 0xFFu) / 255.0f;
+                hit.emissive = static_cast<float>((packed >> 24) & 0xFFu) / 255.0f;
+                hit.position = rays[i].origin + rays[i].dir * hits[i].t;
+                hit.normal = glm::vec3(hits[i].normal);
+                if (hits[i].normal == glm::ivec3(0)) {
+                    const glm::vec3 voxel(hits[i].voxel);
+                    hit.normal = boxNormal(hit.position, voxel, voxel + 1.0f);
+                }
+
+                const float keyDiffuse = std::max(glm::dot(hit.normal, keyLight), 0.0f);
+                const float fillDiffuse = std::max(glm::dot(hit.normal, fillLight), 0.0f);
+                const float lighting = glm::clamp(params.params0.x + keyDiffuse * params.keyDir.w +
+                                                  fillDiffuse * params.fillDir.w, 0.0f, 1.0f);
+                const float direct = emissiveLight(m_lightGrid, lights, params, gridSize, hit);
+                color = hit.albedo * (lighting + direct) + hit.albedo * (hit.emissive * params.params0.y);
+
+                switch (debugMode) {
+                case 1: color = glm::vec3(lighting + direct); break;
+                case 2: color = hit.albedo; break;
+                case 3: color = hit.normal * 0.5f + 0.5f; break;
+                case 4: color = glm::vec3(hit.emissive); break;
+                default: break;
+                }
+            } else if (debugMode >= 1 && debugMode <= 4) {
+                color = glm::vec3(0.0f);
+            }
+            uint8_t* out = &image.rgb[static_cast<size_t>(pixels[i]) * 3];
+            out[0] = toUnorm8(color.x);
+            out[1] = toUnorm8(color.y);
+            out[2] = toUnorm8(color.z);
+        }
+    });
+    return image;
+}
+
+ImageDiff diffImages(const CpuImage& a, const CpuImage& b, uint32_t tolerance) {
+    ImageDiff diff;
+    if (a.width != b.width || a.height != b.height || a.rgb.size() != b.rgb.size()) return diff;
+    diff.pixels = static_cast<uint64_t>(a.width) * a.height;
+    for (size_t i = 0; i + 2 < a.rgb.size(); i += 3) {
+        uint32_t delta = 0;
+        for (size_t c = 0; c < 3; ++c) {
+            delta = std::max<uint32_t>(delta, static_cast<uint32_t>(std::abs(a.rgb[i + c] - b.rgb[i + c])));
+        }
+        diff.maxDelta = std::max(diff.maxDelta, delta);
+        if (delta > tolerance) ++diff.differing;
+    }
+    return diff;
+}
+
+} // namespace vox
@@ -0,0 +1,194 @@
+#include "vox/Headless.h"
+#include "vox/CpuRenderer.h"
+#include "vox/ImageWriter.h"
+#include "vox/SceneLoader.h"
+#include "vox/ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+namespace vox {
+
+namespace {
+
+uint32_t parseUint(const char* arg) { return static_cast<uint32_t>(std::strtoul(arg, nullptr, 10)); }
+
+bool isOption(const char* arg) { return std::strncmp(arg, "--", 2) == 0; }
+
+// Takes a trailing "--paged [pageLevel]" off the arguments (pageLevel stays
+// 0 without it); false if the level is not a positive number
+bool takePagedOption(int& argc, char** argv, uint32_t& pageLevel) {
+    for (int i = 2; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--paged") != 0) continue;
+        pageLevel = i + 1 < argc ? parseUint(argv[i + 1]) : SparseVoxelOctree::kDefaultPageLevel;
+        argc = i;
+        return pageLevel != 0;
+    }
+    return true;
+}
+
+// vox --render-cpu out.png [width height [threads]] [--scene path] [--camera px py pz tx ty tz [fov]]
+int renderCpuCommand(int argc, char** argv) {
+    CpuRenderOptions options;
+    std::vector<const char*> positional;
+    for (int i = 2; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--scene") == 0 && i + 1 < argc) {
+            options.scenePath = argv[++i];
+        } else if (std::strcmp(argv[i], "--camera") == 0 && i + 6 < argc) {
+            float v[6];
+            for (float& f : v) f = std::strtof(argv[++i], nullptr);
+            options.freeCamera = true;
+            options.cameraPos = glm::vec3(v[0], v[1], v[2]);
+            options.cameraTarget = glm::vec3(v[3], v[4], v[5]);
+            if (i + 1 < argc && !isOption(argv[i + 1])) options.fov = std::strtof(argv[++i], nullptr);
+        } else if (isOption(argv[i])) {
+            positional.clear(); // unknown or incomplete option: report usage
+            break;
+        } else {
+            positional.push_back(argv[i]);
+        }
+    }
+    if (positional.size() >= 1) options.outPath = positional[0];
+    if (positional.size() >= 3) {
+        options.width = parseUint(positional[1]);
+        options.height = parseUint(positional[2]);
+    }
+    if (positional.size() >= 4) options.threads = parseUint(positional[3]);
+    if (positional.empty() || positional.size() == 2 || positional.size() > 4 || options.width == 0 ||
+        options.height == 0 || !(options.fov > 0.0f && options.fov < 180.0f) ||
+        (options.freeCamera && options.cameraPos == options.cameraTarget)) {
+        std::cerr << "usage: vox --render-cpu out.png|out.ppm [width height [threads]] [--scene path]"
+                     " [--camera px py pz tx ty tz [fov]]\n";
+        return 1;
+    }
+    return renderCpuReference(options);
+}
+
+// vox --import-raw in.raw width height depth 8|16 out.svo [threshold [max]] [--paged [pageLevel]]
+int importRawCommand(int argc, char** argv) {
+    uint32_t pageLevel = 0;
+    const bool pagedOk = takePagedOption(argc, argv, pageLevel);
+    RawVolumeDesc desc;
+    if (argc >= 8) {
+        desc.size = glm::uvec3(parseUint(argv[3]), parseUint(argv[4]), parseUint(argv[5]));
+        desc.bytesPerSample = parseUint(argv[6]) / 8;
+    }
+    if (!pagedOk || argc < 8 || desc.size.x == 0 || desc.size.y == 0 || desc.size.z == 0 ||
+        (desc.bytesPerSample != 1 && desc.bytesPerSample != 2)) {
+        std::cerr << "usage: vox --import-raw in.raw width height depth 8|16 out.svo [threshold [max]] "
+                     "[--paged [pageLevel]]\n";
+        return 1;
+    }
+    if (argc >= 9) desc.threshold = parseUint(argv[8]);
+    if (argc >= 10) desc.maxValue = parseUint(argv[9]);
+    return importRawVolume(argv[2], desc, argv[7], pageLevel);
+}
+
+// vox --generate terrain|city|points|menger out.svo [depth [seed [emissive [pointDensity]]]] [--paged [pageLevel]]
+int generateCommand(int argc, char** argv) {
+    uint32_t pageLevel = 0;
+    const bool pagedOk = takePagedOption(argc, argv, pageLevel);
+    ProceduralSceneDesc desc;
+    bool known = false;
+    for (auto scene : {ProceduralScene::Terrain, ProceduralScene::City, ProceduralScene::PointCloud,
+                       ProceduralScene::Menger}) {
+        if (argc >= 3 && std::strcmp(argv[2], proceduralSceneName(scene)) == 0) {
+            desc.scene = scene;
+            known = true;
+        }
+    }
+    if (!pagedOk || argc < 4 || !known) {
+        std::cerr << "usage: vox --generate terrain|city|points|menger out.svo "
+                     "[depth [seed [emissive [pointDensity]]]] [--paged [pageLevel]]\n";
+        return 1;
+    }
+    uint32_t depth = argc >= 5 ? parseUint(argv[4]) : 11u;
+    if (argc >= 6) desc.seed = std::strtoull(argv[5], nullptr, 10);
+    if (argc >= 7) desc.emissiveDensity = std::strtof(argv[6], nullptr);
+    if (argc >= 8) desc.pointDensity = std::strtof(argv[7], nullptr);
+    return generateScene(desc, depth, argv[3], pageLevel);
+}
+
+} // namespace
+
+int renderCpuReference(const CpuRenderOptions& options) {
+    // Loaded the way the Scene field loads it; test.vox keeps its test.svo
+    // cache and the test-scene fallback of the windowed startup
+    SceneLoadRequest request;
+    request.voxPath = options.scenePath;
+    const size_t ext = options.scenePath.rfind(".vox");
+    if (ext != std::string::npos && ext + 4 == options.scenePath.size()) {
+        request.svoPath = options.scenePath.substr(0, ext) + ".svo";
+    }
+    request.fallbackToTestScene = options.scenePath == CpuRenderOptions().scenePath;
+    std::unique_ptr<SparseVoxelOctree> octree = SceneLoader::load(request);
+    if (!octree) {
+        std::cerr << "Failed to load " << options.scenePath << std::endl;
+        return 1;
+    }
+
+    const float gridSize = static_cast<float>(1u << octree->getDepth());
+    CameraParams camera;
+    camera.gridSize = gridSize;
+    camera.fov = options.fov;
+    if (options.freeCamera) {
+        camera.debugMask = 8u;
+        camera.cameraPos = options.cameraPos;
+        camera.cameraDir = options.cameraTarget - options.cameraPos;
+    } else {
+        camera.debugMask = 4u; // fixed yaw/pitch
+        camera.distance = std::max(camera.distance, std::sqrt(3.0f) * (gridSize * 0.5f) * 1.2f);
+    }
+
+    CpuRenderer renderer(*octree);
+    ThreadPool pool(options.threads);
+    auto start = std::chrono::high_resolution_clock::now();
+    CpuImage image = renderer.render(ShaderParams{}, camera, options.width, options.height, pool);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    std::cout << "CPU reference: " << options.width << "x" << options.height << " in " << ms << " ms on "
+              << pool.size() << " workers\n";
+    return writeImage(options.outPath, image.rgb.data(), image.width, image.height) ? 0 : 1;
+}
+
+int importRawVolume(const std::string& rawPath, const RawVolumeDesc& desc, const std::string& svoPath,
+                    uint32_t pageLevel) {
+    SparseVoxelOctree octree(SparseVoxelOctree::kRawBlockLevels); // grows to fit the volume
+    if (pageLevel != 0) octree.setPagedBuild(svoPath, pageLevel);
+    auto start = std::chrono::high_resolution_clock::now();
+    if (!octree.loadFromRawVolume(rawPath, desc)) return 1;
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    std::cout << "Raw volume import: " << ms << " ms\n";
+    return pageLevel != 0 || octree.saveSvoFile(svoPath, 0) ? 0 : 1;
+}
+
+int generateScene(const ProceduralSceneDesc& desc, uint32_t depth, const std::string& svoPath, uint32_t pageLevel) {
+    SparseVoxelOctree octree(depth);
+    if (pageLevel != 0) octree.setPagedBuild(svoPath, pageLevel);
+    auto start = std::chrono::high_resolution_clock::now();
+    if (!octree.generateProceduralScene(desc)) return 1;
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    std::cout << "Procedural scene: " << ms << " ms\n";
+    return pageLevel != 0 || octree.saveSvoFile(svoPath, 0) ? 0 : 1;
+}
+
+int runHeadlessCommand(int argc, char** argv) {
+    if (argc < 2) return -1;
+    if (std::strcmp(argv[1], "--render-cpu") == 0) return renderCpuCommand(argc, argv);
+    if (std::strcmp(argv[1], "--import-raw") == 0) return importRawCommand(argc, argv);
+    if (std::strcmp(argv[1], "--generate") == 0) return generateCommand(argc, argv);
+    return -1;
+}
+
+void printHeadlessUsage() {
+    std::cerr << "usage: vox --render-cpu out.png|out.ppm [width height [threads]] [--scene path]"
+                 " [--camera px py pz tx ty tz [fov]]\n"
+                 "       vox --import-raw in.raw width height depth 8|16 out.svo [threshold [max]] [--paged [pageLevel]]\n"
+                 "       vox --generate terrain|city|points|menger out.svo "
+                 "[depth [seed [emissive [pointDensity]]]] [--paged [pageLevel]]\n";
+}
+
+} // namespace vox
@@ -0,0 +1,56 @@
+#include "vox/LightGrid.h"
+
+namespace vox {
+
+std::vector<uint32_t> buildLightGrid(const std::vector<glm::uvec3>& emissiveVoxels, uint32_t gridSize) {
+    const uint32_t gridDim = kLightGridDim;
+    const uint32_t totalCells = gridDim * gridDim * gridDim;
+    const float cellSize = static_cast<float>(gridSize) / gridDim;
+    const float lightRadius = cellSize * 1.5f; // Lights affect 1.5 cell radius
+
+    // Build spatial grid: for each cell, collect lights within range
+    std::vector<std::vector<uint32_t>> cellLights(totalCells);
+
+    for (uint32_t lightIdx = 0; lightIdx < emissiveVoxels.size(); ++lightIdx) {
+        glm::vec3 lightPos = glm::vec3(emissiveVoxels[lightIdx]) + 0.5f;
+
+        // Determine which cells this light affects
+        glm::ivec3 minCell = glm::max(glm::ivec3((lightPos - lightRadius) / cellSize), glm::ivec3(0));
+        glm::ivec3 maxCell = glm::min(glm::ivec3((lightPos + lightRadius) / cellSize), glm::ivec3(gridDim - 1));
+
+        for (int z = minCell.z; z <= maxCell.z; ++z) {
+            for (int y = minCell.y; y <= maxCell.y; ++y) {
+                for (int x = minCell.x; x <= maxCell.x; ++x) {
+                    uint32_t cellIdx = x + y * gridDim + z * gridDim * gridDim;
+                    cellLights[cellIdx].push_back(lightIdx);
+                }
+            }
+        }
+    }
+
+    // Build buffer data: [gridDim.x, .y, .z, totalLightCount] + [cell offsets/counts] + [light indices]
+    std::vector<uint32_t> gridData;
+    gridData.push_back(gridDim);
+    gridData.push_back(gridDim);
+    gridData.push_back(gridDim);
+    gridData.push_back(static_cast<uint32_t>(emissiveVoxels.size()));
+
+    // Reserve space for cell headers: [offset, count] per cell
+    uint32_t cellHeaderOffset = static_cast<uint32_t>(gridData.size());
+    gridData.resize(gridData.size() + totalCells * 2); // offset + count per cell
+
+    // Write light indices
+    uint32_t lightDataOffset = static_cast<uint32_t>(gridData.size());
+    for (uint32_t cellIdx = 0; cellIdx < totalCells; ++cellIdx) {
+        uint32_t offset = static_cast<uint32_t>(gridData.size()) - lightDataOffset;
+        uint32_t count = static_cast<uint32_t>(cellLights[cellIdx].size());
+
+        gridData[cellHeaderOffset + cellIdx * 2] = offset;
+        gridData[cellHeaderOffset + cellIdx * 2 + 1] = count;
+
+        gridData.insert(gridData.end(), cellLights[cellIdx].begin(), cellLights[cellIdx].end());
+    }
+    return gridData;
+}
+
+} // namespace vox
@@ -0,0 +1,85 @@
+#include "vox/MappedFile.h"
+#include <fstream>
+#include <iostream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace vox {
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const std::string& path) {
+    close();
+
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st{};
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+    m_size = static_cast<size_t>(st.st_size);
+    if (m_size == 0) {
+        ::close(fd);
+        return false;
+    }
+
+    void* addr = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps its own reference
+    if (addr == MAP_FAILED) {
+        std::cerr << "mmap failed: " << path << std::endl;
+        m_size = 0;
+        return false;
+    }
+    m_data = static_cast<const uint8_t*>(addr);
+    m_mapped = true;
+    return true;
+#else
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) return false;
+    m_size = static_cast<size_t>(file.tellg());
+    if (m_size == 0) return false;
+    m_fallback.resize(m_size);
+    file.seekg(0);
+    if (!file.read(reinterpret_cast<char*>(m_fallback.data()), m_size)) {
+        m_fallback.clear();
+        m_size = 0;
+        return false;
+    }
+    m_data = m_fallback.data();
+    return true;
+#endif
+}
+
+void MappedFile::close() {
+#ifndef _WIN32
+    if (m_mapped && m_data) {
+        munmap(const_cast<uint8_t*>(m_data), m_size);
+    }
+#endif
+    m_data = nullptr;
+    m_size = 0;
+    m_mapped = false;
+    m_fallback.clear();
+    m_fallback.shrink_to_fit();
+}
+
+uint64_t MappedFile::hash() const {
+    uint64_t h = 0xCBF29CE484222325ull;
+    for (size_t i = 0; i < m_size; ++i) {
+        h ^= m_data[i];
+        h *= 0x100000001B3ull;
+    }
+    return h;
+}
+
+} // namespace vox
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "vox/SparseVoxelOctree.h"
+#include <cstddef>
+
+namespace vox {
+namespace packet {
+
+// Per-ISA packet kernels (OctreePacketTracerSse41.cpp, ...Avx2.cpp). A
+// kernel whose instruction set the compiler cannot target is not built; its
+// entry point then falls back to the scalar raycast().
+void traceSse41(const SparseVoxelOctree& tree, const Ray* rays, size_t count, RayHit* hits);
+void traceAvx2(const SparseVoxelOctree& tree, const Ray* rays, size_t count, RayHit* hits);
+extern const bool kSse41Built;
+extern const bool kAvx2Built;
+
+} // namespace packet
+} // namespace vox
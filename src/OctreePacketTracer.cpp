@@ -0,0 +1,90 @@
+#include "vox/OctreePacketTracer.h"
+#include "OctreePacketKernel.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <immintrin.h>
+#define VOX_CPUID_MSVC 1
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#define VOX_CPUID_GNU 1
+#endif
+
+namespace vox {
+
+namespace {
+
+struct CpuFeatures {
+    bool sse41 = false;
+    bool avx2 = false;
+};
+
+CpuFeatures queryCpuFeatures() {
+    CpuFeatures features;
+    unsigned int leaf1[4] = {};
+    unsigned int leaf7[4] = {};
+    unsigned long long xcr0 = 0;
+#if defined(VOX_CPUID_MSVC)
+    int regs[4];
+    __cpuid(regs, 0);
+    const int maxLeaf = regs[0];
+    __cpuid(regs, 1);
+    for (int i = 0; i < 4; ++i) leaf1[i] = static_cast<unsigned int>(regs[i]);
+    if (maxLeaf >= 7) {
+        __cpuidex(regs, 7, 0);
+        for (int i = 0; i < 4; ++i) leaf7[i] = static_cast<unsigned int>(regs[i]);
+    }
+    if (leaf1[2] & (1u << 27)) xcr0 = _xgetbv(0);
+#elif defined(VOX_CPUID_GNU)
+    const unsigned int maxLeaf = __get_cpuid_max(0, nullptr);
+    __cpuid(1, leaf1[0], leaf1[1], leaf1[2], leaf1[3]);
+    if (maxLeaf >= 7) __cpuid_count(7, 0, leaf7[0], leaf7[1], leaf7[2], leaf7[3]);
+    if (leaf1[2] & (1u << 27)) {
+        unsigned int lo, hi;
+        __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+        xcr0 = (static_cast<unsigned long long>(hi) << 32) | lo;
+    }
+#endif
+    // AVX state (XMM and YMM) must also be enabled by the OS (OSXSAVE + XCR0)
+    const bool osAvx = (leaf1[2] & (1u << 28)) && (xcr0 & 6u) == 6u;
+    features.sse41 = (leaf1[2] & (1u << 19)) != 0;
+    features.avx2 = osAvx && (leaf7[1] & (1u << 5)) != 0;
+    return features;
+}
+
+} // namespace
+
+PacketKernel detectPacketKernel() {
+    static const CpuFeatures features = queryCpuFeatures();
+    if (packet::kAvx2Built && features.avx2) return PacketKernel::Avx2;
+    if (packet::kSse41Built && features.sse41) return PacketKernel::Sse41;
+    return PacketKernel::Scalar;
+}
+
+OctreePacketTracer::OctreePacketTracer(const SparseVoxelOctree& tree, PacketKernel kernel)
+    : m_tree(tree), m_kernel(kernel) {
+    const PacketKernel best = detectPacketKernel();
+    if (static_cast<uint32_t>(m_kernel) > static_cast<uint32_t>(best)) m_kernel = best;
+}
+
+uint32_t OctreePacketTracer::packetWidth() const {
+    switch (m_kernel) {
+    case PacketKernel::Avx2: return 8;
+    case PacketKernel::Sse41: return 4;
+    default: return 1;
+    }
+}
+
+void OctreePacketTracer::trace(const Ray* rays, size_t count, RayHit* hits) const {
+    if (m_tree.getNodes().empty()) {
+        m_tree.raycast(rays, count, hits);
+        return;
+    }
+    switch (m_kernel) {
+    case PacketKernel::Avx2: packet::traceAvx2(m_tree, rays, count, hits); break;
+    case PacketKernel::Sse41: packet::traceSse41(m_tree, rays, count, hits); break;
+    default: m_tree.raycast(rays, count, hits); break;
+    }
+}
+
+} // namespace vox
@@ -0,0 +1,83 @@
+// AVX2 packet kernel: 8 rays per packet (see OctreePacketTraversal.h)
+#include "OctreePacketKernel.h"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+namespace vox {
+namespace {
+
+struct Avx2Lanes {
+    using F = __m256;
+    static constexpr int kWidth = 8;
+    static F set1(float v) { return _mm256_set1_ps(v); }
+    static F load(const float* p) { return _mm256_load_ps(p); }
+    static void store(float* p, F v) { _mm256_store_ps(p, v); }
+    static F add(F a, F b) { return _mm256_add_ps(a, b); }
+    static F sub(F a, F b) { return _mm256_sub_ps(a, b); }
+    static F mul(F a, F b) { return _mm256_mul_ps(a, b); }
+    static F div(F a, F b) { return _mm256_div_ps(a, b); }
+    static F min(F a, F b) { return _mm256_min_ps(a, b); }
+    static F max(F a, F b) { return _mm256_max_ps(a, b); }
+    static F floor(F a) { return _mm256_floor_ps(a); }
+    static F cmpeq(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+    static F cmplt(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    static F cmpgt(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+    static F cmpge(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+    static F andMask(F a, F b) { return _mm256_and_ps(a, b); }
+    static F orMask(F a, F b) { return _mm256_or_ps(a, b); }
+    static F andNot(F a, F b) { return _mm256_andnot_ps(a, b); } // ~a & b
+    static F blend(F a, F b, F mask) { return _mm256_blendv_ps(a, b, mask); } // mask ? b : a
+    static int laneBits(F mask) { return _mm256_movemask_ps(mask); }
+};
+
+} // namespace
+} // namespace vox
+
+#include "OctreePacketTraversal.h"
+
+namespace vox {
+namespace {
+void traceAvx2Packets(const SparseVoxelOctree& tree, const Ray* rays, size_t count, RayHit* hits) {
+    tracePackets<Avx2Lanes>(tree, rays, count, hits);
+}
+} // namespace
+} // namespace vox
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+namespace vox {
+namespace packet {
+const bool kAvx2Built = true;
+void traceAvx2(const SparseVoxelOctree& tree, const Ray* rays, size_t count, RayHit* hits) {
+    traceAvx2Packets(tree, rays, count, hits);
+}
+} // namespace packet
+} // namespace vox
+
+#else
+
+namespace vox {
+namespace packet {
+const bool kAvx2Built = false;
+void traceAvx2(const SparseVoxelOctree& tree, const Ray* rays, size_t count, RayHit* hits) {
+    tree.raycast(rays, count, hits);
+}
+} // namespace packet
+} // namespace vox
+
+#endif
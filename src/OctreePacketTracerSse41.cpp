@@ -0,0 +1,83 @@
+// SSE4.1 packet kernel: 4 rays per packet (see OctreePacketTraversal.h)
+#include "OctreePacketKernel.h"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("sse4.1"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("sse4.1")
+#endif
+
+namespace vox {
+namespace {
+
+struct Sse41Lanes {
+    using F = __m128;
+    static constexpr int kWidth = 4;
+    static F set1(float v) { return _mm_set1_ps(v); }
+    static F load(const float* p) { return _mm_load_ps(p); }
+    static void store(float* p, F v) { _mm_store_ps(p, v); }
+    static F add(F a, F b) { return _mm_add_ps(a, b); }
+    static F sub(F a, F b) { return _mm_sub_ps(a, b); }
+    static F mul(F a, F b) { return _mm_mul_ps(a, b); }
+    static F div(F a, F b) { return _mm_div_ps(a, b); }
+    static F min(F a, F b) { return _mm_min_ps(a, b); }
+    static F max(F a, F b) { return _mm_max_ps(a, b); }
+    static F floor(F a) { return _mm_floor_ps(a); }
+    static F cmpeq(F a, F b) { return _mm_cmpeq_ps(a, b); }
+    static F cmplt(F a, F b) { return _mm_cmplt_ps(a, b); }
+    static F cmpgt(F a, F b) { return _mm_cmpgt_ps(a, b); }
+    static F cmpge(F a, F b) { return _mm_cmpge_ps(a, b); }
+    static F andMask(F a, F b) { return _mm_and_ps(a, b); }
+    static F orMask(F a, F b) { return _mm_or_ps(a, b); }
+    static F andNot(F a, F b) { return _mm_andnot_ps(a, b); } // ~a & b
+    static F blend(F a, F b, F mask) { return _mm_blendv_ps(a, b, mask); } // mask ? b : a
+    static int laneBits(F mask) { return _mm_movemask_ps(mask); }
+};
+
+} // namespace
+} // namespace vox
+
+#include "OctreePacketTraversal.h"
+
+namespace vox {
+namespace {
+void traceSse41Packets(const SparseVoxelOctree& tree, const Ray* rays, size_t count, RayHit* hits) {
+    tracePackets<Sse41Lanes>(tree, rays, count, hits);
+}
+} // namespace
+} // namespace vox
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+namespace vox {
+namespace packet {
+const bool kSse41Built = true;
+void traceSse41(const SparseVoxelOctree& tree, const Ray* rays, size_t count, RayHit* hits) {
+    traceSse41Packets(tree, rays, count, hits);
+}
+} // namespace packet
+} // namespace vox
+
+#else
+
+namespace vox {
+namespace packet {
+const bool kSse41Built = false;
+void traceSse41(const SparseVoxelOctree& tree, const Ray* rays, size_t count, RayHit* hits) {
+    tree.raycast(rays, count, hits);
+}
+} // namespace packet
+} // namespace vox
+
+#endif
@@ -0,0 +1,184 @@
+#pragma once
+
+// Packet traversal shared by the per-ISA kernels. A kernel translation unit
+// includes its intrinsics and every standard header first, switches the
+// compiler's target for the rest of the file, defines its lane traits and
+// then includes this header. All of it has internal linkage, so no
+// out-of-line copy built for a wider ISA can be linked into other files.
+
+#include "vox/SparseVoxelOctree.h"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace vox {
+namespace {
+
+// V is the lane traits type: a register F of V::kWidth floats and the ops
+// below; comparison results are all-ones lane masks. Step for step this
+// mirrors traceRay() in SparseVoxelOctree.cpp, with the slab test of
+// intersectAABB() in raytrace.comp, so every lane returns what the scalar
+// raycast() returns.
+template <class V>
+void tracePackets(const SparseVoxelOctree& tree, const Ray* rays, size_t count, RayHit* hits) {
+    using F = typename V::F;
+    constexpr int W = V::kWidth;
+    const uint32_t gridSize = 1u << tree.getDepth();
+    const float gridMax = static_cast<float>(gridSize);
+    const uint32_t* colors = tree.getColors().data();
+    const size_t colorCount = tree.getColors().size();
+
+    const F zero = V::set1(0.0f);
+    const F one = V::set1(1.0f);
+    const F minusOne = V::set1(-1.0f);
+    const F grid = V::set1(gridMax);
+    const F gridLast = V::set1(gridMax - 1.0f);
+    const F inf = V::set1(std::numeric_limits<float>::infinity());
+    const F allLanes = V::cmpeq(zero, zero);
+
+    // Each lane resumes from the first cell of its previous ray
+    OctreeCursor start[W];
+    OctreeCursor cursor[W];
+
+    alignas(32) float lane[3][W];
+    alignas(32) float laneMin[3][W];
+    alignas(32) float laneSize[W];
+    alignas(32) float laneT[W];
+    alignas(32) float laneNormal[3][W];
+    alignas(32) float laneMaxT[W];
+
+    for (size_t first = 0; first < count; first += W) {
+        const int n = count - first < static_cast<size_t>(W) ? static_cast<int>(count - first) : W;
+
+        // Transpose to one register per axis; short packets repeat their last ray
+        F origin[3], dir[3], invDir[3], positive[3], flat[3];
+        for (int a = 0; a < 3; ++a) {
+            for (int i = 0; i < W; ++i) lane[a][i] = rays[first + (i < n ? i : n - 1)].origin[a];
+            origin[a] = V::load(lane[a]);
+            for (int i = 0; i < W; ++i) lane[a][i] = rays[first + (i < n ? i : n - 1)].dir[a];
+            dir[a] = V::load(lane[a]);
+            invDir[a] = V::div(one, dir[a]);
+            positive[a] = V::cmpgt(dir[a], zero);
+            flat[a] = V::cmpeq(dir[a], zero);
+        }
+        for (int i = 0; i < W; ++i) laneMaxT[i] = rays[first + (i < n ? i : n - 1)].maxT;
+        const F maxT = V::load(laneMaxT);
+
+        // Clip to the grid: the last axis whose entry plane raises t gives the first normal
+        F t = zero;
+        F tExit = maxT;
+        F active = allLanes;
+        F entry[3] = { zero, zero, zero };
+        for (int a = 0; a < 3; ++a) {
+            const F outside = V::orMask(V::cmplt(origin[a], zero), V::cmpge(origin[a], grid));
+            active = V::andNot(V::andMask(flat[a], outside), active);
+            const F tNear = V::mul(V::sub(V::blend(grid, zero, positive[a]), origin[a]), invDir[a]);
+            const F tFar = V::mul(V::sub(V::blend(zero, grid, positive[a]), origin[a]), invDir[a]);
+            const F raises = V::andNot(flat[a], V::cmpgt(tNear, t));
+            for (int b = 0; b < a; ++b) entry[b] = V::andNot(raises, entry[b]);
+            entry[a] = raises;
+            t = V::blend(t, tNear, raises);
+            tExit = V::blend(V::min(tExit, tFar), tExit, flat[a]);
+        }
+        active = V::andNot(V::cmpgt(t, tExit), active);
+
+        F cell[3], normal[3];
+        for (int a = 0; a < 3; ++a) {
+            const F p = V::floor(V::add(origin[a], V::mul(dir[a], t)));
+            cell[a] = V::blend(V::min(V::max(p, zero), gridLast), V::blend(gridLast, zero, positive[a]), entry[a]);
+            normal[a] = V::blend(zero, V::blend(one, minusOne, positive[a]), entry[a]);
+        }
+
+        for (int i = 0; i < n; ++i) {
+            hits[first + i] = RayHit{};
+            cursor[i] = start[i];
+        }
+        uint32_t pending = static_cast<uint32_t>(V::laneBits(active)) & ((1u << n) - 1u);
+        bool firstStep = true;
+
+        while (pending) {
+            for (int a = 0; a < 3; ++a) {
+                V::store(lane[a], cell[a]);
+                V::store(laneNormal[a], normal[a]);
+            }
+            V::store(laneT, t);
+
+            // Node fetches stay scalar; coherent lanes mostly share the node
+            // the previous lane fetched
+            uint32_t shared = 0;
+            glm::uvec3 sharedMin(0u);
+            uint32_t sharedSize = 0;
+            bool haveShared = false;
+            for (int i = 0; i < n; ++i) {
+                if (!(pending & (1u << i))) continue;
+                const glm::uvec3 c(static_cast<uint32_t>(lane[0][i]), static_cast<uint32_t>(lane[1][i]),
+                                   static_cast<uint32_t>(lane[2][i]));
+                uint32_t data;
+                uint32_t size;
+                glm::uvec3 nodeMin;
+                if (haveShared && c.x - sharedMin.x < sharedSize && c.y - sharedMin.y < sharedSize &&
+                    c.z - sharedMin.z < sharedSize) {
+                    data = shared;
+                    size = sharedSize;
+                    nodeMin = sharedMin;
+                } else {
+                    data = tree.descend(c, cursor[i]);
+                    size = gridSize >> cursor[i].depth;
+                    nodeMin = c & glm::uvec3(~(size - 1u));
+                    shared = data;
+                    sharedSize = size;
+                    sharedMin = nodeMin;
+                    haveShared = true;
+                }
+                if (firstStep) start[i] = cursor[i];
+
+                if (data & OctreeNode::LEAF_BIT) {
+                    const uint32_t colorIdx = data & OctreeNode::PAYLOAD_MASK;
+                    RayHit& hit = hits[first + i];
+                    hit.hit = true;
+                    hit.t = laneT[i];
+                    hit.voxel = c;
+                    hit.normal = glm::ivec3(static_cast<int>(laneNormal[0][i]), static_cast<int>(laneNormal[1][i]),
+                                            static_cast<int>(laneNormal[2][i]));
+                    hit.color = colorIdx < colorCount ? colors[colorIdx] : 0u;
+                    pending &= ~(1u << i);
+                    continue;
+                }
+                for (int a = 0; a < 3; ++a) laneMin[a][i] = static_cast<float>(nodeMin[a]);
+                laneSize[i] = static_cast<float>(size);
+            }
+            firstStep = false;
+            if (!pending) break;
+
+            // Empty nodes: leave each box through its nearest exit plane
+            const F size = V::load(laneSize);
+            F nodeMin[3], tPlane[3];
+            for (int a = 0; a < 3; ++a) {
+                nodeMin[a] = V::load(laneMin[a]);
+                const F plane = V::blend(nodeMin[a], V::add(nodeMin[a], size), positive[a]);
+                tPlane[a] = V::blend(V::mul(V::sub(plane, origin[a]), invDir[a]), inf, flat[a]);
+            }
+            const F tNext = V::min(tPlane[0], V::min(tPlane[1], tPlane[2]));
+            F live = V::andNot(V::cmpgt(tNext, maxT), allLanes);
+
+            // Exit axes step by exactly one cell; the others stay inside the node's slab
+            for (int a = 0; a < 3; ++a) {
+                const F exits = V::cmpeq(tPlane[a], tNext);
+                const F stepped = V::blend(V::sub(nodeMin[a], one), V::add(nodeMin[a], size), positive[a]);
+                const F leaves = V::andMask(exits, V::orMask(V::cmplt(stepped, zero), V::cmpge(stepped, grid)));
+                live = V::andNot(leaves, live);
+
+                const F p = V::floor(V::add(origin[a], V::mul(dir[a], tNext)));
+                const F inside = V::min(V::max(p, nodeMin[a]), V::add(nodeMin[a], V::sub(size, one)));
+                cell[a] = V::blend(inside, stepped, exits);
+                for (int b = 0; b < 3; ++b) normal[b] = V::blend(normal[b], zero, exits);
+                normal[a] = V::blend(normal[a], V::blend(one, minusOne, positive[a]), exits);
+            }
+            t = tNext;
+            pending &= static_cast<uint32_t>(V::laneBits(live));
+        }
+    }
+}
+
+} // namespace
+} // namespace vox
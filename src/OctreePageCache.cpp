@@ -0,0 +1,172 @@
+#include "vox/OctreePageCache.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+namespace vox {
+
+bool OctreePageCache::open(const std::string& path, size_t budgetBytes) {
+    m_file.close();
+    m_file.clear();
+    m_index.clear();
+    m_slots.clear();
+    m_lru.clear();
+    m_residentBytes = 0;
+    m_budgetBytes = budgetBytes;
+
+    m_file.open(path, std::ios::binary);
+    if (!m_file) return false;
+
+    OctreePageFileHeader header{};
+    if (!m_file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion) {
+        std::cerr << "Unsupported page file (magic/version): " << path << std::endl;
+        m_file.close();
+        return false;
+    }
+
+    m_index.resize(header.pageCount);
+    m_file.seekg(static_cast<std::streamoff>(header.indexOffset));
+    if (!m_file.read(reinterpret_cast<char*>(m_index.data()),
+                     static_cast<std::streamsize>(m_index.size() * sizeof(OctreePageEntry)))) {
+        std::cerr << "Truncated page index: " << path << std::endl;
+        m_index.clear();
+        m_file.close();
+        return false;
+    }
+    for (const OctreePageEntry& entry : m_index) {
+        if (entry.nodeCount > header.maxPageNodes || entry.offset >= header.indexOffset) {
+            std::cerr << "Corrupt page index: " << path << std::endl;
+            m_index.clear();
+            m_file.close();
+            return false;
+        }
+    }
+    m_maxPageNodes = header.maxPageNodes;
+    m_slots.resize(m_index.size());
+
+    std::cout << "Opened page file " << path << ": " << m_index.size() << " pages of up to "
+              << m_maxPageNodes << " nodes, " << (m_budgetBytes >> 20) << " MB host cache" << std::endl;
+    return true;
+}
+
+std::shared_ptr<const OctreePage> OctreePageCache::acquire(uint32_t page) {
+    if (page >= m_slots.size()) return nullptr;
+
+    Slot& slot = m_slots[page];
+    if (slot.page) {
+        m_lru.splice(m_lru.begin(), m_lru, slot.lru);
+        m_hits++;
+        return slot.page;
+    }
+
+    const OctreePageEntry& entry = m_index[page];
+    auto loaded = std::make_shared<OctreePage>();
+    loaded->nodes.resize(entry.nodeCount);
+    loaded->lodColors.resize(entry.nodeCount);
+    const std::streamsize bytes = static_cast<std::streamsize>(entry.nodeCount * sizeof(uint32_t));
+    m_file.clear();
+    m_file.seekg(static_cast<std::streamoff>(entry.offset));
+    if (!m_file.read(reinterpret_cast<char*>(loaded->nodes.data()), bytes) ||
+        !m_file.read(reinterpret_cast<char*>(loaded->lodColors.data()), bytes)) {
+        std::cerr << "Failed to read octree page " << page << std::endl;
+        return nullptr;
+    }
+    m_misses++;
+
+    slot.page = loaded;
+    m_lru.push_front(page);
+    slot.lru = m_lru.begin();
+    m_residentBytes += 2 * static_cast<size_t>(bytes);
+
+    // Evict from the cold end; the page just loaded always stays
+    while (m_residentBytes > m_budgetBytes && m_lru.size() > 1) {
+        Slot& victim = m_slots[m_lru.back()];
+        m_residentBytes -= 2 * victim.page->nodes.size() * sizeof(uint32_t);
+        victim.page.reset();
+        m_lru.pop_back();
+    }
+    return slot.page;
+}
+
+OctreePageWriter::~OctreePageWriter() {
+    discard();
+}
+
+void OctreePageWriter::discard() {
+    if (!m_file.is_open()) return;
+    m_file.close();
+    std::remove((m_path + ".tmp").c_str());
+}
+
+bool OctreePageWriter::open(const std::string& path) {
+    discard();
+    m_path = path;
+    m_index.clear();
+    m_header = {};
+    std::memcpy(m_header.magic, OctreePageCache::kMagic, sizeof(m_header.magic));
+    m_header.version = OctreePageCache::kVersion;
+
+    const std::string tmpPath = path + ".tmp";
+    m_file.clear();
+    m_file.open(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!m_file) {
+        std::cerr << "Failed to create page file: " << tmpPath << std::endl;
+        return false;
+    }
+    m_file.write(reinterpret_cast<const char*>(&m_header), sizeof(m_header));
+    m_written = sizeof(m_header);
+    return true;
+}
+
+void OctreePageWriter::align() {
+    static const char zeros[kAlignment] = {};
+    const uint64_t target = (m_written + kAlignment - 1) & ~(kAlignment - 1);
+    m_file.write(zeros, static_cast<std::streamsize>(target - m_written));
+    m_written = target;
+}
+
+bool OctreePageWriter::append(const OctreePage& page) {
+    if (!m_file.is_open()) return false;
+    align();
+    m_index.push_back({m_written, static_cast<uint32_t>(page.nodes.size()), 0u});
+    const size_t bytes = page.nodes.size() * sizeof(uint32_t);
+    m_file.write(reinterpret_cast<const char*>(page.nodes.data()), static_cast<std::streamsize>(bytes));
+    m_file.write(reinterpret_cast<const char*>(page.lodColors.data()), static_cast<std::streamsize>(bytes));
+    m_written += 2 * bytes;
+    m_header.maxPageNodes = std::max(m_header.maxPageNodes, static_cast<uint32_t>(page.nodes.size()));
+    if (!m_file) {
+        std::cerr << "Failed to write page file: " << m_path << ".tmp" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool OctreePageWriter::finish() {
+    if (!m_file.is_open()) return false;
+    align();
+    m_header.pageCount = static_cast<uint32_t>(m_index.size());
+    m_header.indexOffset = m_written;
+    m_file.write(reinterpret_cast<const char*>(m_index.data()),
+                 static_cast<std::streamsize>(m_index.size() * sizeof(OctreePageEntry)));
+    m_written += m_index.size() * sizeof(OctreePageEntry);
+    m_file.seekp(0);
+    m_file.write(reinterpret_cast<const char*>(&m_header), sizeof(m_header));
+    m_file.close();
+
+    const std::string tmpPath = m_path + ".tmp";
+    if (!m_file) {
+        std::cerr << "Failed to write page file: " << tmpPath << std::endl;
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    if (std::rename(tmpPath.c_str(), m_path.c_str()) != 0) {
+        std::cerr << "Failed to move page file into place: " << m_path << std::endl;
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace vox
@@ -0,0 +1,118 @@
+#include "vox/SceneLoader.h"
+#include "vox/MappedFile.h"
+#include <iostream>
+
+namespace vox {
+
+SceneLoader::SceneLoader() = default;
+
+SceneLoader::~SceneLoader() {
+    m_cancel.store(true, std::memory_order_relaxed);
+}
+
+bool SceneLoader::start(const SceneLoadRequest& request) {
+    bool idle = false;
+    if (!m_busy.compare_exchange_strong(idle, true, std::memory_order_acq_rel)) return false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_result.reset();
+    }
+    setStatus("Queued " + request.voxPath);
+    m_worker.submit([this, request] {
+        auto tree = load(request, [this](const std::string& stage) { setStatus(stage); }, &m_cancel);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_status = tree ? "Loaded " + request.voxPath : "Failed to load " + request.voxPath;
+            m_result = std::move(tree);
+            m_resultRequest = request;
+        }
+        m_busy.store(false, std::memory_order_release);
+    });
+    return true;
+}
+
+std::unique_ptr<SparseVoxelOctree> SceneLoader::takeResult(SceneLoadRequest* request) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (request && m_result) *request = m_resultRequest;
+    return std::move(m_result);
+}
+
+std::string SceneLoader::status() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_status;
+}
+
+void SceneLoader::setStatus(const std::string& status) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_status = status;
+}
+
+std::unique_ptr<SparseVoxelOctree> SceneLoader::load(const SceneLoadRequest& request,
+                                                     const std::function<void(const std::string&)>& progress,
+                                                     const std::atomic<bool>* cancel) {
+    auto report = [&](const std::string& stage) {
+        if (progress) progress(stage);
+    };
+    auto cancelled = [&] { return cancel && cancel->load(std::memory_order_relaxed); };
+
+    // A prebuilt .svo has no source to import or check against
+    const std::string& path = request.voxPath;
+    if (path.size() >= 4 && path.compare(path.size() - 4, 4, ".svo") == 0) {
+        report("Reading " + path);
+        auto tree = std::make_unique<SparseVoxelOctree>(request.depth);
+        tree->setNodeOrder(request.nodeOrder);
+        if (!tree->loadFromSvoFile(path)) return nullptr;
+        if (tree->isPagedTop()) {
+            std::cerr << path << " is the top of a paged octree; open it as one instead" << std::endl;
+            return nullptr;
+        }
+        if (!request.diffSource && tree->getLodColors().size() != tree->getNodes().size()) tree->computeLodColors();
+        return tree;
+    }
+
+    uint64_t sourceHash = 0;
+    {
+        MappedFile source;
+        // Keyed by the requested depth too: a cache built at another depth is rebuilt
+        if (source.open(request.voxPath)) sourceHash = (source.hash() ^ request.depth) * 0x100000001B3ull;
+    }
+
+    // The cache only counts if it was processed the way this request asks
+    auto tree = std::make_unique<SparseVoxelOctree>(request.depth);
+    tree->setNodeOrder(request.nodeOrder);
+    if (sourceHash != 0 && !request.svoPath.empty()) {
+        report("Reading " + request.svoPath);
+        if (tree->loadFromSvoFile(request.svoPath, sourceHash) &&
+            tree->hasMergedSubtrees() == request.mergeIdenticalSubtrees && tree->getNodeOrder() == request.nodeOrder) {
+            if (!request.diffSource && tree->getLodColors().size() != tree->getNodes().size()) tree->computeLodColors();
+            return tree;
+        }
+        tree = std::make_unique<SparseVoxelOctree>(request.depth);
+        tree->setNodeOrder(request.nodeOrder);
+    }
+    if (cancelled()) return nullptr;
+
+    report("Importing " + request.voxPath);
+    const bool isObj = path.size() >= 4 && path.compare(path.size() - 4, 4, ".obj") == 0;
+    if (!(isObj ? tree->loadFromObjFile(path, request.solidFill) : tree->loadFromVoxFile(path))) {
+        if (!request.fallbackToTestScene) return nullptr;
+        std::cerr << "Failed to load " << request.voxPath << ", using test scene instead" << std::endl;
+        report("Building test scene");
+        tree->generateTestScene();
+        sourceHash = 0;
+    }
+    if (cancelled()) return nullptr;
+
+    if (request.mergeIdenticalSubtrees) {
+        report("Merging identical subtrees");
+        tree->mergeIdenticalSubtrees();
+    }
+    if (sourceHash != 0 && !request.svoPath.empty() && !cancelled()) {
+        report("Writing " + request.svoPath);
+        tree->saveSvoFile(request.svoPath, sourceHash, request.cacheFormat);
+    }
+    if (!request.diffSource && tree->getLodColors().size() != tree->getNodes().size()) tree->computeLodColors();
+    return tree;
+}
+
+} // namespace vox
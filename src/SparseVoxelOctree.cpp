@@ -1,9 +1,24 @@
 #include "vox/SparseVoxelOctree.h"
+#include "vox/ThreadPool.h"
+#include "vox/MappedFile.h"
+#include "vox/OctreePageCache.h"
 #include <queue>
 #include <fstream>
 #include <iostream>
 #include <iomanip>
+#include <cstddef>
 #include <cstring>
+#include <cstdio>
+#include <algorithm>
+#include <deque>
+#include <atomic>
+#include <functional>
+#include <limits>
+#include <cmath>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
 
 namespace vox {
 
@@ -14,6 +29,16 @@ static uint32_t packColor(uint8_t r, uint8_t g, uint8_t b, uint8_t emissive) {
            static_cast<uint32_t>(b);
 }
 
+// Node word with the leaf-only homogeneous flag dropped, for comparing leaves
+static uint32_t plainWord(uint32_t data) {
+    return (data & OctreeNode::LEAF_BIT) ? (data & ~OctreeNode::HOMOGENEOUS_BIT) : data;
+}
+
+// Internal word whose payload is a slot in the far pointer table
+static bool isFarWord(uint32_t data) {
+    return !(data & OctreeNode::LEAF_BIT) && (data & OctreeNode::FAR_BIT);
+}
+
 SparseVoxelOctree::SparseVoxelOctree(uint32_t depth) 
     : m_depth(depth) {
     // Allocate root node
@@ -21,361 +46,2082 @@ SparseVoxelOctree::SparseVoxelOctree(uint32_t depth)
 }
 
 uint32_t SparseVoxelOctree::getOrAddColor(uint32_t color) {
-    auto it = m_colorToIndex.find(color);
-    if (it != m_colorToIndex.end()) {
-        return it->second;
+    const uint32_t next = static_cast<uint32_t>(m_colors.size());
+    uint32_t idx = m_colorToIndex.findOrInsert(color, next);
+    if (idx == next) {
+        m_colors.push_back(color);
+        m_colorsDirtyBegin = std::min<size_t>(m_colorsDirtyBegin, idx);
     }
-    uint32_t idx = static_cast<uint32_t>(m_colors.size());
-    m_colors.push_back(color);
-    m_colorToIndex[color] = idx;
     return idx;
 }
 
 void SparseVoxelOctree::setVoxel(glm::uvec3 pos, uint32_t color) {
+    fillBox(pos, pos, color);
+}
+
+void SparseVoxelOctree::clearVoxel(glm::uvec3 pos) {
+    clearBox(pos, pos);
+}
+
+void SparseVoxelOctree::fillBox(glm::uvec3 minCorner, glm::uvec3 maxCorner, uint32_t color) {
+    if (rejectPagedTop("fillBox")) return;
+    const uint32_t gridMax = (1u << m_depth) - 1;
+    maxCorner = glm::min(maxCorner, glm::uvec3(gridMax));
+    if (minCorner.x > maxCorner.x || minCorner.y > maxCorner.y || minCorner.z > maxCorner.z) return;
+
     uint32_t colorIdx = getOrAddColor(color);
+    // Filling acts on whole leaf cells, so the lights it replaces do too
+    eraseEmissiveIn(minCorner & glm::uvec3(~1u), maxCorner | glm::uvec3(1u));
+    if ((color & 0xFF000000u) != 0u) addEmissiveShell(minCorner >> 1u, maxCorner >> 1u);
+    editBox(minCorner, maxCorner, OctreeNode::LEAF_BIT | colorIdx);
+}
+
+void SparseVoxelOctree::clearBox(glm::uvec3 minCorner, glm::uvec3 maxCorner) {
+    if (rejectPagedTop("clearBox")) return;
+    const uint32_t gridMax = (1u << m_depth) - 1;
+    maxCorner = glm::min(maxCorner, glm::uvec3(gridMax));
+    if (minCorner.x > maxCorner.x || minCorner.y > maxCorner.y || minCorner.z > maxCorner.z) return;
+
+    // Clearing acts on whole leaf cells, so widen to them for the light list
+    eraseEmissiveIn(minCorner & glm::uvec3(~1u), maxCorner | glm::uvec3(1u));
+    editBox(minCorner, maxCorner, 0u);
+}
+
+bool SparseVoxelOctree::applyDiff(const SparseVoxelOctree& target, size_t* changedRegions) {
+    if (changedRegions) *changedRegions = 0;
+    if (rejectPagedTop("applyDiff")) return false;
+    if (target.m_depth != m_depth || target.m_pagedTop) {
+        std::cerr << "applyDiff: target tree has depth " << target.m_depth << " (paged: " << target.m_pagedTop
+                  << "), expected " << m_depth << std::endl;
+        return false;
+    }
+
+    // Read both trees first: a region is recorded where the target is
+    // uniform (a leaf or empty) and this tree is not the same value there.
+    // A uniform node of this tree against an internal target node stands in
+    // for all of its children.
+    struct Pending {
+        uint32_t ours;
+        uint32_t theirs;
+        glm::uvec3 min;
+        uint32_t size;
+    };
+    struct Region {
+        glm::uvec3 min;
+        uint32_t size;
+        uint32_t color;
+        bool solid;
+    };
+    std::vector<Region> regions;
+    std::vector<Pending> stack;
+    stack.push_back({m_nodes[0].data, target.m_nodes[0].data, glm::uvec3(0), 1u << m_depth});
+    while (!stack.empty()) {
+        const Pending p = stack.back();
+        stack.pop_back();
+        const uint32_t ourChild = childPointer(p.ours);
+        const uint32_t theirChild = target.childPointer(p.theirs);
+        if (theirChild == 0) {
+            const bool solid = (p.theirs & OctreeNode::LEAF_BIT) != 0;
+            const uint32_t color = solid ? target.m_colors[p.theirs & OctreeNode::PAYLOAD_MASK] : 0u;
+            if (ourChild == 0) {
+                const bool ourSolid = (p.ours & OctreeNode::LEAF_BIT) != 0;
+                if (ourSolid == solid && (!solid || m_colors[p.ours & OctreeNode::PAYLOAD_MASK] == color)) continue;
+            }
+            regions.push_back({p.min, p.size, color, solid});
+            continue;
+        }
+        const uint32_t half = p.size / 2;
+        for (uint32_t c = 0; c < 8; ++c) {
+            const glm::uvec3 childMin = p.min + glm::uvec3((c >> 2) & 1u, (c >> 1) & 1u, c & 1u) * half;
+            const uint32_t ours = ourChild ? m_nodes[ourChild + c].data : p.ours;
+            stack.push_back({ours, target.m_nodes[theirChild + c].data, childMin, half});
+        }
+    }
+
+    for (const Region& r : regions) {
+        const uint32_t leafWord = r.solid ? (OctreeNode::LEAF_BIT | getOrAddColor(r.color)) : 0u;
+        editBox(r.min, r.min + glm::uvec3(r.size - 1), leafWord);
+    }
+    if (m_emissiveVoxels != target.m_emissiveVoxels) {
+        m_emissiveVoxels = target.m_emissiveVoxels;
+        m_emissiveDirty = true;
+    }
+    if (changedRegions) *changedRegions = regions.size();
+    return true;
+}
+
+void SparseVoxelOctree::eraseEmissiveIn(glm::uvec3 boxMin, glm::uvec3 boxMax) {
+    auto inside = [&](const glm::uvec3& p) {
+        return p.x >= boxMin.x && p.y >= boxMin.y && p.z >= boxMin.z &&
+               p.x <= boxMax.x && p.y <= boxMax.y && p.z <= boxMax.z;
+    };
+    auto it = std::remove_if(m_emissiveVoxels.begin(), m_emissiveVoxels.end(), inside);
+    if (it != m_emissiveVoxels.end()) {
+        m_emissiveVoxels.erase(it, m_emissiveVoxels.end());
+        m_emissiveDirty = true;
+    }
+}
+
+// One light per leaf cell, at the cell origin, and only on the shell of the
+// filled box: its inner cells are enclosed by the box itself. Large shells
+// are sampled on a coarser lattice (always keeping the corners and faces),
+// so one edit adds at most kMaxEditLights.
+void SparseVoxelOctree::addEmissiveShell(glm::uvec3 cellMin, glm::uvec3 cellMax) {
+    auto points = [](uint32_t lo, uint32_t hi, uint32_t stride) -> uint64_t {
+        return (static_cast<uint64_t>(hi - lo) + stride - 1) / stride + 1;
+    };
+    auto shell = [&](uint32_t stride) {
+        const uint64_t x = points(cellMin.x, cellMax.x, stride);
+        const uint64_t y = points(cellMin.y, cellMax.y, stride);
+        const uint64_t z = points(cellMin.z, cellMax.z, stride);
+        auto inner = [](uint64_t k) { return k > 2 ? k - 2 : 0; };
+        return x * y * z - inner(x) * inner(y) * inner(z);
+    };
+    uint32_t stride = 1;
+    while (shell(stride) > kMaxEditLights) stride *= 2;
+
+    auto axis = [stride](uint32_t lo, uint32_t hi) {
+        std::vector<uint32_t> coords;
+        for (uint64_t c = lo; c < hi; c += stride) coords.push_back(static_cast<uint32_t>(c));
+        coords.push_back(hi);
+        return coords;
+    };
+    const std::vector<uint32_t> xs = axis(cellMin.x, cellMax.x);
+    const std::vector<uint32_t> ys = axis(cellMin.y, cellMax.y);
+    const std::vector<uint32_t> zs = axis(cellMin.z, cellMax.z);
+    for (size_t k = 0; k < zs.size(); ++k) {
+        for (size_t j = 0; j < ys.size(); ++j) {
+            // Rows inside the y/z faces only meet the shell at their two ends
+            const bool face = k == 0 || k + 1 == zs.size() || j == 0 || j + 1 == ys.size();
+            const size_t step = face ? 1 : std::max<size_t>(xs.size() - 1, 1);
+            for (size_t i = 0; i < xs.size(); i += step) {
+                m_emissiveVoxels.push_back(glm::uvec3(xs[i], ys[j], zs[k]) * 2u);
+            }
+        }
+    }
+    m_emissiveDirty = true;
+}
+
+void SparseVoxelOctree::editBox(glm::uvec3 minCorner, glm::uvec3 maxCorner, uint32_t leafWord) {
+    dropCachedEncoding();
+    if (m_lodColors.size() != m_nodes.size()) m_lodColors.clear();
+    editNode(0, glm::uvec3(0), 1u << m_depth, minCorner, maxCorner, leafWord);
+}
+
+bool SparseVoxelOctree::editNode(uint32_t nodeIdx, glm::uvec3 nodeMin, uint32_t nodeSize,
+                                 glm::uvec3 boxMin, glm::uvec3 boxMax, uint32_t leafWord) {
+    const glm::uvec3 nodeMax = nodeMin + glm::uvec3(nodeSize - 1);
+    if (nodeMax.x < boxMin.x || nodeMax.y < boxMin.y || nodeMax.z < boxMin.z ||
+        nodeMin.x > boxMax.x || nodeMin.y > boxMax.y || nodeMin.z > boxMax.z) {
+        return false;
+    }
+
+    const bool lod = !m_lodColors.empty();
+    const uint32_t data = m_nodes[nodeIdx].data;
+
+    // Fully covered nodes (and any touched leaf cell) take the edit directly;
+    // a replaced subtree is left for compactNodes() to reclaim
+    const bool covered = nodeSize <= 2 ||
+        (nodeMin.x >= boxMin.x && nodeMin.y >= boxMin.y && nodeMin.z >= boxMin.z &&
+         nodeMax.x <= boxMax.x && nodeMax.y <= boxMax.y && nodeMax.z <= boxMax.z);
+    if (covered) {
+        if (plainWord(data) == leafWord) return false;
+        releaseFarSlot(data);
+        m_nodes[nodeIdx].data = leafWord;
+        if (lod) m_lodColors[nodeIdx] = filterLodColor(leafWord);
+        markNodesDirty(nodeIdx, nodeIdx + 1);
+        return true;
+    }
+
+    // Partially covered: make sure this node owns a child block to edit
+    uint32_t childPtr = childPointer(data);
+    if (data & OctreeNode::LEAF_BIT) {
+        const uint32_t leaf = data & ~OctreeNode::HOMOGENEOUS_BIT;
+        if (leaf == leafWord) return false; // already uniformly this value
+        const uint32_t words[8] = { leaf, leaf, leaf, leaf, leaf, leaf, leaf, leaf };
+        childPtr = appendChildBlock(words, nullptr);
+    } else if (childPtr == 0) {
+        if (leafWord == 0) return false;
+        const uint32_t words[8] = {};
+        childPtr = appendChildBlock(words, nullptr);
+    } else if (childPtr < m_sharedBlockLimit) {
+        uint32_t words[8], lods[8] = {};
+        for (uint32_t c = 0; c < 8; ++c) {
+            words[c] = m_nodes[childPtr + c].data;
+            if (lod) lods[c] = m_lodColors[childPtr + c];
+            // The copy gets far slots of its own, so every slot has one owner
+            if (isFarWord(words[c])) words[c] = editPointerWord(childPointer(words[c]), 0u);
+        }
+        childPtr = appendChildBlock(words, lods);
+        m_childOrderBroken = true;
+    }
+    if (childPtr == 0) return false;
+
+    // Recurse only into the octants the box reaches
+    const uint32_t half = nodeSize / 2;
+    const glm::uvec3 mid = nodeMin + glm::uvec3(half);
+    auto halves = [](uint32_t lo, uint32_t hi, uint32_t m) { return (lo < m ? 1u : 0u) | (hi >= m ? 2u : 0u); };
+    const uint32_t hx = halves(boxMin.x, boxMax.x, mid.x);
+    const uint32_t hy = halves(boxMin.y, boxMax.y, mid.y);
+    const uint32_t hz = halves(boxMin.z, boxMax.z, mid.z);
+    bool changed = childPtr != childPointer(data); // expanded or copied block
+    for (uint32_t c = 0; c < 8; ++c) {
+        const uint32_t cx = (c >> 2) & 1u, cy = (c >> 1) & 1u, cz = c & 1u;
+        if (!(hx & (1u << cx)) || !(hy & (1u << cy)) || !(hz & (1u << cz))) continue;
+        changed |= editNode(childPtr + c, nodeMin + glm::uvec3(cx, cy, cz) * half, half, boxMin, boxMax, leafWord);
+    }
+    if (!changed) return false;
+
+    // Prune emptied blocks and collapse uniform ones like markHomogeneousNodes
+    const uint32_t first = plainWord(m_nodes[childPtr].data);
+    bool uniform = first == 0 || (first & OctreeNode::LEAF_BIT);
+    for (uint32_t c = 1; c < 8 && uniform; ++c) {
+        uniform = plainWord(m_nodes[childPtr + c].data) == first;
+    }
+    uint32_t newData = data;
+    if (uniform) {
+        newData = first ? (first | OctreeNode::HOMOGENEOUS_BIT) : 0u;
+        releaseFarSlot(data);
+    } else if (childPtr != childPointer(data)) {
+        newData = editPointerWord(childPtr, data);
+    }
+
+    m_nodes[nodeIdx].data = newData;
+    if (lod) m_lodColors[nodeIdx] = filterLodColor(newData);
+    markNodesDirty(nodeIdx, nodeIdx + 1);
+    return true;
+}
+
+uint32_t SparseVoxelOctree::appendChildBlock(const uint32_t* words, const uint32_t* lodColors) {
+    const size_t ptr = m_nodes.size();
+    if (ptr + 8 > UINT32_MAX) {
+        std::cerr << "Octree edit: node count exceeds 32-bit node indices" << std::endl;
+        return 0;
+    }
+    m_levelOffsets.clear(); // appended blocks break the level-major layout
+    for (uint32_t c = 0; c < 8; ++c) m_nodes.push_back({words[c]});
+    if (!m_lodColors.empty()) {
+        for (uint32_t c = 0; c < 8; ++c) {
+            m_lodColors.push_back(lodColors ? lodColors[c] : filterLodColor(words[c]));
+        }
+    }
+    markNodesDirty(ptr, ptr + 8);
+    return static_cast<uint32_t>(ptr);
+}
+
+uint32_t SparseVoxelOctree::packChildBlock(const uint32_t* words) {
+    const uint32_t first = plainWord(words[0]);
+    bool uniform = first == 0 || (first & OctreeNode::LEAF_BIT);
+    for (uint32_t c = 1; c < 8 && uniform; ++c) {
+        uniform = plainWord(words[c]) == first;
+    }
+    if (uniform) return first ? (first | OctreeNode::HOMOGENEOUS_BIT) : 0u;
+    const uint32_t child = appendChildBlock(words, nullptr);
+    return child ? pointerWord(child, m_farPointers) : 0u;
+}
+
+uint32_t SparseVoxelOctree::pointerWord(uint32_t child, std::vector<uint32_t>& farPointers) const {
+    if (child < m_farPointerBase) return child;
+    farPointers.push_back(child);
+    return OctreeNode::FAR_BIT | static_cast<uint32_t>(farPointers.size() - 1);
+}
+
+// Edits keep the far table from growing with every edit: the slot of the
+// word being replaced is rewritten in place, and slots of collapsed nodes
+// are reused before new ones are appended
+uint32_t SparseVoxelOctree::editPointerWord(uint32_t child, uint32_t oldData) {
+    if (child < m_farPointerBase) {
+        releaseFarSlot(oldData);
+        return child;
+    }
+    uint32_t slot = 0;
+    if (isFarWord(oldData)) {
+        slot = oldData & OctreeNode::PAYLOAD_MASK;
+    } else if (!m_freeFarSlots.empty()) {
+        slot = m_freeFarSlots.back();
+        m_freeFarSlots.pop_back();
+    } else {
+        return pointerWord(child, m_farPointers);
+    }
+    m_farPointers[slot] = child;
+    m_farDirtyBegin = std::min<size_t>(m_farDirtyBegin, slot);
+    return OctreeNode::FAR_BIT | slot;
+}
+
+void SparseVoxelOctree::releaseFarSlot(uint32_t data) {
+    if (isFarWord(data)) m_freeFarSlots.push_back(data & OctreeNode::PAYLOAD_MASK);
+}
+
+// Spread the low 21 bits of v so that bit i lands on bit 3*i
+static uint64_t spreadBits3(uint64_t v) {
+    v &= 0x1FFFFFull;
+    v = (v | (v << 32)) & 0x1F00000000FFFFull;
+    v = (v | (v << 16)) & 0x1F0000FF0000FFull;
+    v = (v | (v << 8))  & 0x100F00F00F00F00Full;
+    v = (v | (v << 4))  & 0x10C30C30C30C30C3ull;
+    v = (v | (v << 2))  & 0x1249249249249249ull;
+    return v;
+}
+
+// Morton code of a leaf cell. Each 3-bit group is a child index (x*4 + y*2 + z),
+// root octant in the highest group, so sorted codes are in depth-first order.
+static uint64_t mortonEncode(glm::uvec3 cell) {
+    return (spreadBits3(cell.x) << 2) | (spreadBits3(cell.y) << 1) | spreadBits3(cell.z);
+}
+
+struct MortonEntry {
+    uint64_t code;
+    uint32_t colorIdx;
+};
+
+// LSD radix sort on the low codeBits of the code; stable, so later duplicates stay later
+static void radixSortByCode(MortonEntry* entries, size_t count, uint32_t codeBits) {
+    if (count < 2) return;
+    std::vector<MortonEntry> tmp(count);
+    MortonEntry* src = entries;
+    MortonEntry* dst = tmp.data();
+    for (uint32_t shift = 0; shift < codeBits; shift += 8) {
+        size_t offsets[257] = {};
+        for (size_t i = 0; i < count; ++i) offsets[((src[i].code >> shift) & 0xFFu) + 1]++;
+        for (int i = 0; i < 256; ++i) offsets[i + 1] += offsets[i];
+        for (size_t i = 0; i < count; ++i) dst[offsets[(src[i].code >> shift) & 0xFFu]++] = src[i];
+        std::swap(src, dst);
+    }
+    if (src != entries) std::copy(src, src + count, entries);
+}
+
+// Index of the highest differing 3-bit group between two codes (0 = leaf level)
+static uint32_t highestDifferingGroup(uint64_t a, uint64_t b) {
+    uint64_t diff = a ^ b;
+    uint32_t bit = 63;
+    while (!(diff >> bit)) --bit;
+    return bit / 3;
+}
+
+// Count distinct nodes per level in a Morton-sorted run whose entries all share
+// their ancestors above firstLevel. counts[l] is incremented for l in [firstLevel, levels].
+static void countLevelNodes(const MortonEntry* entries, size_t count, uint32_t levels,
+                            uint32_t firstLevel, uint64_t* counts) {
+    if (count == 0) return;
+    // Consecutive codes share all ancestors above their highest differing group
+    std::vector<uint64_t> newNodesFrom(levels + 1, 0);
+    newNodesFrom[firstLevel] = 1;
+    for (size_t i = 1; i < count; ++i) {
+        if (entries[i].code == entries[i - 1].code) continue;
+        newNodesFrom[levels - highestDifferingGroup(entries[i].code, entries[i - 1].code)]++;
+    }
+    uint64_t running = 0;
+    for (uint32_t l = firstLevel; l <= levels; ++l) {
+        running += newNodesFrom[l];
+        counts[l] += running;
+    }
+}
+
+// Write nodes for levels [firstLevel, lastLevel] of a Morton-sorted run.
+// ordinals[l] is the ordinal of the most recent node at level l; on entry,
+// ordinals[firstLevel - 1] is the run's parent and deeper slots hold start - 1.
+// With blockOrdinals, internal nodes hold 1 + the ordinal of their child block
+// within the next level instead of its index (resolved after a wide build).
+static void emitLevels(const MortonEntry* entries, size_t count, uint32_t levels,
+                       uint32_t firstLevel, uint32_t lastLevel, const uint64_t* levelOffsets,
+                       uint64_t* ordinals, OctreeNode* nodes, bool blockOrdinals) {
+    uint32_t lastLeaf = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const uint64_t code = entries[i].code;
+        const uint32_t leafData = OctreeNode::LEAF_BIT | entries[i].colorIdx;
+
+        if (i > 0 && code == entries[i - 1].code) {
+            nodes[lastLeaf].data = leafData;
+            continue;
+        }
+
+        uint32_t firstNew = (i == 0) ? firstLevel : levels - highestDifferingGroup(code, entries[i - 1].code);
+        for (uint32_t l = firstNew; l <= lastLevel; ++l) {
+            ++ordinals[l];
+            uint32_t octant = static_cast<uint32_t>(code >> (3 * (levels - l))) & 7u;
+            uint32_t idx = static_cast<uint32_t>(levelOffsets[l] + 8 * ordinals[l - 1] + octant);
+            if (l < levels) {
+                nodes[idx].data = blockOrdinals ? static_cast<uint32_t>(ordinals[l] + 1)
+                                                : static_cast<uint32_t>(levelOffsets[l + 1] + 8 * ordinals[l]);
+            } else {
+                nodes[idx].data = leafData;
+                lastLeaf = idx;
+            }
+        }
+    }
+}
+
+// Run fn(i) for i in [0, count), on the pool when there is one
+static void forEachIndex(ThreadPool* pool, size_t count, const std::function<void(size_t)>& fn) {
+    if (pool) {
+        pool->parallelFor(count, fn);
+    } else {
+        for (size_t i = 0; i < count; ++i) fn(i);
+    }
+}
+
+void SparseVoxelOctree::setBuildThreads(uint32_t threads, uint32_t splitLevel) {
+    m_buildThreads = threads;
+    m_buildSplitLevel = std::max(1u, std::min(splitLevel, 4u));
+}
+
+void SparseVoxelOctree::setPagedBuild(const std::string& basePath, uint32_t pageLevel) {
+    m_pagedBuildPath = basePath;
+    m_pagedBuildLevel = pageLevel;
+}
+
+void SparseVoxelOctree::clearTree() {
+    m_nodes.assign(1, {0});
+    m_farPointers.clear();
+    m_freeFarSlots.clear();
+    m_colors.clear();
+    m_colorToIndex.clear();
+    m_emissiveVoxels.clear();
+    m_levelOffsets.clear();
+    m_mergedSubtrees = false;
+    m_sharedBlocks = false;
+    m_pagedTop = false;
+    m_lodColors.clear();
+    dropCachedEncoding();
+    m_sharedBlockLimit = 0;
+    m_childOrderBroken = false;
+    markAllNodesDirty();
+    m_colorsDirtyBegin = 0;
+    m_farDirtyBegin = 0;
+    m_emissiveDirty = true;
+}
+
+void SparseVoxelOctree::buildFromVoxels(const Voxel* voxels, size_t count) {
+    buildFromVoxels(voxels, count, nullptr, 0);
+}
+
+void SparseVoxelOctree::buildFromVoxels(const Voxel* voxels, size_t count,
+                                        const uint32_t* palette, size_t paletteSize) {
+    clearTree();
 
-    if ((color & 0xFF000000u) != 0u) {
-        m_emissiveVoxels.push_back(pos);
+    // Leaves cover 2x2x2 voxels (setVoxel never descends on bit 0), so the
+    // tree has m_depth - 1 levels below the root.
+    const uint32_t levels = m_depth - 1;
+    if (levels == 0 || levels > 21) {
+        std::cerr << "buildFromVoxels: unsupported octree depth " << m_depth << std::endl;
+        return;
     }
+    const uint32_t gridSize = 1u << m_depth;
 
-    uint32_t nodeIdx = 0;
-    // Descend 7 levels (bits 7 down to 1), then mark bit-0 node as leaf
-    for (int level = m_depth - 1; level > 0; --level) {  
-        OctreeNode& node = m_nodes[nodeIdx];
-        
-        // Compute which child (0-7)
-        uint32_t childIdx = ((pos.x >> level) & 1) * 4 + 
-                            ((pos.y >> level) & 1) * 2 + 
-                            ((pos.z >> level) & 1);
+    // Parallel mode partitions the sorted leaves by their top splitLevel octants.
+    // Every stage below produces the same bytes as the serial build (split 0).
+    static constexpr size_t kMinParallelVoxels = 1u << 16;
+    const uint32_t threads = m_buildThreads ? m_buildThreads : std::max(1u, std::thread::hardware_concurrency());
+    std::unique_ptr<ThreadPool> pool;
+    uint32_t split = 0;
+    if (threads > 1 && count >= kMinParallelVoxels && levels > 1) {
+        pool = std::make_unique<ThreadPool>(threads);
+        split = std::min(m_buildSplitLevel, levels - 1);
+    }
+
+    // Resolve colors in input order so palette indices match the setVoxel path.
+    // Chunks collect their unique colors locally; merging them in chunk order
+    // reproduces the serial first-occurrence order. Palette input dedupes by
+    // index through a flat array and hashes each palette entry once at merge.
+    const size_t chunkCount = pool ? std::min<size_t>(count, pool->size() * 4) : 1;
+    const size_t chunkSize = chunkCount ? (count + chunkCount - 1) / chunkCount : 0;
+    struct ChunkColors {
+        std::vector<uint32_t> unique; // RGB colors, or palette indices
+        std::vector<uint32_t> remap;
+        std::vector<glm::uvec3> emissive;
+        size_t outOfRange = 0;
+    };
+    std::vector<ChunkColors> chunks(chunkCount);
+    std::vector<MortonEntry> entries(count);
+    forEachIndex(pool.get(), chunkCount, [&](size_t c) {
+        ChunkColors& chunk = chunks[c];
+        ColorTable local;
+        std::vector<uint32_t> localOfEntry(palette ? paletteSize : 0, ColorTable::kNotFound);
+        size_t end = std::min(count, (c + 1) * chunkSize);
+        for (size_t i = c * chunkSize; i < end; ++i) {
+            const Voxel& v = voxels[i];
+            if (v.pos.x >= gridSize || v.pos.y >= gridSize || v.pos.z >= gridSize ||
+                (palette && v.color >= paletteSize)) {
+                entries[i] = {~0ull, 0};
+                chunk.outOfRange++;
+                continue;
+            }
+            const uint32_t color = palette ? palette[v.color] : v.color;
+            if ((color & 0xFF000000u) != 0u) {
+                chunk.emissive.push_back(v.pos);
+            }
+            const uint32_t next = static_cast<uint32_t>(chunk.unique.size());
+            uint32_t localIdx;
+            if (palette) {
+                localIdx = localOfEntry[v.color];
+                if (localIdx == ColorTable::kNotFound) localOfEntry[v.color] = localIdx = next;
+            } else {
+                localIdx = local.findOrInsert(color, next);
+            }
+            if (localIdx == next) chunk.unique.push_back(v.color);
+            glm::uvec3 cell(v.pos.x >> 1, v.pos.y >> 1, v.pos.z >> 1);
+            entries[i] = {mortonEncode(cell), localIdx};
+        }
+    });
+    size_t outOfRange = 0;
+    for (auto& chunk : chunks) {
+        chunk.remap.reserve(chunk.unique.size());
+        for (uint32_t key : chunk.unique) chunk.remap.push_back(getOrAddColor(palette ? palette[key] : key));
+        m_emissiveVoxels.insert(m_emissiveVoxels.end(), chunk.emissive.begin(), chunk.emissive.end());
+        outOfRange += chunk.outOfRange;
+    }
+    forEachIndex(pool.get(), chunkCount, [&](size_t c) {
+        size_t end = std::min(count, (c + 1) * chunkSize);
+        for (size_t i = c * chunkSize; i < end; ++i) {
+            if (entries[i].code != ~0ull) entries[i].colorIdx = chunks[c].remap[entries[i].colorIdx];
+        }
+    });
+    if (outOfRange) {
+        entries.erase(std::remove_if(entries.begin(), entries.end(),
+                                     [](const MortonEntry& e) { return e.code == ~0ull; }),
+                      entries.end());
+    }
+    if (entries.empty()) return;
+
+    // Partition by the top split groups with a stable counting sort, then
+    // radix-sort the remaining bits of each partition independently
+    const uint32_t lowBits = 3 * (levels - split);
+    const size_t partitionCount = size_t(1) << (3 * split);
+    std::vector<size_t> partitionStart(partitionCount + 1, 0);
+    if (partitionCount == 1) {
+        partitionStart[1] = entries.size();
+    } else {
+        const size_t n = entries.size();
+        const size_t sortChunkSize = (n + chunkCount - 1) / chunkCount;
+        std::vector<std::vector<size_t>> histograms(chunkCount, std::vector<size_t>(partitionCount, 0));
+        forEachIndex(pool.get(), chunkCount, [&](size_t c) {
+            size_t end = std::min(n, (c + 1) * sortChunkSize);
+            for (size_t i = c * sortChunkSize; i < end; ++i) histograms[c][entries[i].code >> lowBits]++;
+        });
+        size_t running = 0;
+        for (size_t p = 0; p < partitionCount; ++p) {
+            partitionStart[p] = running;
+            for (size_t c = 0; c < chunkCount; ++c) {
+                size_t h = histograms[c][p];
+                histograms[c][p] = running;
+                running += h;
+            }
+        }
+        partitionStart[partitionCount] = running;
+        std::vector<MortonEntry> scattered(n);
+        forEachIndex(pool.get(), chunkCount, [&](size_t c) {
+            size_t end = std::min(n, (c + 1) * sortChunkSize);
+            for (size_t i = c * sortChunkSize; i < end; ++i) {
+                scattered[histograms[c][entries[i].code >> lowBits]++] = entries[i];
+            }
+        });
+        entries.swap(scattered);
+    }
+    forEachIndex(pool.get(), partitionCount, [&](size_t p) {
+        radixSortByCode(entries.data() + partitionStart[p], partitionStart[p + 1] - partitionStart[p], lowBits);
+    });
+
+    // The first entry of each non-empty partition stands in for its level-split node
+    std::vector<size_t> nonEmpty;
+    std::vector<MortonEntry> leaders;
+    for (size_t p = 0; p < partitionCount; ++p) {
+        if (partitionStart[p + 1] == partitionStart[p]) continue;
+        nonEmpty.push_back(p);
+        leaders.push_back(entries[partitionStart[p]]);
+    }
 
-        // Extract children pointer (mask out flag bits)
-        uint32_t childPtr = node.data & 0x3FFFFFFFu;
-        
-        if (!childPtr) {
-            // Create 8 empty children
-            childPtr = (uint32_t)m_nodes.size();
-            node.data = childPtr;
-            for (int i = 0; i < 8; ++i) m_nodes.push_back({0});
+    // Count nodes per level: levels up to split from the leaders, deeper levels
+    // per partition so each partition knows where its nodes start
+    std::vector<uint64_t> levelCounts(levels + 1, 0);
+    levelCounts[0] = 1;
+    if (split > 0) {
+        // Leaders differ only in their top split groups; count them as a split-level tree
+        std::vector<MortonEntry> leaderKeys(leaders);
+        for (auto& e : leaderKeys) e.code >>= lowBits;
+        countLevelNodes(leaderKeys.data(), leaderKeys.size(), split, 1, levelCounts.data());
+    }
+    std::vector<std::vector<uint64_t>> partitionCounts(nonEmpty.size(), std::vector<uint64_t>(levels + 1, 0));
+    forEachIndex(pool.get(), nonEmpty.size(), [&](size_t k) {
+        size_t p = nonEmpty[k];
+        countLevelNodes(entries.data() + partitionStart[p], partitionStart[p + 1] - partitionStart[p],
+                        levels, split + 1, partitionCounts[k].data());
+    });
+    std::vector<std::vector<uint64_t>> partitionOrdinals(nonEmpty.size(), std::vector<uint64_t>(levels + 1, 0));
+    for (size_t k = 0; k < nonEmpty.size(); ++k) {
+        partitionOrdinals[k][split] = k;
+        for (uint32_t l = split + 1; l <= levels; ++l) {
+            partitionOrdinals[k][l] = levelCounts[l] - 1;
+            levelCounts[l] += partitionCounts[k][l];
         }
+    }
 
-        nodeIdx = childPtr + childIdx;
+    // Level l holds one 8-child block per level l-1 node, levels stored root-first
+    std::vector<uint64_t> levelOffsets(levels + 2, 0);
+    levelOffsets[1] = 1;
+    for (uint32_t l = 1; l <= levels; ++l) {
+        levelOffsets[l + 1] = levelOffsets[l] + 8 * levelCounts[l - 1];
+    }
+    const uint64_t totalNodes = levelOffsets[levels + 1];
+    if (totalNodes > UINT32_MAX) {
+        std::cerr << "buildFromVoxels: " << totalNodes << " nodes exceed 32-bit node indices" << std::endl;
+        return;
     }
+    m_nodes.assign(totalNodes, {0});
+    m_nodes[0].data = static_cast<uint32_t>(levelOffsets[1]);
 
-    // Leaf: store color index
-    m_nodes[nodeIdx].data = OctreeNode::LEAF_BIT | colorIdx;
+    // Past the 30-bit payload some children need far pointers. Their slots
+    // are assigned in one serial pass afterwards so the table does not
+    // depend on the thread schedule.
+    const bool wide = totalNodes > m_farPointerBase;
+    if (split > 0) {
+        std::vector<uint64_t> ordinals(levels + 1, ~0ull);
+        ordinals[0] = 0;
+        emitLevels(leaders.data(), leaders.size(), levels, 1, split, levelOffsets.data(),
+                   ordinals.data(), m_nodes.data(), wide);
+    }
+    forEachIndex(pool.get(), nonEmpty.size(), [&](size_t k) {
+        size_t p = nonEmpty[k];
+        emitLevels(entries.data() + partitionStart[p], partitionStart[p + 1] - partitionStart[p],
+                   levels, split + 1, levels, levelOffsets.data(), partitionOrdinals[k].data(), m_nodes.data(), wide);
+    });
+    if (wide) {
+        for (uint32_t l = 1; l < levels; ++l) {
+            for (uint64_t i = levelOffsets[l]; i < levelOffsets[l + 1]; ++i) {
+                const uint32_t data = m_nodes[i].data;
+                if (data == 0 || (data & OctreeNode::LEAF_BIT)) continue;
+                const uint64_t child = levelOffsets[l + 1] + 8 * uint64_t(data - 1);
+                m_nodes[i].data = pointerWord(static_cast<uint32_t>(child), m_farPointers);
+            }
+        }
+        std::cout << "Octree has " << totalNodes << " nodes: " << m_farPointers.size() << " far pointers" << std::endl;
+    }
+
+    m_levelOffsets.assign(levelOffsets.begin(), levelOffsets.end());
 }
 
 void SparseVoxelOctree::generateTestScene() {
     // Translate the small test clusters so they are centered inside the SVO
     glm::uvec3 base(120u, 120u, 120u);
 
+    std::vector<Voxel> voxels;
+    auto add = [&](glm::uvec3 pos, uint32_t color) { voxels.push_back({pos, color}); };
+
     // Create a few test voxel blocks at different positions (all offset by base)
     // Red base block
     for (int x = 0; x < 4; ++x)
         for (int y = 0; y < 4; ++y)
             for (int z = 0; z < 4; ++z)
-                setVoxel({(uint32_t)x + base.x, (uint32_t)y + base.y, (uint32_t)z + base.z}, 0xFF0000);
+                add({(uint32_t)x + base.x, (uint32_t)y + base.y, (uint32_t)z + base.z}, 0xFF0000);
 
     // Green block to the side
     for (int x = 8; x < 12; ++x)
         for (int y = 0; y < 4; ++y)
             for (int z = 0; z < 4; ++z)
-                setVoxel({(uint32_t)x + base.x, (uint32_t)y + base.y, (uint32_t)z + base.z}, 0x00FF00);
+                add({(uint32_t)x + base.x, (uint32_t)y + base.y, (uint32_t)z + base.z}, 0x00FF00);
 
     // Blue block higher
     for (int x = 4; x < 8; ++x)
         for (int y = 8; y < 12; ++y)
             for (int z = 4; z < 8; ++z)
-                setVoxel({(uint32_t)x + base.x, (uint32_t)y + base.y, (uint32_t)z + base.z}, 0x0000FF);
+                add({(uint32_t)x + base.x, (uint32_t)y + base.y, (uint32_t)z + base.z}, 0x0000FF);
 
     // Yellow block
     for (int x = 0; x < 8; ++x)
         for (int y = 12; y < 16; ++y)
             for (int z = 0; z < 4; ++z)
-                setVoxel({(uint32_t)x + base.x, (uint32_t)y + base.y, (uint32_t)z + base.z}, 0xFFFF00);
+                add({(uint32_t)x + base.x, (uint32_t)y + base.y, (uint32_t)z + base.z}, 0xFFFF00);
 
     // Magenta pillar
     for (int x = 16; x < 20; ++x)
         for (int y = 0; y < 16; ++y)
             for (int z = 0; z < 4; ++z)
-                setVoxel({(uint32_t)x + base.x, (uint32_t)y + base.y, (uint32_t)z + base.z}, 0xFF00FF);
+                add({(uint32_t)x + base.x, (uint32_t)y + base.y, (uint32_t)z + base.z}, 0xFF00FF);
 
     // Cyan tower
     for (int x = 20; x < 24; ++x)
         for (int y = 0; y < 20; ++y)
             for (int z = 0; z < 4; ++z)
-                setVoxel({(uint32_t)x + base.x, (uint32_t)y + base.y, (uint32_t)z + base.z}, 0x00FFFF);
+                add({(uint32_t)x + base.x, (uint32_t)y + base.y, (uint32_t)z + base.z}, 0x00FFFF);
 
     // Orange stairs
     for (int i = 0; i < 8; ++i)
         for (int x = 24; x < 28; ++x)
             for (int y = i * 2; y < i * 2 + 2; ++y)
                 for (int z = 0; z < 4; ++z)
-                    setVoxel({(uint32_t)(x + i) + base.x, (uint32_t)y + base.y, (uint32_t)z + base.z}, 0xFF8000);
+                    add({(uint32_t)(x + i) + base.x, (uint32_t)y + base.y, (uint32_t)z + base.z}, 0xFF8000);
 
     // Single emissive voxel placed next to the test scene
-    setVoxel({base.x + 1u, base.y + 1u, base.z + 1u}, packColor(255, 255, 255, 255));
-    
-    // Mark homogeneous nodes for traversal optimization
+    add({base.x + 1u, base.y + 1u, base.z + 1u}, packColor(255, 255, 255, 255));
+
+    buildFromVoxels(voxels);
+
+    // Mark homogeneous nodes for traversal optimization, then drop the
+    // children orphaned by collapsed nodes before GPU upload
     markHomogeneousNodes();
+    compactNodes();
+    computeLodColors();
 }
 
-bool SparseVoxelOctree::loadFromVoxFile(const std::string& filepath) {
-    std::ifstream file(filepath, std::ios::binary);
-    if (!file) {
-        std::cerr << "Failed to open .vox file: " << filepath << std::endl;
-        return false;
+enum class HomogeneousResult { Skipped, Marked, Compressed };
+
+// Collapse node i into a leaf when all 8 children are the same leaf.
+// Reads only the node's children, so nodes of one level can run concurrently.
+static HomogeneousResult markHomogeneousNode(std::vector<OctreeNode>& nodes,
+                                             const std::vector<uint32_t>& farPointers, size_t i) {
+    OctreeNode& node = nodes[i];
+
+    // Skip if already a leaf
+    if (node.data & OctreeNode::LEAF_BIT) return HomogeneousResult::Skipped;
+
+    const uint32_t payload = node.data & OctreeNode::PAYLOAD_MASK;
+    uint32_t childPtr = (node.data & OctreeNode::FAR_BIT) ? farPointers[payload] : payload;
+    if (childPtr == 0 || childPtr + 7ull >= nodes.size()) return HomogeneousResult::Skipped;
+
+    // Check if all 8 children are identical leaves with same color. Children
+    // collapsed earlier carry HOMOGENEOUS_BIT, so compare plain words like
+    // packChildBlock() and editNode() do; the result then does not depend on
+    // the order nodes are visited in.
+    uint32_t firstChild = plainWord(nodes[childPtr].data);
+
+    // First child must be a leaf
+    if (!(firstChild & OctreeNode::LEAF_BIT)) return HomogeneousResult::Skipped;
+
+    for (uint32_t j = 1; j < 8; ++j) {
+        if (plainWord(nodes[childPtr + j].data) != firstChild) {
+            // Mixed leaves: keep children for traversal. Bit 30 is the far
+            // pointer flag on internal nodes, so nothing is recorded here.
+            return HomogeneousResult::Marked;
+        }
     }
 
-    // Read header
-    char magic[4];
-    file.read(magic, 4);
-    if (std::memcmp(magic, "VOX ", 4) != 0) {
-        std::cerr << "Invalid .vox file magic" << std::endl;
-        return false;
+    // All children are identical leaves: convert this node to a leaf with the same color
+    uint32_t colorIdx = firstChild & OctreeNode::PAYLOAD_MASK;
+    node.data = OctreeNode::LEAF_BIT | OctreeNode::HOMOGENEOUS_BIT | colorIdx;
+    // Children stay in place so indices remain valid; compactNodes() drops them
+    return HomogeneousResult::Compressed;
+}
+
+void SparseVoxelOctree::markHomogeneousNodes() {
+    if (rejectPagedTop("markHomogeneousNodes")) return;
+    if (m_childOrderBroken) compactNodes();
+    dropCachedEncoding();
+    markAllNodesDirty();
+    std::atomic<uint32_t> markedCount{0};
+    std::atomic<uint32_t> compressedCount{0};
+    auto tally = [&](HomogeneousResult r, uint32_t& marked, uint32_t& compressed) {
+        if (r == HomogeneousResult::Skipped) return;
+        marked++;
+        if (r == HomogeneousResult::Compressed) compressed++;
+    };
+
+    const uint32_t threads = m_buildThreads ? m_buildThreads : std::max(1u, std::thread::hardware_concurrency());
+    if (!m_levelOffsets.empty() && threads > 1 && m_nodes.size() >= (1u << 16)) {
+        // Layout from buildFromVoxels is level-major, so finish each level
+        // (deepest first) before its parents and split it across the pool
+        ThreadPool pool(threads);
+        static constexpr size_t kNodesPerTask = 1u << 14;
+        for (size_t l = m_levelOffsets.size() - 1; l-- > 0;) {
+            const size_t begin = (l == 0) ? 0 : m_levelOffsets[l];
+            const size_t end = (l == 0) ? 1 : m_levelOffsets[l + 1];
+            const size_t tasks = (end - begin + kNodesPerTask - 1) / kNodesPerTask;
+            pool.parallelFor(tasks, [&](size_t t) {
+                uint32_t marked = 0, compressed = 0;
+                size_t taskEnd = std::min(end, begin + (t + 1) * kNodesPerTask);
+                for (size_t i = begin + t * kNodesPerTask; i < taskEnd; ++i) {
+                    tally(markHomogeneousNode(m_nodes, m_farPointers, i), marked, compressed);
+                }
+                markedCount += marked;
+                compressedCount += compressed;
+            });
+        }
+    } else {
+        // Process nodes from deepest to root (bottom-up): children always
+        // live at higher indices than their parent
+        uint32_t marked = 0, compressed = 0;
+        for (size_t i = m_nodes.size(); i-- > 0;) {
+            tally(markHomogeneousNode(m_nodes, m_farPointers, i), marked, compressed);
+        }
+        markedCount = marked;
+        compressedCount = compressed;
     }
 
-    uint32_t version;
-    file.read(reinterpret_cast<char*>(&version), 4);
-    std::cout << "Loading MagicaVoxel file version " << version << std::endl;
-
-    // Read MAIN chunk
-    char chunkId[4];
-    file.read(chunkId, 4);
-    if (std::memcmp(chunkId, "MAIN", 4) != 0) {
-        std::cerr << "Expected MAIN chunk" << std::endl;
-        return false;
+    std::cout << "Marked " << markedCount << " homogeneous nodes (" 
+              << compressedCount << " compressed to leaves)" << std::endl;
+}
+
+size_t SparseVoxelOctree::compactNodes() {
+    if (rejectPagedTop("compactNodes")) return 0;
+    if (m_childOrderBroken || m_nodeOrder != NodeOrder::BreadthFirst) return relayoutNodes(m_nodeOrder);
+
+    const size_t oldCount = m_nodes.size();
+
+    // Forward pass: children always live at higher indices than their parent,
+    // so a block's liveness is known before the scan reaches it
+    std::vector<uint8_t> live(oldCount, 0);
+    live[0] = 1;
+    for (size_t i = 0; i < oldCount; ++i) {
+        if (!live[i]) continue;
+        uint32_t data = m_nodes[i].data;
+        if (data & OctreeNode::LEAF_BIT) continue;
+        uint32_t childPtr = childPointer(data);
+        if (childPtr == 0 || childPtr + 7ull >= oldCount) continue;
+        std::fill(live.begin() + childPtr, live.begin() + childPtr + 8, uint8_t(1));
+    }
+
+    // New index of each node = number of live nodes before it
+    std::vector<uint32_t> newIndex(oldCount + 1, 0);
+    for (size_t i = 0; i < oldCount; ++i) {
+        newIndex[i + 1] = newIndex[i] + live[i];
+    }
+    const size_t newCount = newIndex[oldCount];
+    if (newCount == oldCount) return 0;
+    dropCachedEncoding();
+
+    // Relative order is preserved, so live blocks stay contiguous and in place
+    // compaction never overwrites a node before it is moved
+    std::vector<uint32_t> farPointers;
+    for (size_t i = 0; i < oldCount; ++i) {
+        if (!live[i]) continue;
+        uint32_t data = m_nodes[i].data;
+        if (!(data & OctreeNode::LEAF_BIT)) {
+            uint32_t childPtr = childPointer(data);
+            if (childPtr != 0) {
+                data = pointerWord(newIndex[childPtr], farPointers);
+            }
+        }
+        m_nodes[newIndex[i]].data = data;
+        if (!m_lodColors.empty()) m_lodColors[newIndex[i]] = m_lodColors[i];
+    }
+    m_nodes.resize(newCount);
+    m_nodes.shrink_to_fit();
+    m_farPointers.swap(farPointers);
+    m_freeFarSlots.clear();
+    if (!m_lodColors.empty()) {
+        m_lodColors.resize(newCount);
+        m_lodColors.shrink_to_fit();
+    }
+
+    for (auto& offset : m_levelOffsets) {
+        offset = newIndex[std::min<size_t>(offset, oldCount)];
+    }
+    m_sharedBlockLimit = m_sharedBlocks ? newCount : 0;
+    markAllNodesDirty();
+
+    size_t bytesSaved = (oldCount - newCount) * sizeof(OctreeNode);
+    std::cout << "Compacted octree: " << oldCount << " -> " << newCount << " nodes ("
+              << (bytesSaved / 1024) << " KB saved)" << std::endl;
+    return bytesSaved;
+}
+
+namespace {
+// Internal words are keyed by their resolved child index (tagged in the high
+// half) so near and far pointers to the same block compare equal
+struct ChildBlockKey {
+    uint64_t words[8];
+    bool operator==(const ChildBlockKey& o) const {
+        return std::memcmp(words, o.words, sizeof(words)) == 0;
+    }
+};
+
+struct ChildBlockHash {
+    size_t operator()(const ChildBlockKey& k) const {
+        uint64_t h = 0x9E3779B97F4A7C15ull;
+        for (uint64_t w : k.words) {
+            h ^= w;
+            h *= 0xFF51AFD7ED558CCDull;
+            h ^= h >> 32;
+        }
+        return static_cast<size_t>(h);
+    }
+};
+} // namespace
+
+size_t SparseVoxelOctree::mergeIdenticalSubtrees() {
+    if (rejectPagedTop("mergeIdenticalSubtrees")) return 0;
+    if (m_childOrderBroken) compactNodes();
+    const size_t oldCount = m_nodes.size();
+
+    // Children always live at higher indices than their parent, so a reverse
+    // scan sees every child block in canonical form before its parent. The
+    // first (highest) copy of a block becomes canonical; it still lies above
+    // every parent that is redirected to it, which keeps compactNodes() valid.
+    std::unordered_map<ChildBlockKey, uint32_t, ChildBlockHash> canonical;
+    canonical.reserve(oldCount / 8);
+    uint32_t merged = 0;
+    for (size_t i = oldCount; i-- > 0;) {
+        uint32_t data = m_nodes[i].data;
+        if (data & OctreeNode::LEAF_BIT) continue;
+        uint32_t childPtr = childPointer(data);
+        if (childPtr == 0 || childPtr + 7ull >= oldCount) continue;
+
+        ChildBlockKey key;
+        for (uint32_t c = 0; c < 8; ++c) {
+            const uint32_t w = m_nodes[childPtr + c].data;
+            const bool internal = w != 0 && !(w & OctreeNode::LEAF_BIT);
+            key.words[c] = internal ? ((1ull << 32) | childPointer(w)) : w;
+        }
+
+        auto it = canonical.emplace(key, childPtr).first;
+        if (it->second != childPtr) {
+            m_nodes[i].data = pointerWord(it->second, m_farPointers);
+            merged++;
+        }
+    }
+    if (merged > 0) dropCachedEncoding();
+
+    m_mergedSubtrees = true;
+    m_sharedBlocks = true;
+    std::cout << "Merged " << merged << " identical subtrees (" << canonical.size()
+              << " unique child blocks)" << std::endl;
+    if (merged == 0) {
+        m_sharedBlockLimit = m_nodes.size();
+        return 0;
+    }
+    markAllNodesDirty();
+    return compactNodes();
+}
+
+OctreeStats SparseVoxelOctree::computeStats(NodeFormat gpuFormat) const {
+    OctreeStats stats;
+    stats.depth = m_depth;
+    stats.totalNodes = m_nodes.size();
+    stats.farPointers = m_farPointers.size();
+    stats.paletteSize = m_colors.size();
+    stats.emissiveVoxels = m_emissiveVoxels.size();
+
+    // Level by level from the root; refs saturates at 2 so a block reached
+    // again through a DAG is counted as shared but walked only once
+    std::vector<uint8_t> refs(m_nodes.size(), 0);
+    std::vector<uint32_t> level;
+    std::vector<uint32_t> next;
+    if (!m_nodes.empty()) level.push_back(0);
+    while (!level.empty()) {
+        uint64_t leaves = 0, empty = 0;
+        next.clear();
+        for (uint32_t i : level) {
+            const uint32_t data = m_nodes[i].data;
+            if (data & OctreeNode::LEAF_BIT) {
+                leaves++;
+                if (data & OctreeNode::HOMOGENEOUS_BIT) stats.homogeneousLeaves++;
+                continue;
+            }
+            if (m_pagedTop && (data & OctreeNode::FAR_BIT)) {
+                stats.pageRoots++;
+                stats.internalNodes++;
+                continue;
+            }
+            const uint32_t childPtr = childPointer(data);
+            if (childPtr == 0 || childPtr + 7ull >= m_nodes.size()) {
+                empty++;
+                continue;
+            }
+            stats.internalNodes++;
+            if (refs[childPtr] == 1) stats.sharedBlocks++;
+            if (refs[childPtr] < 2) refs[childPtr]++;
+            if (refs[childPtr] == 1) {
+                for (uint32_t c = 0; c < 8; ++c) next.push_back(childPtr + c);
+            }
+        }
+        stats.nodesPerLevel.push_back(level.size());
+        stats.leavesPerLevel.push_back(leaves);
+        stats.emptyPerLevel.push_back(empty);
+        stats.reachableNodes += level.size();
+        stats.leafNodes += leaves;
+        stats.emptyNodes += empty;
+        level.swap(next);
+    }
+    stats.orphanedNodes = stats.totalNodes - stats.reachableNodes;
+    if (stats.reachableNodes) {
+        stats.leafRatio = static_cast<double>(stats.leafNodes) / stats.reachableNodes;
+        stats.emptyRatio = static_cast<double>(stats.emptyNodes) / stats.reachableNodes;
+    }
+
+    stats.hostBytes = m_nodes.capacity() * sizeof(OctreeNode) + m_lodColors.capacity() * sizeof(uint32_t) +
+                      m_farPointers.capacity() * sizeof(uint32_t) + m_colors.capacity() * sizeof(uint32_t) +
+                      m_colorToIndex.memoryBytes() + m_emissiveVoxels.capacity() * sizeof(glm::uvec3) +
+                      m_levelOffsets.capacity() * sizeof(uint64_t) + m_dirtyPages.capacity() * sizeof(uint64_t);
+
+    // Same fallbacks as the uploader: encodings that do not fit go dense
+    uint64_t nodeWords = m_nodes.size();
+    if (gpuFormat == NodeFormat::SparseMask) {
+        const size_t words = m_cachedSparse.count ? m_cachedSparse.count : encodeSparseNodes().size();
+        if (words) nodeWords = words;
+        else gpuFormat = NodeFormat::Dense;
+    } else if (gpuFormat == NodeFormat::Bricks) {
+        const size_t words = encodeBrickNodes().size();
+        if (words) nodeWords = words;
+        else gpuFormat = NodeFormat::Dense;
+    }
+    stats.gpuFormat = gpuFormat;
+    stats.gpuNodeBytes = nodeWords * sizeof(uint32_t);
+    stats.gpuBytes = 2 * stats.gpuNodeBytes + stats.paletteSize * sizeof(uint32_t) +
+                     (stats.emissiveVoxels + 1) * sizeof(glm::uvec4); // LOD colors parallel the node words
+    if (gpuFormat == NodeFormat::Dense) stats.gpuBytes += stats.farPointers * sizeof(uint32_t);
+    return stats;
+}
+
+uint32_t SparseVoxelOctree::descend(glm::uvec3 cell, OctreeCursor& cursor) const {
+    const uint32_t levels = m_depth - 1;
+    uint32_t k = 0;
+    if (cursor.valid) {
+        // Depth k is chosen by bits [levels, levels - k + 1]; cut below the highest differing one
+        uint32_t shared = m_depth;
+        for (uint32_t diff = (cell.x ^ cursor.cell.x) | (cell.y ^ cursor.cell.y) | (cell.z ^ cursor.cell.z); diff; diff >>= 1) {
+            --shared;
+        }
+        k = std::min(cursor.depth, shared);
+    }
+    cursor.cell = cell;
+    cursor.valid = true;
+
+    uint32_t node = cursor.nodes[k];
+    for (;;) {
+        const uint32_t data = m_nodes[node].data;
+        const uint32_t child = childPointer(data);
+        if (child == 0 || k == levels || child + 7ull >= m_nodes.size()) {
+            cursor.depth = k;
+            return data;
+        }
+        const uint32_t bit = levels - k;
+        node = child + (((cell.x >> bit) & 1u) << 2 | ((cell.y >> bit) & 1u) << 1 | ((cell.z >> bit) & 1u));
+        cursor.nodes[++k] = node;
+    }
+}
+
+namespace {
+// firstCell, when given, receives the path to the ray's first cell
+RayHit traceRay(const SparseVoxelOctree& tree, const Ray& ray, OctreeCursor& path, OctreeCursor* firstCell) {
+    RayHit hit;
+    const uint32_t gridSize = 1u << tree.getDepth();
+    const float gridMax = static_cast<float>(gridSize);
+    const glm::vec3 invDir = 1.0f / ray.dir;
+
+    // Clip to the grid; the axis of the last entry plane gives the first normal
+    float t = 0.0f;
+    float tExit = ray.maxT;
+    int entryAxis = -1;
+    for (int a = 0; a < 3; ++a) {
+        if (ray.dir[a] == 0.0f) {
+            if (ray.origin[a] < 0.0f || ray.origin[a] >= gridMax) return hit;
+            continue;
+        }
+        const float t0 = (ray.dir[a] > 0.0f ? 0.0f : gridMax) - ray.origin[a];
+        const float t1 = (ray.dir[a] > 0.0f ? gridMax : 0.0f) - ray.origin[a];
+        const float tNear = t0 * invDir[a];
+        if (tNear > t) {
+            t = tNear;
+            entryAxis = a;
+        }
+        tExit = std::min(tExit, t1 * invDir[a]);
+    }
+    if (t > tExit) return hit;
+
+    glm::uvec3 cell;
+    glm::ivec3 normal(0);
+    for (int a = 0; a < 3; ++a) {
+        const float p = std::floor(ray.origin[a] + ray.dir[a] * t);
+        cell[a] = static_cast<uint32_t>(std::min(std::max(p, 0.0f), gridMax - 1.0f));
+    }
+    if (entryAxis >= 0) {
+        cell[entryAxis] = ray.dir[entryAxis] > 0.0f ? 0u : gridSize - 1u;
+        normal[entryAxis] = ray.dir[entryAxis] > 0.0f ? -1 : 1;
+    }
+
+    for (;;) {
+        const uint32_t data = tree.descend(cell, path);
+        if (firstCell) {
+            *firstCell = path;
+            firstCell = nullptr;
+        }
+        if (data & OctreeNode::LEAF_BIT) {
+            const uint32_t colorIdx = data & OctreeNode::PAYLOAD_MASK;
+            hit.hit = true;
+            hit.t = t;
+            hit.voxel = cell;
+            hit.normal = normal;
+            hit.color = colorIdx < tree.getColors().size() ? tree.getColors()[colorIdx] : 0u;
+            return hit;
+        }
+
+        // Empty node: leave its box through the nearest exit plane
+        const uint32_t size = gridSize >> path.depth;
+        const glm::uvec3 nodeMin = cell & glm::uvec3(~(size - 1u));
+        glm::vec3 tPlane(std::numeric_limits<float>::infinity());
+        for (int a = 0; a < 3; ++a) {
+            if (ray.dir[a] == 0.0f) continue;
+            const float plane = static_cast<float>(ray.dir[a] > 0.0f ? nodeMin[a] + size : nodeMin[a]);
+            tPlane[a] = (plane - ray.origin[a]) * invDir[a];
+        }
+        const float tNext = std::min(tPlane.x, std::min(tPlane.y, tPlane.z));
+        if (tNext > ray.maxT) return hit;
+
+        // Exit axes step by exactly one cell; the others stay inside the node's slab
+        for (int a = 0; a < 3; ++a) {
+            if (tPlane[a] == tNext) {
+                if (ray.dir[a] > 0.0f) {
+                    if (nodeMin[a] + size >= gridSize) return hit;
+                    cell[a] = nodeMin[a] + size;
+                } else {
+                    if (nodeMin[a] == 0) return hit;
+                    cell[a] = nodeMin[a] - 1;
+                }
+                normal = glm::ivec3(0);
+                normal[a] = ray.dir[a] > 0.0f ? -1 : 1;
+            } else {
+                const float p = std::floor(ray.origin[a] + ray.dir[a] * tNext);
+                const float lo = static_cast<float>(nodeMin[a]);
+                cell[a] = static_cast<uint32_t>(std::min(std::max(p, lo), lo + static_cast<float>(size - 1u)));
+            }
+        }
+        t = tNext;
+    }
+}
+} // namespace
+
+bool SparseVoxelOctree::isSolid(glm::uvec3 pos) const {
+    uint32_t color;
+    return getColor(pos, color);
+}
+
+bool SparseVoxelOctree::getColor(glm::uvec3 pos, uint32_t& color) const {
+    const uint32_t gridSize = 1u << m_depth;
+    if (m_nodes.empty() || pos.x >= gridSize || pos.y >= gridSize || pos.z >= gridSize) return false;
+    OctreeCursor cursor;
+    const uint32_t data = descend(pos, cursor);
+    if (!(data & OctreeNode::LEAF_BIT)) return false;
+    const uint32_t colorIdx = data & OctreeNode::PAYLOAD_MASK;
+    color = colorIdx < m_colors.size() ? m_colors[colorIdx] : 0u;
+    return true;
+}
+
+RayHit SparseVoxelOctree::raycast(const glm::vec3& origin, const glm::vec3& dir, float maxT) const {
+    if (m_nodes.empty()) return RayHit{};
+    OctreeCursor path;
+    return traceRay(*this, Ray{origin, dir, maxT}, path, nullptr);
+}
+
+void SparseVoxelOctree::raycast(const Ray* rays, size_t count, RayHit* hits) const {
+    if (m_nodes.empty()) {
+        std::fill(hits, hits + count, RayHit{});
+        return;
+    }
+    // Each ray resumes from the previous ray's first cell, which a coherent
+    // neighbour shares most ancestors with
+    OctreeCursor start;
+    for (size_t i = 0; i < count; ++i) {
+        OctreeCursor path = start;
+        hits[i] = traceRay(*this, rays[i], path, &start);
     }
+}
 
-    uint32_t mainChunkSize, mainChildrenSize;
-    file.read(reinterpret_cast<char*>(&mainChunkSize), 4);
-    file.read(reinterpret_cast<char*>(&mainChildrenSize), 4);
+std::string OctreeStats::toJson() const {
+    auto array = [](std::ostringstream& out, const std::vector<uint64_t>& values) {
+        out << '[';
+        for (size_t i = 0; i < values.size(); ++i) out << (i ? "," : "") << values[i];
+        out << ']';
+    };
+    std::ostringstream out;
+    out << std::setprecision(6);
+    out << "{\"depth\":" << depth
+        << ",\"totalNodes\":" << totalNodes
+        << ",\"reachableNodes\":" << reachableNodes
+        << ",\"orphanedNodes\":" << orphanedNodes
+        << ",\"nodesPerLevel\":";
+    array(out, nodesPerLevel);
+    out << ",\"leavesPerLevel\":";
+    array(out, leavesPerLevel);
+    out << ",\"emptyPerLevel\":";
+    array(out, emptyPerLevel);
+    out << ",\"internalNodes\":" << internalNodes
+        << ",\"leafNodes\":" << leafNodes
+        << ",\"emptyNodes\":" << emptyNodes
+        << ",\"leafRatio\":" << leafRatio
+        << ",\"emptyRatio\":" << emptyRatio
+        << ",\"homogeneousLeaves\":" << homogeneousLeaves
+        << ",\"sharedBlocks\":" << sharedBlocks
+        << ",\"pageRoots\":" << pageRoots
+        << ",\"farPointers\":" << farPointers
+        << ",\"paletteSize\":" << paletteSize
+        << ",\"emissiveVoxels\":" << emissiveVoxels
+        << ",\"gpuFormat\":\"" << nodeFormatName(gpuFormat) << '"'
+        << ",\"hostBytes\":" << hostBytes
+        << ",\"gpuNodeBytes\":" << gpuNodeBytes
+        << ",\"gpuBytes\":" << gpuBytes << '}';
+    return out.str();
+}
+
+uint32_t SparseVoxelOctree::filterLodColor(uint32_t data) const {
+    if (data & OctreeNode::LEAF_BIT) {
+        uint32_t colorIdx = data & OctreeNode::PAYLOAD_MASK;
+        uint32_t rgb = colorIdx < m_colors.size() ? (m_colors[colorIdx] & 0x00FFFFFFu) : 0u;
+        return 0xFF000000u | rgb;
+    }
+    uint32_t childPtr = childPointer(data);
+    if (childPtr == 0 || childPtr + 7ull >= m_lodColors.size()) return 0u;
 
-    uint32_t sizeX = 0, sizeY = 0, sizeZ = 0;
-    bool sizeLoaded = false;
-    bool voxelsLoaded = false;
+    uint32_t occSum = 0, r = 0, g = 0, b = 0;
+    for (uint32_t c = 0; c < 8; ++c) {
+        uint32_t lod = m_lodColors[childPtr + c];
+        uint32_t occ = lod >> 24;
+        occSum += occ;
+        r += ((lod >> 16) & 0xFFu) * occ;
+        g += ((lod >> 8) & 0xFFu) * occ;
+        b += (lod & 0xFFu) * occ;
+    }
+    if (occSum == 0) return 0u;
 
-    struct VoxelData { uint8_t x, y, z, colorIndex; };
-    std::vector<VoxelData> voxelData;
-    uint32_t numVoxels = 0;
+    // Round occupancy up so a node with any voxel never reads as empty
+    uint32_t occ = (occSum + 7) / 8;
+    return (occ << 24) | ((r / occSum) << 16) | ((g / occSum) << 8) | (b / occSum);
+}
 
-    std::vector<uint32_t> palette(256);
-    bool paletteLoaded = false;
+void SparseVoxelOctree::computeLodColors() {
+    if (rejectPagedTop("computeLodColors")) return; // page roots keep the colors they were saved with
+    if (m_childOrderBroken) compactNodes();
+    m_lodColors.assign(m_nodes.size(), 0u);
 
-    uint32_t bytesRead = 0;
-    while (bytesRead < mainChildrenSize && file) {
-        file.read(chunkId, 4);
-        if (!file) break;
+    // Children always live at higher indices than their parent, so a reverse
+    // scan filters every child before the node that averages it
+    for (size_t i = m_nodes.size(); i-- > 0;) {
+        m_lodColors[i] = filterLodColor(m_nodes[i].data);
+    }
+    markAllNodesDirty();
+}
 
-        uint32_t chunkSize = 0;
-        uint32_t childrenSize = 0;
-        file.read(reinterpret_cast<char*>(&chunkSize), 4);
-        file.read(reinterpret_cast<char*>(&childrenSize), 4);
+std::vector<uint32_t> SparseVoxelOctree::encodeSparseNodes(std::vector<uint32_t>* lodColors) const {
+    std::vector<uint32_t> out;
+    out.reserve(m_nodes.size() / 2 + 1);
+    out.push_back(m_nodes[0].data);
 
-        bytesRead += 12 + chunkSize + childrenSize;
+    const bool remapLod = lodColors && m_lodColors.size() == m_nodes.size();
+    if (lodColors) {
+        lodColors->clear();
+        lodColors->push_back(remapLod ? m_lodColors[0] : 0u);
+    }
 
-        if (std::memcmp(chunkId, "SIZE", 4) == 0) {
-            file.read(reinterpret_cast<char*>(&sizeX), 4);
-            file.read(reinterpret_cast<char*>(&sizeY), 4);
-            file.read(reinterpret_cast<char*>(&sizeZ), 4);
-            sizeLoaded = true;
-            std::cout << "Model size: " << sizeX << " x " << sizeY << " x " << sizeZ << std::endl;
+    auto childBlock = [&](size_t idx) -> uint32_t {
+        uint32_t childPtr = childPointer(m_nodes[idx].data);
+        return (childPtr != 0 && childPtr + 7ull < m_nodes.size()) ? childPtr : 0;
+    };
 
-            if (chunkSize > 12) {
-                file.seekg(chunkSize - 12, std::ios::cur);
+    // Reachable blocks, encoded in array order so the groups inherit the
+    // dense layout (see relayoutNodes). A DAG block becomes one shared group.
+    std::vector<uint32_t> blocks;
+    std::vector<uint32_t> groupOfBlock(m_nodes.size(), 0);
+    if (uint32_t root = childBlock(0)) {
+        groupOfBlock[root] = 1;
+        blocks.push_back(root);
+    }
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        for (uint32_t c = 0; c < 8; ++c) {
+            uint32_t child = childBlock(blocks[i] + c);
+            if (child && !groupOfBlock[child]) {
+                groupOfBlock[child] = 1;
+                blocks.push_back(child);
             }
-        } else if (std::memcmp(chunkId, "XYZI", 4) == 0) {
-            file.read(reinterpret_cast<char*>(&numVoxels), 4);
-            std::cout << "Loading " << numVoxels << " voxels..." << std::endl;
+        }
+    }
+    std::sort(blocks.begin(), blocks.end());
+
+    // Slots holding the resolved dense child block of an internal node,
+    // patched to its group once every group has a position
+    std::vector<uint32_t> pointerSlots;
+    if (uint32_t root = childBlock(0)) {
+        out[0] = root;
+        pointerSlots.push_back(0);
+    }
+    for (uint32_t block : blocks) {
+        uint32_t validMask = 0, leafMask = 0;
+        for (uint32_t i = 0; i < 8; ++i) {
+            uint32_t child = m_nodes[block + i].data;
+            if (child == 0) continue;
+            validMask |= 1u << i;
+            if (child & OctreeNode::LEAF_BIT) leafMask |= 1u << i;
+        }
+
+        groupOfBlock[block] = static_cast<uint32_t>(out.size());
+        out.push_back(validMask | (leafMask << 8));
+        if (lodColors) lodColors->push_back(0u);
+        for (uint32_t i = 0; i < 8; ++i) {
+            if (!(validMask & (1u << i))) continue;
+            const uint32_t child = childBlock(block + i);
+            if (child) pointerSlots.push_back(static_cast<uint32_t>(out.size()));
+            out.push_back(child ? child : m_nodes[block + i].data);
+            if (lodColors) lodColors->push_back(remapLod ? m_lodColors[block + i] : 0u);
+        }
+    }
+    if (out.size() > OctreeNode::PAYLOAD_MASK) {
+        std::cerr << "encodeSparseNodes: " << out.size() << " words exceed the 30-bit child pointer range" << std::endl;
+        if (lodColors) lodColors->clear();
+        return {};
+    }
+    for (uint32_t slot : pointerSlots) {
+        out[slot] = groupOfBlock[out[slot]];
+    }
+
+    // Internal nodes whose subtree turned out empty stay as empty groups;
+    // the shader treats a clear valid bit like a dense {0} child.
+    return out;
+}
+
+// Writes the palette index of every leaf cell under block into cells
+// (8^3, bit order x*64 + y*8 + z); span is the cell width of one child
+static void rasterizeBrick(const std::vector<OctreeNode>& nodes, const std::vector<uint32_t>& farPointers,
+                           uint32_t block, uint32_t span, glm::uvec3 base, uint32_t* cells) {
+    for (uint32_t c = 0; c < 8; ++c) {
+        const uint32_t data = nodes[block + c].data;
+        const glm::uvec3 corner = base + glm::uvec3((c >> 2) & 1u, (c >> 1) & 1u, c & 1u) * span;
+        if (data & OctreeNode::LEAF_BIT) {
+            const uint32_t colorIdx = data & OctreeNode::PAYLOAD_MASK;
+            for (uint32_t x = corner.x; x < corner.x + span; ++x)
+                for (uint32_t y = corner.y; y < corner.y + span; ++y)
+                    for (uint32_t z = corner.z; z < corner.z + span; ++z)
+                        cells[x * 64 + y * 8 + z] = colorIdx;
+            continue;
+        }
+        const uint32_t payload = data & OctreeNode::PAYLOAD_MASK;
+        const uint32_t childPtr = (data & OctreeNode::FAR_BIT) ? farPointers[payload] : payload;
+        if (childPtr != 0 && span > 1 && childPtr + 7ull < nodes.size()) {
+            rasterizeBrick(nodes, farPointers, childPtr, span / 2, corner, cells);
+        }
+    }
+}
+
+std::vector<uint32_t> SparseVoxelOctree::encodeBrickNodes(std::vector<uint32_t>* lodColors) const {
+    std::vector<uint32_t> out;
+    if (lodColors) lodColors->clear();
+    const uint32_t brickLevel = getBrickLevel();
+    if (m_nodes.empty() || brickLevel == 0) return out;
+
+    const bool remapLod = lodColors && m_lodColors.size() == m_nodes.size();
+    auto childBlock = [&](size_t idx) -> uint32_t {
+        uint32_t childPtr = childPointer(m_nodes[idx].data);
+        return (childPtr != 0 && childPtr + 7ull < m_nodes.size()) ? childPtr : 0;
+    };
+
+    // Node blocks above the bricks, keyed by (block, level): a DAG may share
+    // a block between levels, and only at the brick level do its children
+    // turn into bricks. Bricks are keyed by the block under the brick node.
+    struct UpperBlock {
+        uint32_t block;
+        uint32_t level; // level of the block's nodes (root = 0)
+    };
+    auto key = [](uint32_t block, uint32_t level) { return (static_cast<uint64_t>(block) << 8) | level; };
+    constexpr uint32_t kUnseen = ~0u;
+    std::vector<UpperBlock> upper;
+    std::unordered_map<uint64_t, uint32_t> upperOffset;
+    std::vector<uint32_t> bricks;
+    std::vector<uint32_t> brickOffset(m_nodes.size(), kUnseen); // 0 = empty brick
 
-            voxelData.resize(numVoxels);
-            file.read(reinterpret_cast<char*>(voxelData.data()), numVoxels * 4);
-            voxelsLoaded = true;
+    auto visit = [&](uint32_t node, uint32_t level) {
+        uint32_t child = childBlock(node);
+        if (!child) return;
+        if (level < brickLevel) {
+            if (upperOffset.emplace(key(child, level + 1), 0).second) upper.push_back({child, level + 1});
+        } else if (brickOffset[child] == kUnseen) {
+            brickOffset[child] = 0;
+            bricks.push_back(child);
+        }
+    };
+    visit(0, 0);
+    for (size_t i = 0; i < upper.size(); ++i) {
+        for (uint32_t c = 0; c < 8; ++c) visit(upper[i].block + c, upper[i].level);
+    }
+
+    // Array order, so the node order carries over as in encodeSparseNodes
+    std::sort(upper.begin(), upper.end(), [](const UpperBlock& a, const UpperBlock& b) {
+        return a.block != b.block ? a.block < b.block : a.level < b.level;
+    });
+    std::sort(bricks.begin(), bricks.end());
+
+    size_t offset = 1;
+    for (const UpperBlock& b : upper) {
+        upperOffset[key(b.block, b.level)] = static_cast<uint32_t>(offset);
+        offset += 8;
+    }
+    out.resize(offset, 0u);
+    if (lodColors) lodColors->resize(offset, 0u);
+
+    uint32_t cells[512];
+    for (uint32_t block : bricks) {
+        std::fill(std::begin(cells), std::end(cells), ColorTable::kNotFound);
+        rasterizeBrick(m_nodes, m_farPointers, block, 1u << (kBrickLevels - 1), glm::uvec3(0), cells);
+
+        uint32_t mask[16] = {};
+        for (uint32_t i = 0; i < 512; ++i) {
+            if (cells[i] != ColorTable::kNotFound) mask[i >> 5] |= 1u << (i & 31);
+        }
+        if (std::all_of(std::begin(mask), std::end(mask), [](uint32_t w) { return w == 0; })) continue;
+
+        brickOffset[block] = static_cast<uint32_t>(out.size());
+        out.insert(out.end(), std::begin(mask), std::end(mask));
+        for (uint32_t i = 0; i < 512; ++i) {
+            if (cells[i] != ColorTable::kNotFound) out.push_back(cells[i]);
+        }
+    }
+    if (out.size() > OctreeNode::PAYLOAD_MASK) {
+        std::cerr << "encodeBrickNodes: " << out.size() << " words exceed the 30-bit child pointer range" << std::endl;
+        if (lodColors) lodColors->clear();
+        return {};
+    }
+    if (lodColors) lodColors->resize(out.size(), 0u);
+
+    auto encode = [&](uint32_t node, uint32_t level) -> uint32_t {
+        uint32_t child = childBlock(node);
+        if (!child) return m_nodes[node].data; // leaf or empty
+        if (level < brickLevel) return upperOffset[key(child, level + 1)];
+        return brickOffset[child] ? (OctreeNode::BRICK_BIT | brickOffset[child]) : 0u;
+    };
+    out[0] = encode(0, 0);
+    if (remapLod) (*lodColors)[0] = m_lodColors[0];
+    for (const UpperBlock& b : upper) {
+        const uint32_t base = upperOffset[key(b.block, b.level)];
+        for (uint32_t c = 0; c < 8; ++c) {
+            out[base + c] = encode(b.block + c, b.level);
+            if (remapLod) (*lodColors)[base + c] = m_lodColors[b.block + c];
+        }
+    }
+    return out;
+}
+
+namespace {
+// Ranks the child blocks of a node array by first visit in a traversal order.
+// Blocks are identified by their start index; rank is indexed the same way.
+struct BlockRanker {
+    static constexpr uint32_t kUnranked = ~0u;
 
-            uint32_t bytesConsumed = 4 + numVoxels * 4;
-            if (chunkSize > bytesConsumed) {
-                file.seekg(chunkSize - bytesConsumed, std::ios::cur);
+    const std::vector<OctreeNode>& nodes;
+    const std::vector<uint32_t>& farPointers;
+    std::vector<uint32_t> rank;
+    uint32_t next = 0;
+
+    BlockRanker(const std::vector<OctreeNode>& n, const std::vector<uint32_t>& far)
+        : nodes(n), farPointers(far), rank(n.size(), kUnranked) {}
+
+    uint32_t childBlock(uint32_t idx) const {
+        uint32_t data = nodes[idx].data;
+        if (data & OctreeNode::LEAF_BIT) return 0;
+        uint32_t payload = data & OctreeNode::PAYLOAD_MASK;
+        uint32_t childPtr = (data & OctreeNode::FAR_BIT) ? farPointers[payload] : payload;
+        return (childPtr != 0 && childPtr + 7ull < nodes.size()) ? childPtr : 0;
+    }
+
+    bool visit(uint32_t block) {
+        if (rank[block] != kUnranked) return false;
+        rank[block] = next++;
+        return true;
+    }
+
+    void breadthFirst(uint32_t root) {
+        std::deque<uint32_t> queue;
+        if (visit(root)) queue.push_back(root);
+        while (!queue.empty()) {
+            uint32_t block = queue.front();
+            queue.pop_front();
+            for (uint32_t c = 0; c < 8; ++c) {
+                uint32_t child = childBlock(block + c);
+                if (child && visit(child)) queue.push_back(child);
             }
-        } else if (std::memcmp(chunkId, "RGBA", 4) == 0) {
-            for (int i = 0; i < 256; ++i) {
-                uint8_t r, g, b, a;
-                file.read(reinterpret_cast<char*>(&r), 1);
-                file.read(reinterpret_cast<char*>(&g), 1);
-                file.read(reinterpret_cast<char*>(&b), 1);
-                file.read(reinterpret_cast<char*>(&a), 1);
-                uint8_t emissive = (r == 255 && g == 255 && b == 255) ? 255 : 0;
-                palette[i] = packColor(r, g, b, emissive);
+        }
+    }
+
+    void depthFirst(uint32_t root) {
+        std::vector<std::pair<uint32_t, uint32_t>> stack; // (block, next octant)
+        if (visit(root)) stack.push_back({root, 0});
+        while (!stack.empty()) {
+            auto& top = stack.back();
+            if (top.second == 8) {
+                stack.pop_back();
+                continue;
             }
-            paletteLoaded = true;
-            std::cout << "Loaded RGBA palette" << std::endl;
+            uint32_t child = childBlock(top.first + top.second++);
+            if (child && visit(child)) stack.push_back({child, 0});
+        }
+    }
 
-            if (chunkSize > 1024) {
-                file.seekg(chunkSize - 1024, std::ios::cur);
+    // Lay out the top half of the subtree's levels, then every subtree hanging
+    // below it, each recursively the same way
+    void vanEmdeBoas(uint32_t block, uint32_t height) {
+        if (height <= 1) {
+            visit(block);
+            return;
+        }
+        const uint32_t topHeight = height / 2;
+        vanEmdeBoas(block, topHeight);
+        std::vector<uint32_t> frontier;
+        collectAtDepth(block, topHeight, frontier);
+        for (uint32_t f : frontier) {
+            // Already ranked means another parent reached it first (DAG)
+            if (rank[f] == kUnranked) vanEmdeBoas(f, height - topHeight);
+        }
+    }
+
+    // Append every reachable block the traversal above did not rank
+    void rankUnreached(uint32_t root) {
+        std::vector<uint8_t> seen(nodes.size(), 0);
+        std::deque<uint32_t> queue{root};
+        seen[root] = 1;
+        while (!queue.empty()) {
+            uint32_t block = queue.front();
+            queue.pop_front();
+            visit(block);
+            for (uint32_t c = 0; c < 8; ++c) {
+                uint32_t child = childBlock(block + c);
+                if (child && !seen[child]) {
+                    seen[child] = 1;
+                    queue.push_back(child);
+                }
+            }
+        }
+    }
+
+    void collectAtDepth(uint32_t block, uint32_t depth, std::vector<uint32_t>& out) const {
+        if (depth == 0) {
+            out.push_back(block);
+            return;
+        }
+        for (uint32_t c = 0; c < 8; ++c) {
+            uint32_t child = childBlock(block + c);
+            if (child) collectAtDepth(child, depth - 1, out);
+        }
+    }
+};
+} // namespace
+
+size_t SparseVoxelOctree::relayoutNodes(NodeOrder order) {
+    if (rejectPagedTop("relayoutNodes")) return 0;
+    const size_t oldCount = m_nodes.size();
+    const bool lod = m_lodColors.size() == oldCount;
+
+    BlockRanker ranker(m_nodes, m_farPointers);
+    const uint32_t rootBlock = ranker.childBlock(0);
+    if (rootBlock) {
+        switch (order) {
+        case NodeOrder::DepthFirst: ranker.depthFirst(rootBlock); break;
+        case NodeOrder::VanEmdeBoas:
+            ranker.vanEmdeBoas(rootBlock, m_depth - 1);
+            // DAG blocks skipped as already-ranked frontiers may hide unranked descendants
+            ranker.rankUnreached(rootBlock);
+            break;
+        default: ranker.breadthFirst(rootBlock); break;
+        }
+    }
+
+    // Count parents so a DAG block is placed only after all of them; the
+    // bottom-up passes scan the array in reverse and rely on that. A tree
+    // comes out exactly in rank order.
+    std::vector<uint32_t> parents(oldCount, 0);
+    if (rootBlock) parents[rootBlock] = 1;
+    for (uint32_t block = 1; block + 7 < oldCount; block += 8) {
+        if (ranker.rank[block] == BlockRanker::kUnranked) continue;
+        for (uint32_t c = 0; c < 8; ++c) {
+            uint32_t child = ranker.childBlock(block + c);
+            if (child) parents[child]++;
+        }
+    }
+
+    using Ready = std::pair<uint32_t, uint32_t>; // (rank, block)
+    std::priority_queue<Ready, std::vector<Ready>, std::greater<Ready>> ready;
+    if (rootBlock) ready.push({ranker.rank[rootBlock], rootBlock});
+
+    std::vector<OctreeNode> nodes;
+    std::vector<uint32_t> lodColors;
+    nodes.reserve(oldCount);
+    nodes.push_back(m_nodes[0]);
+    if (lod) {
+        lodColors.reserve(oldCount);
+        lodColors.push_back(m_lodColors[0]);
+    }
+    std::vector<uint32_t> placed(oldCount, 0); // old block start -> new block start
+    while (!ready.empty()) {
+        uint32_t block = ready.top().second;
+        ready.pop();
+        placed[block] = static_cast<uint32_t>(nodes.size());
+        for (uint32_t c = 0; c < 8; ++c) {
+            nodes.push_back(m_nodes[block + c]);
+            if (lod) lodColors.push_back(m_lodColors[block + c]);
+            uint32_t child = ranker.childBlock(block + c);
+            if (child && --parents[child] == 0) ready.push({ranker.rank[child], child});
+        }
+    }
+
+    // Every node now sits in a block whose old position is known; rewrite pointers
+    std::vector<uint32_t> farPointers;
+    for (OctreeNode& node : nodes) {
+        if (node.data & OctreeNode::LEAF_BIT) continue;
+        uint32_t childPtr = childPointer(node.data);
+        if (childPtr != 0 && childPtr + 7ull < oldCount) {
+            node.data = pointerWord(placed[childPtr], farPointers);
+        }
+    }
+
+    m_nodes = std::move(nodes);
+    m_farPointers.swap(farPointers);
+    m_freeFarSlots.clear();
+    if (lod) m_lodColors = std::move(lodColors);
+    m_levelOffsets.clear();
+    m_nodeOrder = order;
+    m_childOrderBroken = false;
+    m_sharedBlockLimit = m_sharedBlocks ? m_nodes.size() : 0;
+    dropCachedEncoding();
+    markAllNodesDirty();
+
+    size_t bytesSaved = (oldCount - std::min(oldCount, m_nodes.size())) * sizeof(OctreeNode);
+    std::cout << "Laid out octree " << nodeOrderName(order) << ": " << oldCount << " -> "
+              << m_nodes.size() << " nodes (" << (bytesSaved / 1024) << " KB saved)" << std::endl;
+    return bytesSaved;
+}
+
+void SparseVoxelOctree::markNodesDirty(size_t begin, size_t end) {
+    if (m_allNodesDirty || begin >= end) return;
+    const size_t lastPage = (end - 1) / kDirtyPageNodes;
+    if (m_dirtyPages.size() <= lastPage / 64) m_dirtyPages.resize(lastPage / 64 + 1, 0);
+    for (size_t page = begin / kDirtyPageNodes; page <= lastPage; ++page) {
+        uint64_t bit = 1ull << (page % 64);
+        if (!(m_dirtyPages[page / 64] & bit)) {
+            m_dirtyPages[page / 64] |= bit;
+            m_dirtyPageCount++;
+        }
+    }
+}
+
+void SparseVoxelOctree::markAllNodesDirty() {
+    m_allNodesDirty = true;
+    m_dirtyPages.clear();
+    m_dirtyPageCount = 0;
+}
+
+std::vector<DirtyRange> SparseVoxelOctree::takeDirtyNodeRanges() {
+    std::vector<DirtyRange> ranges;
+    if (m_allNodesDirty) {
+        ranges.push_back({0, m_nodes.size()});
+    } else {
+        for (size_t w = 0; w < m_dirtyPages.size(); ++w) {
+            uint64_t bits = m_dirtyPages[w];
+            for (size_t b = 0; bits; ++b, bits >>= 1) {
+                if (!(bits & 1)) continue;
+                size_t page = w * 64 + b;
+                size_t begin = page * kDirtyPageNodes;
+                size_t end = std::min(begin + kDirtyPageNodes, m_nodes.size());
+                if (begin >= end) continue;
+                if (!ranges.empty() && ranges.back().end == begin) {
+                    ranges.back().end = end;
+                } else {
+                    ranges.push_back({begin, end});
+                }
             }
-        } else {
-            file.seekg(chunkSize, std::ios::cur);
         }
+    }
+    m_allNodesDirty = false;
+    m_dirtyPages.clear();
+    m_dirtyPageCount = 0;
+    return ranges;
+}
+
+size_t SparseVoxelOctree::takeDirtyColorsBegin() {
+    size_t begin = std::min(m_colorsDirtyBegin, m_colors.size());
+    m_colorsDirtyBegin = m_colors.size();
+    return begin;
+}
+
+size_t SparseVoxelOctree::takeDirtyFarBegin() {
+    size_t begin = std::min(m_farDirtyBegin, m_farPointers.size());
+    m_farDirtyBegin = m_farPointers.size();
+    return begin;
+}
+
+bool SparseVoxelOctree::takeEmissiveDirty() {
+    bool dirty = m_emissiveDirty;
+    m_emissiveDirty = false;
+    return dirty;
+}
+
+bool SparseVoxelOctree::rejectPagedTop(const char* pass) const {
+    if (!m_pagedTop) return false;
+    std::cerr << pass << ": not supported on a paged top tree" << std::endl;
+    return true;
+}
+
+void SparseVoxelOctree::dropCachedEncoding() {
+    m_cachedSparse = SparseNodeSpan{};
+    m_svoMapping.reset();
+}
+
+namespace {
+constexpr char kSvoMagic[4] = {'V', 'S', 'V', 'O'};
+constexpr uint32_t kSvoVersion = 3; // 2: bit 30 of internal nodes is the far pointer flag; 3: checksums
+constexpr uint32_t kSvoFlagMergedSubtrees = 1u << 0;
+constexpr uint32_t kSvoFlagUnordered = 1u << 1;    // copy-on-write edits left children before parents
+constexpr uint32_t kSvoNodeOrderShift = 2;          // bits 3:2 hold the NodeOrder of the node array
+constexpr uint32_t kSvoNodeOrderMask = 3u << kSvoNodeOrderShift;
+constexpr uint32_t kSvoFlagPaged = 1u << 4;        // top tree of savePagedFiles(); far pointers are page slots
+constexpr uint32_t kSvoFlagShared = 1u << 5;       // blocks with several parents (merged subtrees or instanced models)
+constexpr uint64_t kSvoAlignment = 64;
+
+// Element counts; every element is a uint32 except emissive (3 x uint32)
+struct SvoSection {
+    uint64_t offset;
+    uint64_t count;
+    uint64_t checksum; // svoChecksum() of the section's bytes
+};
+
+struct SvoFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t depth;
+    uint32_t flags;
+    uint64_t sourceHash;
+    SvoSection nodes;
+    SvoSection colors;
+    SvoSection emissive;
+    SvoSection lodColors;
+    SvoSection sparseNodes; // NodeFormat::SparseMask words, empty if not stored
+    SvoSection sparseLod;   // LOD colors in sparse word order
+    SvoSection farPointers; // child indices of FAR_BIT nodes, empty below 2^30 nodes
+    uint64_t headerChecksum; // svoChecksum() of every field above
+};
+static_assert(sizeof(SvoFileHeader) <= kSvoAlignment * 4, "header must fit before the first section");
+static_assert(sizeof(glm::uvec3) == 3 * sizeof(uint32_t), "emissive section is packed uvec3");
+
+uint64_t alignSvoOffset(uint64_t offset) {
+    return (offset + kSvoAlignment - 1) & ~(kSvoAlignment - 1);
+}
+
+// Four independent multiply-rotate lanes over 64-bit words, so checking a
+// section runs at memory bandwidth instead of walking its nodes. Catches
+// truncated, torn or bit-flipped caches; the cache is our own output, so
+// this is not meant to stand up to a crafted file.
+uint64_t svoChecksum(const void* data, uint64_t bytes) {
+    constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ull;
+    constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4Full;
+    auto round = [](uint64_t acc, uint64_t word) {
+        acc += word * kPrime2;
+        acc = (acc << 31) | (acc >> 33);
+        return acc * kPrime1;
+    };
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    uint64_t lanes[4] = {kPrime1 + kPrime2, kPrime2, 0, 0 - kPrime1};
+    uint64_t words[4];
+    uint64_t i = 0;
+    for (; i + sizeof(words) <= bytes; i += sizeof(words)) {
+        std::memcpy(words, p + i, sizeof(words));
+        for (int l = 0; l < 4; ++l) lanes[l] = round(lanes[l], words[l]);
+    }
+    uint64_t h = bytes;
+    for (uint64_t lane : lanes) h = round(h ^ round(0, lane), kPrime1);
+    for (; i < bytes; ++i) h = round(h, p[i]);
+    h ^= h >> 33;
+    h *= kPrime2;
+    return h ^ (h >> 29);
+}
+
+uint64_t svoHeaderChecksum(const SvoFileHeader& header) {
+    return svoChecksum(&header, offsetof(SvoFileHeader, headerChecksum));
+}
 
-        if (childrenSize > 0) {
-            file.seekg(childrenSize, std::ios::cur);
+bool svoSectionValid(const SvoSection& section, size_t elemSize, size_t fileSize) {
+    if (section.count == 0) return true;
+    if (section.offset % kSvoAlignment != 0) return false;
+    if (section.count > (fileSize - std::min<uint64_t>(section.offset, fileSize)) / elemSize) return false;
+    return section.offset < fileSize;
+}
+
+bool svoSectionIntact(const uint8_t* base, const SvoSection& section, size_t elemSize) {
+    return svoChecksum(base + section.offset, section.count * elemSize) == section.checksum;
+}
+} // namespace
+
+bool SparseVoxelOctree::saveSvoFile(const std::string& filepath, uint64_t sourceHash, NodeFormat gpuFormat) const {
+    std::vector<uint32_t> sparseNodes;
+    std::vector<uint32_t> sparseLod;
+    if (gpuFormat == NodeFormat::SparseMask) {
+        if (m_cachedSparse.count) {
+            sparseNodes.assign(m_cachedSparse.nodes, m_cachedSparse.nodes + m_cachedSparse.count);
+            sparseLod.assign(m_cachedSparse.lodColors, m_cachedSparse.lodColors + m_cachedSparse.count);
+        } else {
+            sparseNodes = encodeSparseNodes(&sparseLod);
         }
     }
 
-    if (!sizeLoaded) {
-        std::cerr << "Expected SIZE chunk" << std::endl;
+    SvoFileHeader header{};
+    std::memcpy(header.magic, kSvoMagic, sizeof(kSvoMagic));
+    header.version = kSvoVersion;
+    header.depth = m_depth;
+    header.flags = (m_mergedSubtrees ? kSvoFlagMergedSubtrees : 0u) | (m_childOrderBroken ? kSvoFlagUnordered : 0u) |
+                   (static_cast<uint32_t>(m_nodeOrder) << kSvoNodeOrderShift) | (m_pagedTop ? kSvoFlagPaged : 0u) |
+                   (m_sharedBlocks ? kSvoFlagShared : 0u);
+    header.sourceHash = sourceHash;
+
+    struct Pending { SvoSection* section; const void* data; size_t bytes; };
+    const bool haveLod = m_lodColors.size() == m_nodes.size();
+    const Pending sections[] = {
+        { &header.nodes, m_nodes.data(), m_nodes.size() * sizeof(OctreeNode) },
+        { &header.colors, m_colors.data(), m_colors.size() * sizeof(uint32_t) },
+        { &header.emissive, m_emissiveVoxels.data(), m_emissiveVoxels.size() * sizeof(glm::uvec3) },
+        { &header.lodColors, m_lodColors.data(), haveLod ? m_lodColors.size() * sizeof(uint32_t) : 0 },
+        { &header.sparseNodes, sparseNodes.data(), sparseNodes.size() * sizeof(uint32_t) },
+        { &header.sparseLod, sparseLod.data(), sparseLod.size() * sizeof(uint32_t) },
+        { &header.farPointers, m_farPointers.data(), m_farPointers.size() * sizeof(uint32_t) },
+    };
+
+    uint64_t offset = alignSvoOffset(sizeof(SvoFileHeader));
+    for (const Pending& p : sections) {
+        const size_t elemSize = (p.section == &header.emissive) ? sizeof(glm::uvec3) : sizeof(uint32_t);
+        p.section->offset = p.bytes ? offset : 0;
+        p.section->count = p.bytes / elemSize;
+        p.section->checksum = svoChecksum(p.data, p.bytes);
+        offset = alignSvoOffset(offset + p.bytes);
+    }
+    header.headerChecksum = svoHeaderChecksum(header);
+
+    // Write next to the target and rename so a crash never leaves a torn cache
+    const std::string tmpPath = filepath + ".tmp";
+    std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cerr << "Failed to create .svo file: " << tmpPath << std::endl;
+        return false;
+    }
+
+    static const char zeros[kSvoAlignment] = {};
+    uint64_t written = 0;
+    auto padTo = [&](uint64_t target) {
+        file.write(zeros, static_cast<std::streamsize>(target - written));
+        written = target;
+    };
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    written = sizeof(header);
+    for (const Pending& p : sections) {
+        if (!p.bytes) continue;
+        padTo(p.section->offset);
+        file.write(static_cast<const char*>(p.data), static_cast<std::streamsize>(p.bytes));
+        written += p.bytes;
+    }
+    file.close();
+    if (!file) {
+        std::cerr << "Failed to write .svo file: " << tmpPath << std::endl;
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    if (std::rename(tmpPath.c_str(), filepath.c_str()) != 0) {
+        std::cerr << "Failed to move .svo file into place: " << filepath << std::endl;
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+
+    std::cout << "Wrote .svo cache " << filepath << " (" << (written / 1024) << " KB)" << std::endl;
+    return true;
+}
+
+bool SparseVoxelOctree::loadFromSvoFile(const std::string& filepath, uint64_t expectedHash) {
+    auto mapping = std::make_shared<MappedFile>();
+    if (!mapping->open(filepath)) return false;
+
+    SvoFileHeader header{};
+    if (mapping->size() < sizeof(header)) {
+        std::cerr << "Truncated .svo file: " << filepath << std::endl;
+        return false;
+    }
+    std::memcpy(&header, mapping->data(), sizeof(header));
+    if (std::memcmp(header.magic, kSvoMagic, sizeof(kSvoMagic)) != 0 || header.version != kSvoVersion) {
+        std::cerr << "Unsupported .svo file (magic/version): " << filepath << std::endl;
         return false;
     }
+    if (header.headerChecksum != svoHeaderChecksum(header)) {
+        std::cerr << "Corrupt .svo header (checksum): " << filepath << std::endl;
+        return false;
+    }
+    if (expectedHash != 0 && header.sourceHash != expectedHash) {
+        std::cout << ".svo cache is stale: " << filepath << std::endl;
+        return false;
+    }
+
+    // Sections lie inside the file, in write order and without overlap, with
+    // the counts the writer pairs up. A node array that passes its checksum
+    // is the one saveSvoFile() wrote, so its words need no per-node check.
+    const size_t fileSize = mapping->size();
+    const std::pair<const SvoSection*, size_t> sections[] = {
+        {&header.nodes, sizeof(uint32_t)},       {&header.colors, sizeof(uint32_t)},
+        {&header.emissive, sizeof(glm::uvec3)},  {&header.lodColors, sizeof(uint32_t)},
+        {&header.sparseNodes, sizeof(uint32_t)}, {&header.sparseLod, sizeof(uint32_t)},
+        {&header.farPointers, sizeof(uint32_t)},
+    };
+    bool tableValid = header.depth != 0 && header.depth <= 22 && header.nodes.count != 0 &&
+                      (header.lodColors.count == 0 || header.lodColors.count == header.nodes.count) &&
+                      header.sparseLod.count == header.sparseNodes.count;
+    uint64_t sectionsEnd = alignSvoOffset(sizeof(SvoFileHeader));
+    for (const auto& section : sections) {
+        if (!tableValid || section.first->count == 0) continue;
+        tableValid = svoSectionValid(*section.first, section.second, fileSize) && section.first->offset >= sectionsEnd;
+        sectionsEnd = section.first->offset + section.first->count * section.second;
+    }
+    if (!tableValid) {
+        std::cerr << "Corrupt .svo section table: " << filepath << std::endl;
+        return false;
+    }
+
+    const uint8_t* base = mapping->data();
+    for (const auto& section : sections) {
+        if (section.first == &header.sparseNodes || section.first == &header.sparseLod) continue;
+        if (!svoSectionIntact(base, *section.first, section.second)) {
+            std::cerr << "Corrupt .svo section (checksum): " << filepath << std::endl;
+            return false;
+        }
+    }
+    // The sparse encoding is optional: a damaged one is dropped and the
+    // renderer encodes the (intact) node array again
+    bool sparseIntact = header.sparseNodes.count != 0 &&
+                        svoSectionIntact(base, header.sparseNodes, sizeof(uint32_t)) &&
+                        svoSectionIntact(base, header.sparseLod, sizeof(uint32_t));
+    if (header.sparseNodes.count != 0 && !sparseIntact) {
+        std::cerr << "Dropping corrupt sparse encoding of " << filepath << " (checksum)" << std::endl;
+    }
+    auto copySection = [base](const SvoSection& section, auto& out) {
+        out.resize(section.count);
+        if (section.count) std::memcpy(out.data(), base + section.offset, section.count * sizeof(out[0]));
+    };
+
+    m_depth = header.depth;
+    copySection(header.nodes, m_nodes);
+    copySection(header.farPointers, m_farPointers);
+    m_freeFarSlots.clear();
+    copySection(header.colors, m_colors);
+    copySection(header.emissive, m_emissiveVoxels);
+    if (header.lodColors.count == header.nodes.count) {
+        copySection(header.lodColors, m_lodColors);
+    } else {
+        m_lodColors.clear();
+    }
+    m_colorToIndex.clear();
+    m_colorToIndex.reserve(m_colors.size());
+    for (uint32_t i = 0; i < m_colors.size(); ++i) {
+        m_colorToIndex.findOrInsert(m_colors[i], i);
+    }
+    m_levelOffsets.clear();
+    m_mergedSubtrees = (header.flags & kSvoFlagMergedSubtrees) != 0;
+    m_childOrderBroken = (header.flags & kSvoFlagUnordered) != 0;
+    m_nodeOrder = static_cast<NodeOrder>((header.flags & kSvoNodeOrderMask) >> kSvoNodeOrderShift);
+    m_pagedTop = (header.flags & kSvoFlagPaged) != 0;
+    m_sharedBlocks = m_mergedSubtrees || (header.flags & kSvoFlagShared) != 0;
+    m_sharedBlockLimit = m_sharedBlocks ? m_nodes.size() : 0;
+    markAllNodesDirty();
+    m_colorsDirtyBegin = 0;
+    m_farDirtyBegin = 0;
+    m_emissiveDirty = true;
+
+    // The sparse encoding is handed out in place; keep the mapping alive for it
+    dropCachedEncoding();
+    if (sparseIntact) {
+        m_cachedSparse.nodes = reinterpret_cast<const uint32_t*>(base + header.sparseNodes.offset);
+        m_cachedSparse.lodColors = reinterpret_cast<const uint32_t*>(base + header.sparseLod.offset);
+        m_cachedSparse.count = header.sparseNodes.count;
+        m_svoMapping = std::move(mapping);
+    }
+
+    std::cout << "Loaded .svo cache " << filepath << ": " << m_nodes.size() << " nodes, "
+              << m_colors.size() << " colors, " << m_emissiveVoxels.size() << " emissive voxels" << std::endl;
+    return true;
+}
 
-    if (!voxelsLoaded) {
-        std::cerr << "Expected XYZI chunk" << std::endl;
+
+bool SparseVoxelOctree::savePagedFiles(const std::string& basePath, uint32_t pageLevel) const {
+    if (rejectPagedTop("savePagedFiles")) return false;
+    if (pageLevel == 0 || pageLevel + 2 > m_depth) {
+        std::cerr << "savePagedFiles: page level must lie in [1, " << (m_depth - 2) << "]" << std::endl;
+        return false;
+    }
+    if (m_lodColors.size() != m_nodes.size()) {
+        std::cerr << "savePagedFiles: LOD colors missing (call computeLodColors first)" << std::endl;
         return false;
     }
-    
-    if (!paletteLoaded) {
-        // Default palette if RGBA chunk not found
-        for (int i = 0; i < 256; ++i) {
-            uint8_t r = (i * 127) % 256;
-            uint8_t g = (i * 191) % 256;
-            uint8_t b = (i * 223) % 256;
-            uint8_t emissive = (r == 255 && g == 255 && b == 255) ? 255 : 0;
-            palette[i] = packColor(r, g, b, emissive);
-        }
-        std::cout << "Using default palette" << std::endl;
-    }
-
-    // Calculate offset to center the model in the grid
-    uint32_t gridSize = 1u << m_depth; // 2048 for depth 11
-    
-    // First pass: find actual bounding box of voxel data
-    uint8_t minX = 255, minY = 255, minZ = 255;
-    uint8_t maxX = 0, maxY = 0, maxZ = 0;
-    for (uint32_t i = 0; i < numVoxels; ++i) {
-        if (voxelData[i].colorIndex == 0) continue;
-        minX = std::min(minX, voxelData[i].x);
-        maxX = std::max(maxX, voxelData[i].x);
-        minY = std::min(minY, voxelData[i].y);
-        maxY = std::max(maxY, voxelData[i].y);
-        minZ = std::min(minZ, voxelData[i].z);
-        maxZ = std::max(maxZ, voxelData[i].z);
-    }
-    
-    uint32_t actualSizeX = maxX - minX + 1;
-    uint32_t actualSizeY = maxY - minY + 1;
-    uint32_t actualSizeZ = maxZ - minZ + 1;
-    
-    // After Z->Y conversion, actualSizeZ becomes height (Y axis), actualSizeY becomes depth (Z axis)
-    uint32_t instanceWidth = actualSizeX;   // X stays X
-    uint32_t instanceHeight = actualSizeZ;  // Z becomes Y
-    uint32_t instanceDepth = actualSizeY;   // Y becomes Z
-    
-    std::cout << "Original bounds: [" << (int)minX << "," << (int)maxX << "] ["
-              << (int)minY << "," << (int)maxY << "] [" << (int)minZ << "," << (int)maxZ << "]" << std::endl;
-    std::cout << "Actual size: " << actualSizeX << "x" << actualSizeY << "x" << actualSizeZ 
-              << " -> " << instanceWidth << "x" << instanceHeight << "x" << instanceDepth << " (after transform)" << std::endl;
-    
-    // Read voxel data
-    int voxelsAdded = 0;
-    int pureWhiteCount = 0;
-    
-    // Process each voxel
-    for (uint32_t i = 0; i < numVoxels; ++i) {
-        uint8_t x = voxelData[i].x;
-        uint8_t y = voxelData[i].y;
-        uint8_t z = voxelData[i].z;
-        uint8_t colorIndex = voxelData[i].colorIndex;
-
-        // MagicaVoxel uses 1-based color indices (0 = empty), so use colorIndex-1
-        if (colorIndex == 0) continue;  // Skip empty voxels
-
-        // Normalize to bounding box relative coordinates
-        int32_t relX = x - minX;
-        int32_t relY = y - minY;
-        int32_t relZ = z - minZ;
-        
-        // MagicaVoxel uses Z-up, convert to Y-up
-        // Flip Z to fix upside-down issue
-        int32_t voxX = relX;
-        int32_t voxY = (actualSizeZ - 1 - relZ);  // Z becomes Y, flipped
-        int32_t voxZ = relY;  // Y becomes Z
-
-        // Bounds check
-        if (voxX >= 0 && voxX < (int32_t)gridSize &&
-            voxY >= 0 && voxY < (int32_t)gridSize &&
-            voxZ >= 0 && voxZ < (int32_t)gridSize) {
-            
-            uint32_t color = palette[colorIndex - 1];  // Adjust for 1-based indexing
-            if ((color & 0x00FFFFFFu) == 0x00FFFFFFu) {
-                ++pureWhiteCount;
+
+    OctreePageWriter pages;
+    if (!pages.open(basePath + ".pages")) return false;
+    OctreePage page;
+
+    // Top tree, breadth-first. Blocks a DAG shares above the page level are
+    // copied per parent (that part is small); shared page roots share a page.
+    SparseVoxelOctree top(m_depth);
+    top.m_nodes.assign(1, m_nodes[0]);
+    top.m_lodColors.assign(1, m_lodColors[0]);
+    struct PendingBlock {
+        uint32_t block;    // in this tree
+        uint32_t topBlock; // in the top tree
+        uint32_t level;    // level of the block's nodes (root = 0)
+    };
+    std::deque<PendingBlock> pending;
+    std::unordered_map<uint32_t, uint32_t> pageOfBlock;
+    auto appendTopBlock = [&](uint32_t block, uint32_t level) {
+        const uint32_t topBlock = static_cast<uint32_t>(top.m_nodes.size());
+        top.m_nodes.resize(topBlock + 8, {0});
+        top.m_lodColors.resize(topBlock + 8, 0u);
+        pending.push_back({block, topBlock, level});
+        return topBlock;
+    };
+    if (const uint32_t rootBlock = childPointer(m_nodes[0].data)) {
+        top.m_nodes[0].data = appendTopBlock(rootBlock, 1);
+    }
+    bool ok = true;
+    while (!pending.empty() && ok) {
+        const PendingBlock p = pending.front();
+        pending.pop_front();
+        for (uint32_t c = 0; c < 8 && ok; ++c) {
+            uint32_t data = m_nodes[p.block + c].data;
+            const uint32_t child = childPointer(data);
+            if (child != 0 && p.level == pageLevel) {
+                auto it = pageOfBlock.emplace(child, pages.pageCount());
+                if (it.second) ok = collectPage(child, page) && pages.append(page);
+                data = OctreeNode::FAR_BIT | it.first->second;
+            } else if (child != 0) {
+                data = appendTopBlock(child, p.level + 1);
             }
-            setVoxel({(uint32_t)voxX, (uint32_t)voxY, (uint32_t)voxZ}, color);
-            voxelsAdded++;
-        }
-    }
-    
-    // Add a single emissive voxel adjacent to the model
-    uint32_t lightX = static_cast<uint32_t>(std::min<int32_t>(static_cast<int32_t>(instanceWidth), gridSize - 1));
-    uint32_t lightY = static_cast<uint32_t>(std::min<int32_t>(static_cast<int32_t>(instanceHeight) / 2, gridSize - 1));
-    uint32_t lightZ = static_cast<uint32_t>(std::min<int32_t>(static_cast<int32_t>(instanceDepth) / 2, gridSize - 1));
-    setVoxel({lightX, lightY, lightZ}, packColor(255, 255, 255, 255));
-
-    std::cout << "Successfully loaded " << filepath << " (" << voxelsAdded << " voxels added)" << std::endl;
-    std::cout << "Pure white voxels: " << pureWhiteCount << std::endl;
-    std::cout << "Octree has " << m_nodes.size() << " nodes and " << m_colors.size() << " unique colors (palette)" << std::endl;
-    std::cout << "Color deduplication ratio: " << (voxelsAdded / (float)m_colors.size()) << ":1" << std::endl;
-    
-    // Mark homogeneous nodes for traversal optimization
-    markHomogeneousNodes();
-    
+            top.m_nodes[p.topBlock + c].data = data;
+            top.m_lodColors[p.topBlock + c] = m_lodColors[p.block + c];
+        }
+        if (top.m_nodes.size() > OctreeNode::PAYLOAD_MASK) {
+            std::cerr << "savePagedFiles: top tree exceeds the 30-bit child pointer range; use a shallower page level" << std::endl;
+            ok = false;
+        }
+    }
+
+    if (!ok || !pages.finish()) return false;
+
+    // Page words resolve through the far table: one slot per page, 0 = not resident
+    top.m_colors = m_colors;
+    top.m_emissiveVoxels = m_emissiveVoxels;
+    top.m_farPointers.assign(pages.pageCount(), 0u);
+    top.m_pagedTop = true;
+    if (!top.saveSvoFile(basePath + ".svo", 0, NodeFormat::Dense)) return false;
+
+    std::cout << "Wrote paged octree " << basePath << ": " << top.m_nodes.size() << " top nodes, "
+              << pages.pageCount() << " pages (largest " << pages.maxPageNodes() << " nodes, "
+              << (pages.bytesWritten() >> 20) << " MB)" << std::endl;
     return true;
 }
 
-void SparseVoxelOctree::markHomogeneousNodes() {
-    uint32_t markedCount = 0;
-    uint32_t compressedCount = 0;
-    
-    // Process nodes from deepest to root (bottom-up)
-    // For each non-leaf node, check if all 8 children are identical leaves
-    for (int32_t i = m_nodes.size() - 1; i >= 0; --i) {
-        OctreeNode& node = m_nodes[i];
-        
-        // Skip if already a leaf
-        if (node.data & OctreeNode::LEAF_BIT) continue;
-        
-        uint32_t childPtr = node.data & 0x3FFFFFFFu;
-        if (childPtr == 0 || childPtr + 7 >= m_nodes.size()) continue;
-        
-        // Check if all 8 children are identical leaves with same color
-        bool allSameLeaves = true;
-        uint32_t firstChild = m_nodes[childPtr].data;
-        
-        // First child must be a leaf
-        if (!(firstChild & OctreeNode::LEAF_BIT)) continue;
-        
-        for (uint32_t j = 1; j < 8; ++j) {
-            if (m_nodes[childPtr + j].data != firstChild) {
-                allSameLeaves = false;
-                break;
+bool SparseVoxelOctree::collectPage(uint32_t block, OctreePage& page) const {
+    page.nodes.clear();
+    page.lodColors.clear();
+    std::vector<uint32_t> blocks(1, block);
+    std::unordered_map<uint32_t, uint32_t> localBlock;
+    localBlock.emplace(block, 0u);
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        for (uint32_t c = 0; c < 8; ++c) {
+            uint32_t data = m_nodes[blocks[b] + c].data;
+            const uint32_t child = childPointer(data);
+            if (child != 0) {
+                auto it = localBlock.emplace(child, static_cast<uint32_t>(blocks.size() * 8));
+                if (it.second) blocks.push_back(child);
+                data = it.first->second;
             }
+            page.nodes.push_back(data);
+            page.lodColors.push_back(m_lodColors[blocks[b] + c]);
         }
-        
-        // If all children are identical leaves, compress this node to a leaf
-        if (allSameLeaves) {
-            uint32_t colorIdx = firstChild & 0x3FFFFFFFu;
-            // Convert this node to a leaf with the same color, mark as homogeneous
-            node.data = OctreeNode::LEAF_BIT | OctreeNode::HOMOGENEOUS_BIT | colorIdx;
-            compressedCount++;
-            markedCount++;
-            // Note: We don't delete children here to avoid invalidating indices
-            // In a production system, you'd compact the node array
-        } else {
-            // Just mark as homogeneous but keep children for traversal
-            node.data |= OctreeNode::HOMOGENEOUS_BIT;
-            markedCount++;
+        if (blocks.size() * 8 > OctreeNode::PAYLOAD_MASK) {
+            std::cerr << "Octree page exceeds the 30-bit child pointer range; use a deeper page level" << std::endl;
+            return false;
         }
     }
-    
-    std::cout << "Marked " << markedCount << " homogeneous nodes (" 
-              << compressedCount << " compressed to leaves)" << std::endl;
+    return true;
 }
 
 } // namespace vox
@@ -0,0 +1,473 @@
+#include "vox/SparseVoxelOctree.h"
+#include "vox/MappedFile.h"
+#include "vox/ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace vox {
+
+namespace {
+
+constexpr uint32_t kDefaultMeshColor = 0xC8C8C8u;
+constexpr uint32_t kTileCells = 64; // x/y extent of a rasterization bin
+
+// Word-at-a-time reader over one line-oriented text file (.obj, .mtl)
+struct TextCursor {
+    const char* p;
+    const char* end;
+
+    void skipSpaces() {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) ++p;
+    }
+    void nextLine() {
+        while (p < end && *p != '\n') ++p;
+        if (p < end) ++p;
+    }
+    std::string word() {
+        skipSpaces();
+        const char* begin = p;
+        while (p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') ++p;
+        return std::string(begin, p);
+    }
+    std::string rest() { // remainder of the line, trimmed
+        skipSpaces();
+        const char* begin = p;
+        while (p < end && *p != '\n') ++p;
+        const char* last = p;
+        while (last > begin && (last[-1] == ' ' || last[-1] == '\t' || last[-1] == '\r')) --last;
+        return std::string(begin, last);
+    }
+    bool integer(int64_t& out) {
+        skipSpaces();
+        const bool negative = p < end && *p == '-';
+        if (p < end && (*p == '-' || *p == '+')) ++p;
+        if (p >= end || *p < '0' || *p > '9') return false;
+        int64_t v = 0;
+        while (p < end && *p >= '0' && *p <= '9') v = v * 10 + (*p++ - '0');
+        out = negative ? -v : v;
+        return true;
+    }
+    bool number(float& out) {
+        skipSpaces();
+        const char* start = p;
+        const bool negative = p < end && *p == '-';
+        if (p < end && (*p == '-' || *p == '+')) ++p;
+        double v = 0.0;
+        bool digits = false;
+        while (p < end && *p >= '0' && *p <= '9') {
+            v = v * 10.0 + (*p++ - '0');
+            digits = true;
+        }
+        if (p < end && *p == '.') {
+            ++p;
+            double scale = 0.1;
+            while (p < end && *p >= '0' && *p <= '9') {
+                v += (*p++ - '0') * scale;
+                scale *= 0.1;
+                digits = true;
+            }
+        }
+        if (!digits) {
+            p = start;
+            return false;
+        }
+        if (p < end && (*p == 'e' || *p == 'E')) {
+            ++p;
+            int64_t exponent = 0;
+            if (integer(exponent)) v *= std::pow(10.0, static_cast<double>(exponent));
+        }
+        out = static_cast<float>(negative ? -v : v);
+        return true;
+    }
+};
+
+struct MeshTriangle {
+    uint32_t v[3];
+    uint32_t color; // material color, used unless all three vertices have one
+};
+
+struct ObjMesh {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> vertexColors; // 0..1, x < 0 = none
+    std::vector<MeshTriangle> triangles;
+};
+
+uint32_t packRgb(const glm::vec3& c) {
+    auto channel = [](float v) { return static_cast<uint32_t>(std::min(std::max(v, 0.0f), 1.0f) * 255.0f + 0.5f); };
+    return (channel(c.x) << 16) | (channel(c.y) << 8) | channel(c.z);
+}
+
+// newmtl / Kd pairs of a .mtl file
+void parseMtl(const std::string& path, std::unordered_map<std::string, uint32_t>& materials) {
+    MappedFile file;
+    if (!file.open(path)) {
+        std::cerr << "Failed to open material library " << path << std::endl;
+        return;
+    }
+    TextCursor in{reinterpret_cast<const char*>(file.data()), reinterpret_cast<const char*>(file.data()) + file.size()};
+    std::string current;
+    bool textures = false;
+    while (in.p < in.end) {
+        const std::string key = in.word();
+        if (key == "newmtl") {
+            current = in.rest();
+            materials[current] = kDefaultMeshColor;
+        } else if (key == "Kd" && !current.empty()) {
+            glm::vec3 kd(0.0f);
+            if (in.number(kd.x) && in.number(kd.y) && in.number(kd.z)) materials[current] = packRgb(kd);
+        } else if (key == "map_Kd") {
+            textures = true;
+        }
+        in.nextLine();
+    }
+    if (textures) std::cout << path << ": diffuse textures are not sampled, using the Kd colors" << std::endl;
+}
+
+bool parseObj(const std::string& path, ObjMesh& mesh) {
+    MappedFile file;
+    if (!file.open(path)) {
+        std::cerr << "Failed to open .obj file: " << path << std::endl;
+        return false;
+    }
+    const size_t slash = path.find_last_of("/\\");
+    const std::string directory = slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+
+    std::unordered_map<std::string, uint32_t> materials;
+    uint32_t color = kDefaultMeshColor;
+    bool anyVertexColor = false;
+    std::vector<uint32_t> face;
+    TextCursor in{reinterpret_cast<const char*>(file.data()), reinterpret_cast<const char*>(file.data()) + file.size()};
+    while (in.p < in.end) {
+        in.skipSpaces();
+        if (in.p + 1 < in.end && in.p[0] == 'v' && (in.p[1] == ' ' || in.p[1] == '\t')) {
+            in.p += 2;
+            glm::vec3 pos(0.0f), rgb(-1.0f);
+            if (in.number(pos.x) && in.number(pos.y) && in.number(pos.z)) {
+                if (in.number(rgb.x) && in.number(rgb.y) && in.number(rgb.z)) {
+                    if (rgb.x > 1.0f || rgb.y > 1.0f || rgb.z > 1.0f) rgb = rgb / 255.0f; // 0-255 exporters
+                    anyVertexColor = true;
+                } else {
+                    rgb = glm::vec3(-1.0f);
+                }
+                mesh.positions.push_back(pos);
+                mesh.vertexColors.push_back(rgb);
+            }
+        } else if (in.p + 1 < in.end && in.p[0] == 'f' && (in.p[1] == ' ' || in.p[1] == '\t')) {
+            // v, v/vt, v//vn or v/vt/vn; negative indices count back from the last vertex
+            in.p += 2;
+            face.clear();
+            int64_t index = 0;
+            while (in.integer(index)) {
+                const int64_t resolved = index < 0 ? static_cast<int64_t>(mesh.positions.size()) + index : index - 1;
+                if (resolved < 0 || resolved >= static_cast<int64_t>(mesh.positions.size())) {
+                    std::cerr << path << ": face index " << index << " out of range" << std::endl;
+                    return false;
+                }
+                face.push_back(static_cast<uint32_t>(resolved));
+                while (in.p < in.end && *in.p != ' ' && *in.p != '\t' && *in.p != '\r' && *in.p != '\n') ++in.p;
+            }
+            for (size_t i = 2; i < face.size(); ++i) {
+                mesh.triangles.push_back({{face[0], face[i - 1], face[i]}, color});
+            }
+        } else {
+            const std::string key = in.word();
+            if (key == "mtllib") {
+                parseMtl(directory + in.rest(), materials);
+            } else if (key == "usemtl") {
+                auto it = materials.find(in.rest());
+                color = it != materials.end() ? it->second : kDefaultMeshColor;
+            }
+        }
+        in.nextLine();
+    }
+    if (!anyVertexColor) mesh.vertexColors.clear();
+    return true;
+}
+
+// Cell value (0 = empty) of an RGB color: 5 bits per channel, plus one
+uint16_t colorValue(uint32_t rgb) {
+    const uint32_t r = (rgb >> 19) & 31u, g = (rgb >> 11) & 31u, b = (rgb >> 3) & 31u;
+    return static_cast<uint16_t>(((r << 10) | (g << 5) | b) + 1);
+}
+
+// Conservative triangle / unit cell overlap after Schwarz and Seidel, "Fast
+// Parallel Surface and Solid Voxelization on GPUs" (2010): the cell must
+// straddle the triangle's plane and overlap it in all three axis-aligned
+// projections.
+struct TriangleSetup {
+    glm::vec3 n;
+    float d1, d2;
+    glm::vec3 edgeN[3][3]; // [dropped axis][edge]: 2D edge normal in its first two components
+    float edgeD[3][3];
+
+    explicit TriangleSetup(const glm::vec3 v[3]) {
+        n = glm::cross(v[1] - v[0], v[2] - v[0]);
+        const glm::vec3 critical(n.x > 0.0f ? 1.0f : 0.0f, n.y > 0.0f ? 1.0f : 0.0f, n.z > 0.0f ? 1.0f : 0.0f);
+        d1 = glm::dot(n, critical - v[0]);
+        d2 = glm::dot(n, (glm::vec3(1.0f) - critical) - v[0]);
+        for (int k = 0; k < 3; ++k) {
+            const int i = (k + 1) % 3, j = (k + 2) % 3;
+            const float orient = n[k] >= 0.0f ? 1.0f : -1.0f;
+            for (int e = 0; e < 3; ++e) {
+                const glm::vec3& a = v[e];
+                const glm::vec3& b = v[(e + 1) % 3];
+                const float nx = -(b[j] - a[j]) * orient, ny = (b[i] - a[i]) * orient;
+                edgeN[k][e] = glm::vec3(nx, ny, 0.0f);
+                edgeD[k][e] = -(nx * a[i] + ny * a[j]) + std::max(0.0f, nx) + std::max(0.0f, ny);
+            }
+        }
+    }
+    bool overlaps2D(int k, const glm::vec3& p) const {
+        const int i = (k + 1) % 3, j = (k + 2) % 3;
+        for (int e = 0; e < 3; ++e) {
+            if (edgeN[k][e].x * p[i] + edgeN[k][e].y * p[j] + edgeD[k][e] < 0.0f) return false;
+        }
+        return true;
+    }
+    bool overlapsPlane(const glm::vec3& p) const {
+        const float np = glm::dot(n, p);
+        return (np + d1) * (np + d2) <= 0.0f;
+    }
+};
+
+} // namespace
+
+bool SparseVoxelOctree::loadFromObjFile(const std::string& filepath, bool solidFill) {
+    ObjMesh mesh;
+    if (!parseObj(filepath, mesh)) return false;
+    if (mesh.triangles.empty()) {
+        std::cerr << "No triangles in " << filepath << std::endl;
+        return false;
+    }
+    if (m_depth < kRawBlockLevels || m_depth > 20) {
+        std::cerr << "loadFromObjFile: unsupported octree depth " << m_depth << std::endl;
+        return false;
+    }
+
+    // Scale the mesh uniformly into the grid of leaf cells
+    const uint32_t gridCells = 1u << (m_depth - 1);
+    glm::vec3 lo(std::numeric_limits<float>::max()), hi(-std::numeric_limits<float>::max());
+    for (const MeshTriangle& t : mesh.triangles) {
+        for (uint32_t k = 0; k < 3; ++k) {
+            lo = glm::min(lo, mesh.positions[t.v[k]]);
+            hi = glm::max(hi, mesh.positions[t.v[k]]);
+        }
+    }
+    const float extent = std::max({hi.x - lo.x, hi.y - lo.y, hi.z - lo.z});
+    const float scale = extent > 0.0f ? static_cast<float>(gridCells) * 0.999f / extent : 1.0f;
+    for (glm::vec3& p : mesh.positions) p = (p - lo) * scale;
+    const glm::vec3 size = (hi - lo) * scale;
+    const glm::ivec3 cellMax(std::min<int32_t>(static_cast<int32_t>(size.x), gridCells - 1),
+                             std::min<int32_t>(static_cast<int32_t>(size.y), gridCells - 1),
+                             std::min<int32_t>(static_cast<int32_t>(size.z), gridCells - 1));
+    const glm::uvec3 cells(cellMax + glm::ivec3(1));
+
+    // Bin triangles by z slab and x/y tile of their cell bounds. Solid fill
+    // also needs the slab just above, where a crossing may round to.
+    const uint32_t slabCells = 1u << (kRawBlockLevels - 1);
+    const uint32_t tilesX = (cells.x + kTileCells - 1) / kTileCells;
+    const uint32_t tilesY = (cells.y + kTileCells - 1) / kTileCells;
+    const uint32_t slabs = (cells.z + slabCells - 1) / slabCells;
+    struct TriangleBounds {
+        glm::ivec3 lo, hi;
+    };
+    std::vector<TriangleBounds> bounds(mesh.triangles.size());
+    auto binRange = [&](const TriangleBounds& b, glm::uvec3& binLo, glm::uvec3& binHi) {
+        const int32_t top = std::min(b.hi.z + (solidFill ? 1 : 0), cellMax.z);
+        binLo = glm::uvec3(b.lo.x / kTileCells, b.lo.y / kTileCells, b.lo.z / slabCells);
+        binHi = glm::uvec3(b.hi.x / kTileCells, b.hi.y / kTileCells, top / slabCells);
+    };
+    std::vector<uint32_t> binStart(static_cast<size_t>(slabs) * tilesY * tilesX + 1, 0u);
+    auto binIndex = [&](uint32_t slab, uint32_t ty, uint32_t tx) { return (static_cast<size_t>(slab) * tilesY + ty) * tilesX + tx; };
+    for (size_t t = 0; t < mesh.triangles.size(); ++t) {
+        const MeshTriangle& tri = mesh.triangles[t];
+        glm::vec3 tlo = mesh.positions[tri.v[0]], thi = tlo;
+        for (uint32_t k = 1; k < 3; ++k) {
+            tlo = glm::min(tlo, mesh.positions[tri.v[k]]);
+            thi = glm::max(thi, mesh.positions[tri.v[k]]);
+        }
+        TriangleBounds& b = bounds[t];
+        b.lo = glm::clamp(glm::ivec3(glm::floor(tlo)), glm::ivec3(0), cellMax);
+        b.hi = glm::clamp(glm::ivec3(glm::floor(thi)), glm::ivec3(0), cellMax);
+        glm::uvec3 binLo, binHi;
+        binRange(b, binLo, binHi);
+        for (uint32_t s = binLo.z; s <= binHi.z; ++s)
+            for (uint32_t ty = binLo.y; ty <= binHi.y; ++ty)
+                for (uint32_t tx = binLo.x; tx <= binHi.x; ++tx) binStart[binIndex(s, ty, tx) + 1]++;
+    }
+    for (size_t i = 1; i < binStart.size(); ++i) binStart[i] += binStart[i - 1];
+    std::vector<uint32_t> binTriangles(binStart.back());
+    {
+        std::vector<uint32_t> cursor(binStart.begin(), binStart.end() - 1);
+        for (size_t t = 0; t < mesh.triangles.size(); ++t) {
+            glm::uvec3 binLo, binHi;
+            binRange(bounds[t], binLo, binHi);
+            for (uint32_t s = binLo.z; s <= binHi.z; ++s)
+                for (uint32_t ty = binLo.y; ty <= binHi.y; ++ty)
+                    for (uint32_t tx = binLo.x; tx <= binHi.x; ++tx) {
+                        binTriangles[cursor[binIndex(s, ty, tx)]++] = static_cast<uint32_t>(t);
+                    }
+        }
+    }
+
+    std::vector<uint32_t> valueColors(1u + (1u << 15), 0u);
+    for (uint32_t code = 0; code < (1u << 15); ++code) {
+        auto expand = [](uint32_t c) { return (c << 3) | (c >> 2); };
+        valueColors[code + 1] = (expand(code >> 10) << 16) | (expand((code >> 5) & 31u) << 8) | expand(code & 31u);
+    }
+    const bool vertexColors = !mesh.vertexColors.empty();
+    auto triangleColor = [&](const MeshTriangle& tri, const glm::vec3& weights) {
+        if (!vertexColors) return tri.color;
+        const glm::vec3& c0 = mesh.vertexColors[tri.v[0]];
+        const glm::vec3& c1 = mesh.vertexColors[tri.v[1]];
+        const glm::vec3& c2 = mesh.vertexColors[tri.v[2]];
+        if (c0.x < 0.0f || c1.x < 0.0f || c2.x < 0.0f) return tri.color;
+        return packRgb(c0 * weights.x + c1 * weights.y + c2 * weights.z);
+    };
+
+    // Surface: every cell of the tile and slab a triangle overlaps, walked
+    // as columns along the normal's dominant axis
+    auto rasterize = [&](const MeshTriangle& tri, const TriangleBounds& b, glm::ivec3 clipLo, glm::ivec3 clipHi,
+                         uint16_t* out, size_t rowStride, size_t layerStride) {
+        const glm::vec3 v[3] = {mesh.positions[tri.v[0]], mesh.positions[tri.v[1]], mesh.positions[tri.v[2]]};
+        const TriangleSetup setup(v);
+        if (setup.n.x == 0.0f && setup.n.y == 0.0f && setup.n.z == 0.0f) return; // degenerate
+        const glm::ivec3 lo = glm::max(b.lo, clipLo), hi = glm::min(b.hi, clipHi);
+        if (lo.x > hi.x || lo.y > hi.y || lo.z > hi.z) return;
+        const glm::vec3 an = glm::abs(setup.n);
+        const int w = (an.x >= an.y && an.x >= an.z) ? 0 : (an.y >= an.z ? 1 : 2);
+        const int u = (w + 1) % 3, vAxis = (w + 2) % 3;
+        const float planeD = glm::dot(setup.n, v[0]);
+        const uint16_t flat = colorValue(tri.color);
+        const float area = (v[1][u] - v[0][u]) * (v[2][vAxis] - v[0][vAxis]) - (v[1][vAxis] - v[0][vAxis]) * (v[2][u] - v[0][u]);
+
+        glm::vec3 p(0.0f);
+        for (int32_t cu = lo[u]; cu <= hi[u]; ++cu) {
+            p[u] = static_cast<float>(cu);
+            for (int32_t cv = lo[vAxis]; cv <= hi[vAxis]; ++cv) {
+                p[vAxis] = static_cast<float>(cv);
+                if (!setup.overlaps2D(w, p)) continue;
+                // Plane height over the column's corners bounds the cells to test
+                float wMin = std::numeric_limits<float>::max(), wMax = -wMin;
+                for (int corner = 0; corner < 4; ++corner) {
+                    const float pu = p[u] + (corner & 1), pv = p[vAxis] + (corner >> 1);
+                    const float pw = (planeD - setup.n[u] * pu - setup.n[vAxis] * pv) / setup.n[w];
+                    wMin = std::min(wMin, pw);
+                    wMax = std::max(wMax, pw);
+                }
+                const int32_t w0 = std::max(lo[w], static_cast<int32_t>(std::floor(wMin)));
+                const int32_t w1 = std::min(hi[w], static_cast<int32_t>(std::floor(wMax)));
+                uint16_t value = flat;
+                if (vertexColors && w0 <= w1 && area != 0.0f) {
+                    // Barycentrics of the column center in the projection
+                    const float cu0 = p[u] + 0.5f, cv0 = p[vAxis] + 0.5f;
+                    auto edge = [&](const glm::vec3& a, const glm::vec3& b) {
+                        return (b[u] - a[u]) * (cv0 - a[vAxis]) - (b[vAxis] - a[vAxis]) * (cu0 - a[u]);
+                    };
+                    glm::vec3 weights(std::max(0.0f, edge(v[1], v[2]) / area), std::max(0.0f, edge(v[2], v[0]) / area),
+                                      std::max(0.0f, edge(v[0], v[1]) / area));
+                    const float sum = weights.x + weights.y + weights.z;
+                    weights = sum > 0.0f ? weights / sum : glm::vec3(1.0f / 3.0f);
+                    value = colorValue(triangleColor(tri, weights));
+                }
+                for (int32_t cw = w0; cw <= w1; ++cw) {
+                    p[w] = static_cast<float>(cw);
+                    if (!setup.overlapsPlane(p) || !setup.overlaps2D(u, p) || !setup.overlaps2D(vAxis, p)) continue;
+                    const glm::ivec3 cell(static_cast<int32_t>(p.x), static_cast<int32_t>(p.y), static_cast<int32_t>(p.z));
+                    out[(cell.z - clipLo.z) * layerStride + cell.y * rowStride + cell.x] = value;
+                }
+            }
+        }
+    };
+
+    // Solid fill: a +z ray from a column center toggles inside/outside at
+    // the first cell center above each triangle it crosses. Centers on a
+    // shared edge go to exactly one of its triangles (top-left rule).
+    auto crossings = [&](const MeshTriangle& tri, const TriangleBounds& b, glm::ivec3 clipLo, glm::ivec3 clipHi,
+                         uint8_t* flips, size_t rowStride, size_t layerStride) {
+        glm::vec3 v[3] = {mesh.positions[tri.v[0]], mesh.positions[tri.v[1]], mesh.positions[tri.v[2]]};
+        const double area = static_cast<double>(v[1].x - v[0].x) * (v[2].y - v[0].y) -
+                            static_cast<double>(v[1].y - v[0].y) * (v[2].x - v[0].x);
+        if (area == 0.0) return;
+        if (area < 0.0) std::swap(v[1], v[2]);
+        const glm::vec3 n = glm::cross(v[1] - v[0], v[2] - v[0]);
+        const double planeD = glm::dot(n, v[0]);
+        const int32_t x0 = std::max(b.lo.x, clipLo.x), x1 = std::min(b.hi.x, clipHi.x);
+        const int32_t y0 = std::max(b.lo.y, clipLo.y), y1 = std::min(b.hi.y, clipHi.y);
+        for (int32_t y = y0; y <= y1; ++y) {
+            const double cy = y + 0.5;
+            for (int32_t x = x0; x <= x1; ++x) {
+                const double cx = x + 0.5;
+                bool inside = true;
+                for (int e = 0; e < 3 && inside; ++e) {
+                    const glm::vec3& a = v[e];
+                    const glm::vec3& c = v[(e + 1) % 3];
+                    const double ex = static_cast<double>(c.x) - a.x, ey = static_cast<double>(c.y) - a.y;
+                    const double f = ex * (cy - a.y) - ey * (cx - a.x);
+                    inside = f > 0.0 || (f == 0.0 && (ey > 0.0 || (ey == 0.0 && ex > 0.0)));
+                }
+                if (!inside) continue;
+                const double z = (planeD - n.x * cx - n.y * cy) / n.z;
+                const int64_t zc = std::max<int64_t>(0, static_cast<int64_t>(std::floor(z - 0.5)) + 1);
+                if (zc < clipLo.z || zc > clipHi.z) continue;
+                flips[(zc - clipLo.z) * layerStride + static_cast<size_t>(y) * rowStride + x] ^= 1u;
+            }
+        }
+    };
+
+    ThreadPool pool(m_buildThreads);
+    std::vector<uint8_t> flips;
+    std::vector<uint8_t> insideColumn(solidFill ? static_cast<size_t>(cells.x) * cells.y : 0, 0);
+    std::vector<uint16_t> columnColor(insideColumn.size(), colorValue(kDefaultMeshColor));
+    auto fillSlab = [&](uint32_t slab, uint16_t* out, size_t rowStride, size_t layerStride) {
+        const int32_t z0 = static_cast<int32_t>(slab * slabCells);
+        const int32_t z1 = std::min<int32_t>(z0 + slabCells - 1, cellMax.z);
+        if (solidFill) flips.assign(slabCells * layerStride, 0);
+        pool.parallelFor(static_cast<size_t>(tilesX) * tilesY, [&](size_t tile) {
+            const uint32_t tx = static_cast<uint32_t>(tile % tilesX), ty = static_cast<uint32_t>(tile / tilesX);
+            const glm::ivec3 clipLo(tx * kTileCells, ty * kTileCells, z0);
+            const glm::ivec3 clipHi(std::min<int32_t>(clipLo.x + kTileCells - 1, cellMax.x),
+                                    std::min<int32_t>(clipLo.y + kTileCells - 1, cellMax.y), z1);
+            const size_t bin = binIndex(slab, ty, tx);
+            for (uint32_t i = binStart[bin]; i < binStart[bin + 1]; ++i) {
+                const uint32_t t = binTriangles[i];
+                rasterize(mesh.triangles[t], bounds[t], clipLo, clipHi, out, rowStride, layerStride);
+                if (solidFill) crossings(mesh.triangles[t], bounds[t], clipLo, clipHi, flips.data(), rowStride, layerStride);
+            }
+        });
+        if (!solidFill) return true;
+
+        // Sweep the slab upwards; enclosed cells take the color of the
+        // surface cell below them
+        pool.parallelFor(cells.y, [&](size_t y) {
+            for (uint32_t x = 0; x < cells.x; ++x) {
+                const size_t column = y * cells.x + x;
+                for (int32_t z = z0; z <= z1; ++z) {
+                    const size_t idx = (z - z0) * layerStride + y * rowStride + x;
+                    insideColumn[column] ^= flips[idx];
+                    if (out[idx] != 0) {
+                        columnColor[column] = out[idx];
+                    } else if (insideColumn[column]) {
+                        out[idx] = columnColor[column];
+                    }
+                }
+            }
+        });
+        return true;
+    };
+    const uint64_t solidCells = buildFromCellSlabs(cells, valueColors, fillSlab);
+    if (solidCells == kSlabBuildFailed) return false;
+
+    std::cout << "Voxelized " << filepath << ": " << mesh.triangles.size() << " triangles into " << solidCells
+              << (solidFill ? " solid" : " surface") << " cells, " << m_nodes.size() << " nodes, "
+              << m_colors.size() << " colors" << std::endl;
+    return true;
+}
+
+} // namespace vox
@@ -0,0 +1,320 @@
+#include "vox/SparseVoxelOctree.h"
+#include "vox/ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+namespace vox {
+
+namespace {
+
+uint64_t mixBits(uint64_t h) {
+    h ^= h >> 30;
+    h *= 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 27;
+    h *= 0x94D049BB133111EBull;
+    return h ^ (h >> 31);
+}
+
+// Uniform 32-bit hash of a lattice point (coordinates below 2^21)
+uint32_t cellHash(uint64_t seed, uint32_t x, uint32_t y, uint32_t z) {
+    const uint64_t key = x | (static_cast<uint64_t>(y) << 21) | (static_cast<uint64_t>(z) << 42);
+    return static_cast<uint32_t>(mixBits(seed * 0x9E3779B97F4A7C15ull + key) >> 32);
+}
+
+float unitFloat(uint32_t h) { return static_cast<float>(h >> 8) * (1.0f / 16777216.0f); }
+
+// cellHash() below this has probability p
+uint64_t chanceThreshold(float p) {
+    if (p <= 0.0f) return 0;
+    if (p >= 1.0f) return 1ull << 32;
+    return static_cast<uint64_t>(static_cast<double>(p) * 4294967296.0);
+}
+
+// Smoothly interpolated lattice values in [0, 1]
+float valueNoise(uint64_t seed, float x, float z) {
+    const float fx = std::floor(x), fz = std::floor(z);
+    const uint32_t ix = static_cast<uint32_t>(static_cast<int32_t>(fx));
+    const uint32_t iz = static_cast<uint32_t>(static_cast<int32_t>(fz));
+    float tx = x - fx, tz = z - fz;
+    tx = tx * tx * (3.0f - 2.0f * tx);
+    tz = tz * tz * (3.0f - 2.0f * tz);
+    const float v00 = unitFloat(cellHash(seed, ix & 0x1FFFFFu, 0, iz & 0x1FFFFFu));
+    const float v10 = unitFloat(cellHash(seed, (ix + 1) & 0x1FFFFFu, 0, iz & 0x1FFFFFu));
+    const float v01 = unitFloat(cellHash(seed, ix & 0x1FFFFFu, 0, (iz + 1) & 0x1FFFFFu));
+    const float v11 = unitFloat(cellHash(seed, (ix + 1) & 0x1FFFFFu, 0, (iz + 1) & 0x1FFFFFu));
+    const float a = v00 + (v10 - v00) * tx;
+    const float b = v01 + (v11 - v01) * tx;
+    return a + (b - a) * tz;
+}
+
+// Palettes: value v in 1..K is color v - 1, K+1..2K the same color emitting
+constexpr uint32_t kTerrainColors[] = {0xC2B280, 0x5A8F3C, 0x3B6B2A, 0x7A7066, 0xF0F0F5, 0x6B4F35};
+enum TerrainColor : uint16_t { Sand, Grass, Forest, Rock, Snow, Dirt };
+
+constexpr uint32_t kCityColors[] = {0x3A3A3F, 0x9A9A95, 0x4E7D3A, 0xB8B0A0, 0x8C8C94, 0xA0522D,
+                                    0xD2C8B4, 0x6E7B8B, 0xC0C8D0, 0x2A3848, 0x505055, 0xFFD890};
+enum CityColor : uint16_t { Asphalt, Pavement, Park, Tint0, Window = Tint0 + 6, Roof, WindowLight };
+
+constexpr uint32_t kPointColors[] = {0x30307F, 0x2060C0, 0x20A0C0, 0x40C080, 0xA0D040, 0xF0C030, 0xF07020, 0xC02020};
+constexpr uint32_t kMengerColors[] = {0xD0D0D8, 0xC06040, 0x4080C0, 0x60A060, 0xC0A040, 0x9060B0};
+
+template <size_t K>
+std::vector<uint32_t> paletteValues(const uint32_t (&colors)[K]) {
+    std::vector<uint32_t> values(1, 0u);
+    values.insert(values.end(), colors, colors + K);
+    for (uint32_t c : colors) values.push_back(c | 0xFF000000u);
+    return values;
+}
+
+template <size_t K>
+uint16_t cellValue(const uint32_t (&)[K], uint16_t color, bool emissive) {
+    return static_cast<uint16_t>(1 + color + (emissive ? K : 0));
+}
+
+// Slab of cells [z0, z0 + layers) as handed out by buildFromCellSlabs
+struct SlabCells {
+    uint16_t* cells;
+    size_t rowStride, layerStride;
+    uint32_t z0, layers;
+
+    uint16_t& at(uint32_t x, uint32_t y, uint32_t z) const {
+        return cells[(z - z0) * layerStride + y * rowStride + x];
+    }
+};
+
+// Terrain: heights of one slab of columns plus a ring of neighbours
+// (0 outside the grid, so the border is exposed)
+class Terrain {
+public:
+    Terrain(const ProceduralSceneDesc& desc, uint32_t n)
+        : m_desc(desc), m_n(n), m_emissive(chanceThreshold(desc.emissiveDensity)) {}
+
+    void fill(const SlabCells& slab, ThreadPool& pool) {
+        const size_t w = m_n + 2;
+        m_heights.assign(w * (slab.layers + 2), 0u);
+        pool.parallelFor(slab.layers + 2, [&](size_t row) {
+            const int64_t z = static_cast<int64_t>(slab.z0) + static_cast<int64_t>(row) - 1;
+            if (z < 0 || z >= m_n) return;
+            for (uint32_t x = 0; x < m_n; ++x) m_heights[row * w + x + 1] = height(x, static_cast<uint32_t>(z));
+        });
+
+        pool.parallelFor(static_cast<size_t>(slab.layers) * m_n, [&](size_t column) {
+            const uint32_t x = static_cast<uint32_t>(column % m_n), layer = static_cast<uint32_t>(column / m_n);
+            const uint32_t z = slab.z0 + layer;
+            const size_t at = (layer + 1) * w + x + 1;
+            const uint32_t h = m_heights[at];
+            // Below every neighbour column a cell is enclosed on the sides
+            const uint32_t sides =
+                std::min({m_heights[at - 1], m_heights[at + 1], m_heights[at - w], m_heights[at + w]});
+            for (uint32_t y = 0; y < h; ++y) {
+                const bool exposed = y + 1 == h || y >= sides;
+                const uint16_t color = exposed || y + 3 >= h ? band(y) : static_cast<uint16_t>(Dirt);
+                const bool emissive = exposed && cellHash(m_desc.seed + 1, x, y, z) < m_emissive;
+                slab.at(x, y, z) = cellValue(kTerrainColors, color, emissive);
+            }
+        });
+    }
+
+private:
+    const ProceduralSceneDesc& m_desc;
+    const uint32_t m_n;
+    const uint64_t m_emissive;
+    std::vector<uint32_t> m_heights;
+
+    // fBm over octaves from a third of the grid down to 2 cells
+    uint32_t height(uint32_t x, uint32_t z) const {
+        float sum = 0.0f, norm = 0.0f, amplitude = 1.0f;
+        uint32_t octave = 0;
+        for (float period = m_n / 3.0f; period >= 2.0f; period *= 0.5f, amplitude *= 0.5f, ++octave) {
+            sum += amplitude * valueNoise(m_desc.seed + octave, x / period, z / period);
+            norm += amplitude;
+        }
+        const float h = sum / norm;
+        return std::max(1u, static_cast<uint32_t>(m_n * (0.05f + 0.55f * h * h * (3.0f - 2.0f * h))));
+    }
+
+    uint16_t band(uint32_t y) const {
+        const float t = static_cast<float>(y) / m_n;
+        if (t < 0.1f) return Sand;
+        if (t < 0.22f) return Grass;
+        if (t < 0.34f) return Forest;
+        if (t < 0.46f) return Rock;
+        return Snow;
+    }
+};
+
+// City: square lots separated by streets, each a park or one building
+// whose height falls off from the grid center
+class City {
+public:
+    City(const ProceduralSceneDesc& desc, uint32_t n)
+        : m_desc(desc), m_n(n), m_lot(std::max(16u, n / 32)), m_street(m_lot / 4),
+          m_lit(chanceThreshold(desc.emissiveDensity)) {}
+
+    void fill(const SlabCells& slab, ThreadPool& pool) const {
+        pool.parallelFor(static_cast<size_t>(slab.layers) * m_n, [&](size_t column) {
+            const uint32_t x = static_cast<uint32_t>(column % m_n), z = slab.z0 + static_cast<uint32_t>(column / m_n);
+            const uint32_t lx = x / m_lot, lz = z / m_lot, ox = x % m_lot, oz = z % m_lot;
+            const uint32_t lotHash = cellHash(m_desc.seed, lx, 0, lz);
+            const bool street = ox < m_street || oz < m_street;
+            const bool park = (lotHash & 0xFu) == 0;
+            slab.at(x, 0, z) = cellValue(kCityColors, street ? Asphalt : park ? Park : Pavement, false);
+            if (street || park) return;
+
+            // Footprint, inset from the streets by 1-2 cells per side
+            const uint32_t x0 = m_street + 1 + ((lotHash >> 4) & 1u), x1 = m_lot - 2 - ((lotHash >> 5) & 1u);
+            const uint32_t z0 = m_street + 1 + ((lotHash >> 6) & 1u), z1 = m_lot - 2 - ((lotHash >> 7) & 1u);
+            if (ox < x0 || ox > x1 || oz < z0 || oz > z1) return;
+
+            const float cx = (lx + 0.5f) * m_lot - m_n * 0.5f, cz = (lz + 0.5f) * m_lot - m_n * 0.5f;
+            const float falloff = 1.0f - 0.8f * std::min(1.0f, std::sqrt(cx * cx + cz * cz) / (m_n * 0.5f));
+            const uint32_t tall = static_cast<uint32_t>(unitFloat(lotHash) * falloff * m_n * 0.55f);
+            const uint32_t h = std::min(m_n - 1, 3u + tall);
+            const uint16_t tint = static_cast<uint16_t>(Tint0 + (lotHash >> 8) % 6);
+            const bool facadeX = ox == x0 || ox == x1, facadeZ = oz == z0 || oz == z1;
+            // Windows are 2x2 with a 1-cell frame, counted along the facade
+            const uint32_t along = facadeX ? oz - z0 : ox - x0;
+            for (uint32_t y = 1; y <= h; ++y) {
+                uint16_t value = cellValue(kCityColors, tint, false);
+                if (y == h) {
+                    value = cellValue(kCityColors, Roof, false);
+                } else if ((facadeX || facadeZ) && y % 3 != 0 && along % 3 != 0 && !(facadeX && facadeZ)) {
+                    const bool lit = cellHash(m_desc.seed + 1, x, y, z) < m_lit;
+                    value = lit ? cellValue(kCityColors, WindowLight, true) : cellValue(kCityColors, Window, false);
+                }
+                slab.at(x, y, z) = value;
+            }
+        });
+    }
+
+private:
+    const ProceduralSceneDesc& m_desc;
+    const uint32_t m_n, m_lot, m_street;
+    const uint64_t m_lit;
+};
+
+// Point cloud: every row draws the gaps between its points from the
+// geometric distribution, so the cost follows the points, not the grid
+class PointCloud {
+public:
+    PointCloud(const ProceduralSceneDesc& desc, uint32_t n) : m_desc(desc), m_n(n) {}
+
+    void fill(const SlabCells& slab, ThreadPool& pool) const {
+        const double p = std::min(1.0, std::max(0.0, static_cast<double>(m_desc.pointDensity)));
+        if (p == 0.0) return;
+        const double logMiss = p < 1.0 ? std::log1p(-p) : 0.0;
+        const uint64_t emissive = chanceThreshold(m_desc.emissiveDensity);
+        pool.parallelFor(static_cast<size_t>(slab.layers) * m_n, [&](size_t row) {
+            const uint32_t y = static_cast<uint32_t>(row % m_n), z = slab.z0 + static_cast<uint32_t>(row / m_n);
+            uint64_t state = cellHash(m_desc.seed, 0, y, z);
+            auto next = [&state] { return static_cast<uint32_t>(mixBits(state += 0x9E3779B97F4A7C15ull) >> 32); };
+            auto gap = [&]() -> uint64_t {
+                if (p >= 1.0) return 0;
+                const double u = (static_cast<double>(next()) + 1.0) / 4294967296.0; // (0, 1]
+                return static_cast<uint64_t>(std::log(u) / logMiss);
+            };
+            for (uint64_t x = gap(); x < m_n; x += 1 + gap()) {
+                const uint16_t color = static_cast<uint16_t>(y * 8ull / m_n);
+                slab.at(static_cast<uint32_t>(x), y, z) = cellValue(kPointColors, color, next() < emissive);
+            }
+        });
+    }
+
+private:
+    const ProceduralSceneDesc& m_desc;
+    const uint32_t m_n;
+};
+
+// Menger sponge in the largest 3^k cube that fits, at the grid origin
+class Menger {
+public:
+    Menger(const ProceduralSceneDesc& desc, uint32_t n) : m_desc(desc), m_size(1) {
+        while (m_size * 3 <= n) m_size *= 3;
+    }
+
+    void fill(const SlabCells& slab, ThreadPool& pool) const {
+        const uint64_t emissive = chanceThreshold(m_desc.emissiveDensity);
+        const uint32_t third = m_size / 3;
+        const uint32_t layers = slab.z0 < m_size ? std::min(slab.layers, m_size - slab.z0) : 0u;
+        pool.parallelFor(static_cast<size_t>(layers) * m_size, [&](size_t row) {
+            const uint32_t y = static_cast<uint32_t>(row % m_size), z = slab.z0 + static_cast<uint32_t>(row / m_size);
+            for (uint32_t x = 0; x < m_size; ++x) {
+                if (!solid(x, y, z)) continue;
+                const bool exposed = !solid(x - 1, y, z) || !solid(x + 1, y, z) || !solid(x, y - 1, z) ||
+                                     !solid(x, y + 1, z) || !solid(x, y, z - 1) || !solid(x, y, z + 1);
+                const uint16_t color = static_cast<uint16_t>((x / third + y / third + z / third) % 6);
+                const bool emits = exposed && cellHash(m_desc.seed, x, y, z) < emissive;
+                slab.at(x, y, z) = cellValue(kMengerColors, color, emits);
+            }
+        });
+    }
+
+private:
+    const ProceduralSceneDesc& m_desc;
+    uint32_t m_size;
+
+    // Coordinates wrap below 0, so both sides of the cube test as empty
+    bool solid(uint32_t x, uint32_t y, uint32_t z) const {
+        if (x >= m_size || y >= m_size || z >= m_size) return false;
+        for (uint32_t s = m_size; s > 1; s /= 3) {
+            if ((x % 3 == 1) + (y % 3 == 1) + (z % 3 == 1) >= 2) return false;
+            x /= 3;
+            y /= 3;
+            z /= 3;
+        }
+        return true;
+    }
+};
+
+} // namespace
+
+bool SparseVoxelOctree::generateProceduralScene(const ProceduralSceneDesc& desc) {
+    if (m_depth < kRawBlockLevels || m_depth > 20) {
+        std::cerr << "Procedural scene: depth " << m_depth << " outside " << kRawBlockLevels << "..20" << std::endl;
+        return false;
+    }
+    const uint32_t n = 1u << (m_depth - 1);
+    const glm::uvec3 cells(n);
+    ThreadPool pool(m_buildThreads);
+    auto build = [&](const std::vector<uint32_t>& valueColors, auto& scene) {
+        return buildFromCellSlabs(cells, valueColors, [&](uint32_t slab, uint16_t* out, size_t row, size_t layer) {
+            const uint32_t layers = 1u << (kRawBlockLevels - 1), z0 = slab * layers;
+            scene.fill(SlabCells{out, row, layer, z0, std::min(layers, n - z0)}, pool);
+            return true;
+        });
+    };
+
+    uint64_t solidCells = 0;
+    switch (desc.scene) {
+    case ProceduralScene::City: {
+        City city(desc, n);
+        solidCells = build(paletteValues(kCityColors), city);
+        break;
+    }
+    case ProceduralScene::PointCloud: {
+        PointCloud points(desc, n);
+        solidCells = build(paletteValues(kPointColors), points);
+        break;
+    }
+    case ProceduralScene::Menger: {
+        Menger sponge(desc, n);
+        solidCells = build(paletteValues(kMengerColors), sponge);
+        break;
+    }
+    default: {
+        Terrain terrain(desc, n);
+        solidCells = build(paletteValues(kTerrainColors), terrain);
+        break;
+    }
+    }
+    if (solidCells == kSlabBuildFailed) return false;
+
+    std::cout << "Generated " << proceduralSceneName(desc.scene) << " scene (seed " << desc.seed << ", depth "
+              << m_depth << "): " << solidCells << " solid cells, " << m_nodes.size() << " nodes, "
+              << m_emissiveVoxels.size() << " emissive voxels" << std::endl;
+    return true;
+}
+
+} // namespace vox
@@ -0,0 +1,321 @@
+#include "vox/SparseVoxelOctree.h"
+#include "vox/OctreePageCache.h"
+#include "vox/ThreadPool.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+namespace vox {
+
+namespace {
+
+// Parent words of every 2x2x2 group of an n^3 word grid (x fastest)
+template <typename Pack>
+std::vector<uint32_t> reduceLevel(const std::vector<uint32_t>& words, uint32_t n, Pack&& pack) {
+    const uint32_t h = n / 2;
+    std::vector<uint32_t> parents(static_cast<size_t>(h) * h * h);
+    uint32_t group[8];
+    for (uint32_t z = 0; z < h; ++z) {
+        for (uint32_t y = 0; y < h; ++y) {
+            for (uint32_t x = 0; x < h; ++x) {
+                for (uint32_t c = 0; c < 8; ++c) {
+                    const uint32_t cx = 2 * x + ((c >> 2) & 1u), cy = 2 * y + ((c >> 1) & 1u), cz = 2 * z + (c & 1u);
+                    group[c] = words[(static_cast<size_t>(cz) * n + cy) * n + cx];
+                }
+                parents[(static_cast<size_t>(z) * h + y) * h + x] = pack(group);
+            }
+        }
+    }
+    return parents;
+}
+
+} // namespace
+
+bool SparseVoxelOctree::loadFromRawVolume(const std::string& filepath, const RawVolumeDesc& desc) {
+    const glm::uvec3 size = desc.size;
+    const uint32_t bytesPerSample = desc.bytesPerSample;
+    if (size.x == 0 || size.y == 0 || size.z == 0 || (bytesPerSample != 1 && bytesPerSample != 2)) {
+        std::cerr << "Raw volume: unsupported size " << size.x << "x" << size.y << "x" << size.z << " or "
+                  << bytesPerSample << "-byte samples" << std::endl;
+        return false;
+    }
+    const uint32_t typeMax = bytesPerSample == 1 ? 0xFFu : 0xFFFFu;
+    const uint32_t maxValue = desc.maxValue ? std::min(desc.maxValue, typeMax) : typeMax;
+    if (desc.threshold > maxValue || desc.palette.size() > 255) {
+        std::cerr << "Raw volume: threshold " << desc.threshold << " above " << maxValue << " or more than 255 palette entries"
+                  << std::endl;
+        return false;
+    }
+
+    std::ifstream file(filepath, std::ios::binary);
+    if (!file) {
+        std::cerr << "Failed to open raw volume: " << filepath << std::endl;
+        return false;
+    }
+    const uint64_t sliceSamples = static_cast<uint64_t>(size.x) * size.y;
+    const uint64_t sliceBytes = sliceSamples * bytesPerSample;
+    file.seekg(0, std::ios::end);
+    const uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+    if (fileSize < desc.headerBytes + sliceBytes * size.z) {
+        std::cerr << "Raw volume " << filepath << " has " << fileSize << " bytes, expected "
+                  << desc.headerBytes + sliceBytes * size.z << std::endl;
+        return false;
+    }
+    file.seekg(static_cast<std::streamoff>(desc.headerBytes));
+
+    uint32_t depth = std::max(m_depth, kRawBlockLevels);
+    while ((1u << depth) < std::max({size.x, size.y, size.z})) ++depth;
+    if (depth > 20) {
+        std::cerr << "Raw volume: " << filepath << " needs an octree of depth " << depth << std::endl;
+        return false;
+    }
+    m_depth = depth;
+
+    // Transfer function per sample value: 0 = empty, else palette entry + 1
+    std::vector<uint32_t> palette = desc.palette;
+    if (palette.empty()) {
+        for (uint32_t i = 0; i < 32; ++i) {
+            const uint32_t g = 64 + i * 191 / 31;
+            palette.push_back((g << 16) | (g << 8) | g);
+        }
+    }
+    const uint32_t entries = static_cast<uint32_t>(palette.size());
+    std::vector<uint8_t> transfer(typeMax + 1, 0);
+    for (uint32_t v = desc.threshold; v <= typeMax; ++v) {
+        const uint64_t step = static_cast<uint64_t>(std::min(v, maxValue) - desc.threshold) * entries /
+                              (maxValue - desc.threshold + 1);
+        transfer[v] = static_cast<uint8_t>(1 + std::min<uint64_t>(step, entries - 1));
+    }
+    std::vector<uint32_t> valueColors(1, 0u);
+    valueColors.insert(valueColors.end(), palette.begin(), palette.end());
+
+    const glm::uvec3 cells = (size + glm::uvec3(1u)) / glm::uvec3(2u);
+    std::vector<uint8_t> slices(2 * sliceBytes);
+    auto fillSlab = [&](uint32_t slab, uint16_t* out, size_t rowStride, size_t layerStride) {
+        const uint32_t blockCells = 1u << (kRawBlockLevels - 1);
+        for (uint32_t layer = 0; layer < blockCells; ++layer) {
+            const uint32_t cz = slab * blockCells + layer;
+            if (cz >= cells.z) break;
+            const uint32_t sliceCount = std::min(2u, size.z - 2 * cz);
+            file.read(reinterpret_cast<char*>(slices.data()), static_cast<std::streamsize>(sliceCount * sliceBytes));
+            if (!file) {
+                std::cerr << "Raw volume " << filepath << ": read failed at slice " << 2 * cz << std::endl;
+                return false;
+            }
+            for (uint32_t cy = 0; cy < cells.y; ++cy) {
+                const uint32_t yEnd = std::min(2 * cy + 2, size.y);
+                uint16_t* row = out + layer * layerStride + cy * rowStride;
+                for (uint32_t cx = 0; cx < cells.x; ++cx) {
+                    const uint32_t xEnd = std::min(2 * cx + 2, size.x);
+                    uint32_t highest = 0;
+                    for (uint32_t s = 0; s < sliceCount; ++s) {
+                        for (uint32_t y = 2 * cy; y < yEnd; ++y) {
+                            const uint64_t sampleRow = s * sliceSamples + static_cast<uint64_t>(y) * size.x;
+                            for (uint32_t x = 2 * cx; x < xEnd; ++x) {
+                                const uint8_t* p = slices.data() + (sampleRow + x) * bytesPerSample;
+                                const uint32_t sample = bytesPerSample == 1 ? p[0] : (p[0] | (p[1] << 8));
+                                highest = std::max(highest, sample);
+                            }
+                        }
+                    }
+                    row[cx] = transfer[highest];
+                }
+            }
+        }
+        return true;
+    };
+    const uint64_t solidCells = buildFromCellSlabs(cells, valueColors, fillSlab);
+    if (solidCells == kSlabBuildFailed) return false;
+
+    std::cout << "Imported raw volume " << filepath << " (" << size.x << "x" << size.y << "x" << size.z << ", "
+              << 8 * bytesPerSample << "-bit): " << solidCells << " solid cells, " << m_nodes.size()
+              << " nodes at depth " << m_depth << std::endl;
+    return true;
+}
+
+uint64_t SparseVoxelOctree::buildFromCellSlabs(glm::uvec3 cells, const std::vector<uint32_t>& valueColors,
+                                               const CellSlabFill& fillSlab) {
+    clearTree();
+
+    // A slab is one row of blocks along z: blockCells layers of leaf cells,
+    // padded to whole blocks in x and y
+    const uint32_t blockCells = 1u << (kRawBlockLevels - 1);
+    const glm::uvec3 blocks = (cells + glm::uvec3(blockCells - 1)) / glm::uvec3(blockCells);
+    const size_t layerW = static_cast<size_t>(blocks.x) * blockCells;
+    const size_t layerH = static_cast<size_t>(blocks.y) * blockCells;
+    const uint32_t gridBlocks = 1u << (m_depth - kRawBlockLevels);
+
+    // A paged build (setPagedBuild) keeps one layer of page subtrees, each
+    // pageBlocks^3 blocks under its page root; otherwise the whole grid
+    const bool paged = !m_pagedBuildPath.empty();
+    if (paged && (m_pagedBuildLevel == 0 || m_pagedBuildLevel + kRawBlockLevels > m_depth)) {
+        std::cerr << "Paged build: page level must lie in [1, " << (m_depth - kRawBlockLevels) << "]" << std::endl;
+        return kSlabBuildFailed;
+    }
+    const uint32_t gridPages = paged ? 1u << m_pagedBuildLevel : 1u;
+    const uint32_t pageBlocks = gridBlocks / gridPages;
+    OctreePageWriter pages;
+    if (paged && !pages.open(m_pagedBuildPath + ".pages")) return kSlabBuildFailed;
+    if (paged) m_lodColors.assign(1, 0u); // appended blocks filter their LOD colors as they go
+
+    std::vector<uint16_t> slab(blockCells * layerH * layerW, 0);
+    std::vector<uint8_t> occupied(static_cast<size_t>(blocks.x) * blocks.y);
+    std::vector<uint32_t> blockRoots(static_cast<size_t>(pageBlocks) * gridBlocks * gridBlocks, 0u);
+    std::vector<uint32_t> words(static_cast<size_t>(blockCells) * blockCells * blockCells);
+    std::vector<uint32_t> leafWords(valueColors.size(), 0u); // resolved on first use, 0 = not yet
+    auto pack = [this](const uint32_t* group) { return packChildBlock(group); };
+    auto blockRow = [&](uint32_t bx, uint32_t by, uint32_t z, uint32_t y) {
+        return slab.data() + (z * layerH + by * blockCells + y) * layerW + bx * blockCells;
+    };
+    ThreadPool pool(m_buildThreads);
+    uint64_t solidCells = 0;
+
+    // Reduce every column of a finished page layer to its page root, write
+    // the subtree under each internal root out as a page and drop the layer
+    std::vector<uint32_t> pageRoots, layerRoots, column;
+    std::vector<uint32_t> pageLod; // LOD color of each written page's root
+    if (paged) {
+        pageRoots.assign(static_cast<size_t>(gridPages) * gridPages * gridPages, 0u);
+        layerRoots.resize(static_cast<size_t>(gridPages) * gridPages);
+        column.resize(static_cast<size_t>(pageBlocks) * pageBlocks * pageBlocks);
+    }
+    OctreePage page;
+    auto finishPageLayer = [&](uint32_t pz) {
+        for (uint32_t py = 0; py < gridPages; ++py) {
+            for (uint32_t px = 0; px < gridPages; ++px) {
+                for (uint32_t z = 0; z < pageBlocks; ++z) {
+                    for (uint32_t y = 0; y < pageBlocks; ++y) {
+                        const size_t row = (static_cast<size_t>(z) * gridBlocks + py * pageBlocks + y) * gridBlocks;
+                        const uint32_t* src = blockRoots.data() + row + px * pageBlocks;
+                        std::copy(src, src + pageBlocks, column.data() + (static_cast<size_t>(z) * pageBlocks + y) * pageBlocks);
+                    }
+                }
+                std::vector<uint32_t> level = column;
+                for (uint32_t n = pageBlocks; n > 1; n /= 2) level = reduceLevel(level, n, pack);
+                layerRoots[static_cast<size_t>(py) * gridPages + px] = level[0];
+            }
+        }
+        for (size_t i = 0; i < layerRoots.size(); ++i) {
+            uint32_t word = layerRoots[i];
+            if (const uint32_t child = childPointer(word)) {
+                if (!collectPage(child, page) || !pages.append(page)) return false;
+                pageLod.push_back(filterLodColor(word));
+                word = OctreeNode::FAR_BIT | (pages.pageCount() - 1);
+            }
+            pageRoots[static_cast<size_t>(pz) * layerRoots.size() + i] = word;
+        }
+        m_nodes.resize(1);
+        m_lodColors.resize(1);
+        m_farPointers.clear();
+        std::fill(blockRoots.begin(), blockRoots.end(), 0u);
+        return true;
+    };
+
+    for (uint32_t bz = 0; bz < blocks.z; ++bz) {
+        if (!fillSlab(bz, slab.data(), layerW, layerH * layerW)) {
+            clearTree();
+            return kSlabBuildFailed;
+        }
+
+        // Find the blocks with anything in them on all threads; most of a
+        // surface or a scan is air
+        pool.parallelFor(occupied.size(), [&](size_t b) {
+            const uint32_t bx = static_cast<uint32_t>(b % blocks.x), by = static_cast<uint32_t>(b / blocks.x);
+            uint16_t any = 0;
+            for (uint32_t z = 0; z < blockCells; ++z) {
+                for (uint32_t y = 0; y < blockCells; ++y) {
+                    const uint16_t* row = blockRow(bx, by, z, y);
+                    for (uint32_t x = 0; x < blockCells; ++x) any |= row[x];
+                }
+            }
+            occupied[b] = any != 0;
+        });
+
+        // Every occupied block becomes a subtree, its root word parked in the
+        // block grid until the upper levels are built. Its cells are zeroed
+        // on the way, so the next slab starts out empty.
+        for (uint32_t by = 0; by < blocks.y; ++by) {
+            for (uint32_t bx = 0; bx < blocks.x; ++bx) {
+                if (!occupied[static_cast<size_t>(by) * blocks.x + bx]) continue;
+                bool solid = false;
+                for (uint32_t z = 0; z < blockCells; ++z) {
+                    for (uint32_t y = 0; y < blockCells; ++y) {
+                        uint16_t* row = blockRow(bx, by, z, y);
+                        uint32_t* dst = words.data() + (static_cast<size_t>(z) * blockCells + y) * blockCells;
+                        for (uint32_t x = 0; x < blockCells; ++x) {
+                            const uint16_t v = row[x];
+                            row[x] = 0;
+                            if (v == 0 || v >= valueColors.size()) {
+                                dst[x] = 0u;
+                                continue;
+                            }
+                            if (leafWords[v] == 0) leafWords[v] = OctreeNode::LEAF_BIT | getOrAddColor(valueColors[v]);
+                            dst[x] = leafWords[v];
+                            solid = true;
+                            solidCells++;
+                            if ((valueColors[v] & 0xFF000000u) != 0u) {
+                                const glm::uvec3 cell(bx * blockCells + x, by * blockCells + y, bz * blockCells + z);
+                                m_emissiveVoxels.push_back(cell * 2u);
+                            }
+                        }
+                    }
+                }
+                if (!solid) continue;
+                std::vector<uint32_t> level = reduceLevel(words, blockCells, pack);
+                for (uint32_t n = blockCells / 2; n > 1; n /= 2) level = reduceLevel(level, n, pack);
+                blockRoots[(static_cast<size_t>(bz % pageBlocks) * gridBlocks + by) * gridBlocks + bx] = level[0];
+            }
+        }
+
+        if (paged && ((bz + 1) % pageBlocks == 0 || bz + 1 == blocks.z) && !finishPageLayer(bz / pageBlocks)) {
+            clearTree();
+            return kSlabBuildFailed;
+        }
+    }
+
+    if (paged) {
+        // The page roots reduce to the top tree. Its page words resolve
+        // through one empty far slot per page, as in a savePagedFiles() top
+        // tree, and carry the LOD color of the subtree they stand for.
+        m_lodColors.clear();
+        m_farPointers.assign(pages.pageCount(), 0u);
+        for (uint32_t n = gridPages; n > 1; n /= 2) pageRoots = reduceLevel(pageRoots, n, pack);
+        m_nodes[0].data = pageRoots[0];
+        m_childOrderBroken = true;
+        compactNodes();
+        if (m_nodes.size() > OctreeNode::PAYLOAD_MASK) {
+            std::cerr << "Paged build: top tree exceeds the 30-bit child pointer range; use a shallower page level" << std::endl;
+            clearTree();
+            return kSlabBuildFailed;
+        }
+        m_farPointers.assign(pages.pageCount(), 0u);
+        m_lodColors.assign(m_nodes.size(), 0u);
+        for (size_t i = m_nodes.size(); i-- > 0;) {
+            const uint32_t data = m_nodes[i].data;
+            const bool pageWord = (data & (OctreeNode::LEAF_BIT | OctreeNode::FAR_BIT)) == OctreeNode::FAR_BIT;
+            m_lodColors[i] = pageWord ? pageLod[data & OctreeNode::PAYLOAD_MASK] : filterLodColor(data);
+        }
+        m_pagedTop = true;
+        markAllNodesDirty();
+        if (!pages.finish() || !saveSvoFile(m_pagedBuildPath + ".svo", 0, NodeFormat::Dense)) {
+            clearTree();
+            return kSlabBuildFailed;
+        }
+        std::cout << "Wrote paged octree " << m_pagedBuildPath << ": " << m_nodes.size() << " top nodes, "
+                  << pages.pageCount() << " pages (largest " << pages.maxPageNodes() << " nodes, "
+                  << (pages.bytesWritten() >> 20) << " MB)" << std::endl;
+        return solidCells;
+    }
+
+    for (uint32_t n = gridBlocks; n > 1; n /= 2) blockRoots = reduceLevel(blockRoots, n, pack);
+    m_nodes[0].data = blockRoots[0];
+
+    // Blocks were appended children first; compaction puts them in order
+    m_childOrderBroken = true;
+    markAllNodesDirty();
+    compactNodes();
+    computeLodColors();
+    return solidCells;
+}
+
+} // namespace vox
@@ -0,0 +1,625 @@
+#include "vox/SparseVoxelOctree.h"
+#include "vox/MappedFile.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace vox {
+
+namespace {
+
+uint32_t packColor(uint8_t r, uint8_t g, uint8_t b, uint8_t emissive) {
+    return (static_cast<uint32_t>(emissive) << 24) |
+           (static_cast<uint32_t>(r) << 16) |
+           (static_cast<uint32_t>(g) << 8) |
+           static_cast<uint32_t>(b);
+}
+
+// Bounds-checked little-endian reader over one chunk's content
+struct ChunkReader {
+    const uint8_t* p;
+    const uint8_t* end;
+    bool ok = true;
+
+    bool has(size_t n) {
+        ok = ok && static_cast<size_t>(end - p) >= n;
+        return ok;
+    }
+    int32_t i32() {
+        if (!has(4)) return 0;
+        int32_t v;
+        std::memcpy(&v, p, 4);
+        p += 4;
+        return v;
+    }
+    std::string str() {
+        const int32_t len = i32();
+        if (len < 0 || !has(static_cast<size_t>(len))) {
+            ok = false;
+            return {};
+        }
+        std::string s(reinterpret_cast<const char*>(p), static_cast<size_t>(len));
+        p += len;
+        return s;
+    }
+    std::map<std::string, std::string> dict() {
+        std::map<std::string, std::string> d;
+        const int32_t pairs = i32();
+        for (int32_t i = 0; i < pairs && ok; ++i) {
+            std::string key = str();
+            d[key] = str();
+        }
+        return d;
+    }
+};
+
+struct VoxModel {
+    glm::uvec3 size{0u};
+    const uint8_t* xyzi = nullptr; // in the file mapping: x, y, z, color index (1-based, 0 = empty)
+    uint32_t count = 0;
+};
+
+// Signed permutation matrix (rows) plus translation, Z-up like the file
+struct VoxTransform {
+    glm::ivec3 rows[3] = {glm::ivec3(1, 0, 0), glm::ivec3(0, 1, 0), glm::ivec3(0, 0, 1)};
+    glm::ivec3 t{0};
+
+    glm::ivec3 rotate(glm::ivec3 v) const {
+        return glm::ivec3(rows[0].x * v.x + rows[0].y * v.y + rows[0].z * v.z,
+                          rows[1].x * v.x + rows[1].y * v.y + rows[1].z * v.z,
+                          rows[2].x * v.x + rows[2].y * v.y + rows[2].z * v.z);
+    }
+    VoxTransform then(const VoxTransform& child) const { // this * child
+        VoxTransform r;
+        for (int i = 0; i < 3; ++i) {
+            for (int j = 0; j < 3; ++j) {
+                r.rows[i][j] = rows[i].x * child.rows[0][j] + rows[i].y * child.rows[1][j] + rows[i].z * child.rows[2][j];
+            }
+        }
+        r.t = rotate(child.t) + t;
+        return r;
+    }
+    // Rows packed as the file's _r byte, for grouping instances
+    uint32_t rotationKey() const {
+        uint32_t key = 0;
+        for (int i = 0; i < 3; ++i) {
+            for (int j = 0; j < 3; ++j) key = key * 3 + static_cast<uint32_t>(rows[i][j] + 1);
+        }
+        return key;
+    }
+};
+
+// _r: bits 0-1 / 2-3 = column of the non-zero entry in rows 0 / 1 (row 2
+// takes the remaining one), bits 4-6 = sign of rows 0-2
+VoxTransform decodeRotation(uint32_t r) {
+    VoxTransform xf;
+    const int c0 = r & 3, c1 = (r >> 2) & 3;
+    if (c0 == c1 || c0 > 2 || c1 > 2) return xf;
+    const int cols[3] = {c0, c1, 3 - c0 - c1};
+    for (int i = 0; i < 3; ++i) {
+        xf.rows[i] = glm::ivec3(0);
+        xf.rows[i][cols[i]] = (r & (16u << i)) ? -1 : 1;
+    }
+    return xf;
+}
+
+struct VoxNode {
+    enum Type { Transform, Group, Shape } type = Group;
+    VoxTransform transform;
+    int32_t layer = -1;
+    bool hidden = false;
+    std::vector<int32_t> children; // child node(s), or model ids for shapes
+};
+
+struct VoxInstance {
+    uint32_t model;
+    VoxTransform transform;
+};
+
+// Walk the graph from the root transform, composing transforms down to shapes
+void collectInstances(const std::unordered_map<int32_t, VoxNode>& nodes, const std::vector<bool>& hiddenLayers,
+                      int32_t id, const VoxTransform& parent, uint32_t depth, std::vector<VoxInstance>& out) {
+    auto it = nodes.find(id);
+    if (it == nodes.end() || depth > 64) return;
+    const VoxNode& node = it->second;
+    if (node.hidden) return;
+    VoxTransform xf = parent;
+    if (node.type == VoxNode::Transform) {
+        if (node.layer >= 0 && static_cast<size_t>(node.layer) < hiddenLayers.size() && hiddenLayers[node.layer]) return;
+        xf = parent.then(node.transform);
+    }
+    for (int32_t child : node.children) {
+        if (node.type == VoxNode::Shape) {
+            if (child >= 0) out.push_back({static_cast<uint32_t>(child), xf});
+        } else {
+            collectInstances(nodes, hiddenLayers, child, xf, depth + 1, out);
+        }
+    }
+}
+
+uint32_t ceilPow2(uint32_t v) {
+    uint32_t p = 1;
+    while (p < v) p <<= 1;
+    return p;
+}
+
+bool anyGreater(glm::ivec3 a, glm::ivec3 b) {
+    return a.x > b.x || a.y > b.y || a.z > b.z;
+}
+
+uint32_t log2u(uint32_t v) {
+    uint32_t l = 0;
+    while ((1u << l) < v) ++l;
+    return l;
+}
+
+} // namespace
+
+bool SparseVoxelOctree::loadFromVoxFile(const std::string& filepath) {
+    // Chunks are parsed straight out of the mapping; XYZI records are read in
+    // place while building each model's voxel pattern
+    MappedFile file;
+    if (!file.open(filepath)) {
+        std::cerr << "Failed to open .vox file: " << filepath << std::endl;
+        return false;
+    }
+    ChunkReader header{file.data(), file.data() + file.size()};
+
+    // Read header
+    if (!header.has(8) || std::memcmp(header.p, "VOX ", 4) != 0) {
+        std::cerr << "Invalid .vox file magic" << std::endl;
+        return false;
+    }
+    header.p += 4;
+    const int32_t version = header.i32();
+    std::cout << "Loading MagicaVoxel file version " << version << std::endl;
+
+    // Read MAIN chunk
+    if (!header.has(12) || std::memcmp(header.p, "MAIN", 4) != 0) {
+        std::cerr << "Expected MAIN chunk" << std::endl;
+        return false;
+    }
+    header.p += 4;
+    const uint32_t mainChunkSize = static_cast<uint32_t>(header.i32());
+    const uint32_t mainChildrenSize = static_cast<uint32_t>(header.i32());
+    if (!header.has(mainChunkSize)) {
+        std::cerr << "Truncated MAIN chunk" << std::endl;
+        return false;
+    }
+    header.p += mainChunkSize;
+    // A short file only loses its trailing chunks, as with the stream reader
+    ChunkReader chunks{header.p, header.p + std::min<size_t>(mainChildrenSize, header.end - header.p)};
+
+    std::vector<VoxModel> models;
+    std::unordered_map<int32_t, VoxNode> sceneNodes;
+    std::vector<bool> hiddenLayers;
+    std::vector<uint32_t> palette(256);
+    bool paletteLoaded = false;
+
+    // SIZE/XYZI pairs define models in order; the scene graph nodes refer to
+    // them by that index
+    while (chunks.has(12)) {
+        const char* chunkId = reinterpret_cast<const char*>(chunks.p);
+        chunks.p += 4;
+        const uint32_t chunkSize = static_cast<uint32_t>(chunks.i32());
+        const uint32_t childrenSize = static_cast<uint32_t>(chunks.i32());
+        if (!chunks.has(chunkSize)) {
+            std::cerr << "Truncated .vox chunk " << std::string(chunkId, 4) << ", ignoring the rest" << std::endl;
+            break;
+        }
+        ChunkReader in{chunks.p, chunks.p + chunkSize};
+        chunks.p += chunkSize;
+        if (!chunks.has(childrenSize)) break;
+        chunks.p += childrenSize;
+
+        if (std::memcmp(chunkId, "SIZE", 4) == 0) {
+            VoxModel model;
+            model.size.x = static_cast<uint32_t>(in.i32());
+            model.size.y = static_cast<uint32_t>(in.i32());
+            model.size.z = static_cast<uint32_t>(in.i32());
+            models.push_back(model);
+        } else if (std::memcmp(chunkId, "XYZI", 4) == 0) {
+            const uint32_t numVoxels = static_cast<uint32_t>(in.i32());
+            if (models.empty() || models.back().xyzi || !in.has(numVoxels * 4ull)) {
+                std::cerr << "Malformed XYZI chunk" << std::endl;
+                return false;
+            }
+            models.back().xyzi = in.p;
+            models.back().count = numVoxels;
+        } else if (std::memcmp(chunkId, "RGBA", 4) == 0 && in.has(1024)) {
+            // Entry i colors index i + 1
+            for (int i = 0; i < 256; ++i) {
+                const uint8_t r = in.p[i * 4], g = in.p[i * 4 + 1], b = in.p[i * 4 + 2];
+                uint8_t emissive = (r == 255 && g == 255 && b == 255) ? 255 : 0;
+                palette[i] = packColor(r, g, b, emissive);
+            }
+            paletteLoaded = true;
+        } else if (std::memcmp(chunkId, "nTRN", 4) == 0) {
+            const int32_t id = in.i32();
+            VoxNode node;
+            node.type = VoxNode::Transform;
+            node.hidden = in.dict()["_hidden"] == "1";
+            node.children.push_back(in.i32());
+            in.i32(); // reserved
+            node.layer = in.i32();
+            const int32_t frames = in.i32();
+            for (int32_t f = 0; f < frames && in.ok; ++f) {
+                std::map<std::string, std::string> attrs = in.dict();
+                if (f != 0) continue; // animation frames past the first are not shown
+                if (!attrs["_r"].empty()) node.transform = decodeRotation(static_cast<uint32_t>(std::strtoul(attrs["_r"].c_str(), nullptr, 10)));
+                if (!attrs["_t"].empty()) {
+                    int x = 0, y = 0, z = 0;
+                    std::sscanf(attrs["_t"].c_str(), "%d %d %d", &x, &y, &z);
+                    node.transform.t = glm::ivec3(x, y, z);
+                }
+            }
+            if (in.ok) sceneNodes[id] = std::move(node);
+        } else if (std::memcmp(chunkId, "nGRP", 4) == 0) {
+            const int32_t id = in.i32();
+            VoxNode node;
+            node.hidden = in.dict()["_hidden"] == "1";
+            const int32_t count = in.i32();
+            for (int32_t c = 0; c < count && in.ok; ++c) node.children.push_back(in.i32());
+            if (in.ok) sceneNodes[id] = std::move(node);
+        } else if (std::memcmp(chunkId, "nSHP", 4) == 0) {
+            const int32_t id = in.i32();
+            VoxNode node;
+            node.type = VoxNode::Shape;
+            in.dict();
+            const int32_t count = in.i32();
+            for (int32_t c = 0; c < count && in.ok; ++c) {
+                node.children.push_back(in.i32());
+                in.dict();
+            }
+            if (in.ok) sceneNodes[id] = std::move(node);
+        } else if (std::memcmp(chunkId, "LAYR", 4) == 0) {
+            const int32_t id = in.i32();
+            const bool hidden = in.dict()["_hidden"] == "1";
+            if (in.ok && id >= 0 && id < 4096) {
+                if (hiddenLayers.size() <= static_cast<size_t>(id)) hiddenLayers.resize(id + 1, false);
+                hiddenLayers[id] = hidden;
+            }
+        }
+    }
+
+    models.erase(std::remove_if(models.begin(), models.end(), [](const VoxModel& m) { return m.count == 0; }),
+                 models.end());
+    if (models.empty()) {
+        std::cerr << "Expected SIZE and XYZI chunks" << std::endl;
+        return false;
+    }
+
+    if (!paletteLoaded) {
+        // Default palette if RGBA chunk not found
+        for (int i = 0; i < 256; ++i) {
+            uint8_t r = (i * 127) % 256;
+            uint8_t g = (i * 191) % 256;
+            uint8_t b = (i * 223) % 256;
+            uint8_t emissive = (r == 255 && g == 255 && b == 255) ? 255 : 0;
+            palette[i] = packColor(r, g, b, emissive);
+        }
+        std::cout << "Using default palette" << std::endl;
+    }
+
+    // Files without a scene graph show every model untransformed
+    std::vector<VoxInstance> instances;
+    if (sceneNodes.count(0)) collectInstances(sceneNodes, hiddenLayers, 0, VoxTransform{}, 0, instances);
+    if (sceneNodes.empty()) {
+        for (uint32_t m = 0; m < models.size(); ++m) instances.push_back({m, VoxTransform{}});
+    }
+    instances.erase(std::remove_if(instances.begin(), instances.end(),
+                                   [&](const VoxInstance& inst) { return inst.model >= models.size(); }),
+                    instances.end());
+
+    // One voxel pattern per (model, rotation): rotated about the model center,
+    // converted to Y-up (MagicaVoxel Z becomes Y, flipped, and Y becomes Z) and
+    // relative to its own bounding box. Only the bounds are kept; the voxels
+    // are read from the mapped records again wherever the pattern is placed.
+    struct Pattern {
+        uint32_t model;
+        VoxTransform rotation;           // translation unused
+        glm::ivec3 rotMin{0}, rotMax{0}; // rotated bounds, Z-up, relative to the model center
+        glm::uvec3 extent{0u};           // Y-up
+        size_t voxelCount = 0;
+    };
+    std::vector<Pattern> patterns;
+    std::map<std::pair<uint32_t, uint32_t>, uint32_t> patternOf;
+    std::vector<uint32_t> instancePattern(instances.size());
+    auto rotated = [&](const Pattern& pattern, const uint8_t* rec) {
+        const glm::ivec3 pivot = glm::ivec3(models[pattern.model].size / 2u);
+        return pattern.rotation.rotate(glm::ivec3(rec[0], rec[1], rec[2]) - pivot);
+    };
+    for (size_t i = 0; i < instances.size(); ++i) {
+        const VoxInstance& inst = instances[i];
+        auto key = std::make_pair(inst.model, inst.transform.rotationKey());
+        auto it = patternOf.find(key);
+        if (it != patternOf.end()) {
+            instancePattern[i] = it->second;
+            continue;
+        }
+        const VoxModel& model = models[inst.model];
+        Pattern pattern;
+        pattern.model = inst.model;
+        pattern.rotation = inst.transform;
+        pattern.rotMin = glm::ivec3(INT32_MAX);
+        pattern.rotMax = glm::ivec3(INT32_MIN);
+        const uint8_t* recordsEnd = model.xyzi + model.count * 4ull;
+        for (const uint8_t* rec = model.xyzi; rec != recordsEnd; rec += 4) {
+            if (rec[3] == 0) continue; // MagicaVoxel color indices are 1-based, 0 = empty
+            const glm::ivec3 p = rotated(pattern, rec);
+            pattern.rotMin = glm::min(pattern.rotMin, p);
+            pattern.rotMax = glm::max(pattern.rotMax, p);
+            pattern.voxelCount++;
+        }
+        if (pattern.voxelCount == 0) pattern.rotMin = pattern.rotMax = glm::ivec3(0);
+        const glm::ivec3 size = pattern.rotMax - pattern.rotMin + 1;
+        pattern.extent = glm::uvec3(size.x, size.z, size.y);
+        instancePattern[i] = static_cast<uint32_t>(patterns.size());
+        patternOf.emplace(key, instancePattern[i]);
+        patterns.push_back(pattern);
+    }
+
+    // Append a pattern's voxels with their Y-up corner at base, rotating each
+    // record as it is read from the mapping; cells past limit are dropped
+    auto emitPattern = [&](const Pattern& pattern, glm::ivec3 base, int32_t limit, std::vector<Voxel>& out) {
+        const VoxModel& model = models[pattern.model];
+        const uint8_t* recordsEnd = model.xyzi + model.count * 4ull;
+        for (const uint8_t* rec = model.xyzi; rec != recordsEnd; rec += 4) {
+            if (rec[3] == 0) continue;
+            const glm::ivec3 r = rotated(pattern, rec);
+            const glm::ivec3 p = base + glm::ivec3(r.x - pattern.rotMin.x, pattern.rotMax.z - r.z, r.y - pattern.rotMin.y);
+            if (p.x >= limit || p.y >= limit || p.z >= limit) continue;
+            out.push_back({glm::uvec3(p), rec[3] - 1u});
+        }
+    };
+
+    // Scene bounds, then each instance's Y-up minimum corner relative to them
+    glm::ivec3 sceneMin(INT32_MAX), sceneMax(INT32_MIN);
+    for (size_t i = 0; i < instances.size(); ++i) {
+        const Pattern& pattern = patterns[instancePattern[i]];
+        if (pattern.voxelCount == 0) continue;
+        sceneMin = glm::min(sceneMin, instances[i].transform.t + pattern.rotMin);
+        sceneMax = glm::max(sceneMax, instances[i].transform.t + pattern.rotMax);
+    }
+    if (sceneMin.x > sceneMax.x) {
+        std::cerr << "No voxels in " << filepath << std::endl;
+        return false;
+    }
+    std::vector<glm::ivec3> instanceMin(instances.size());
+    for (size_t i = 0; i < instances.size(); ++i) {
+        const Pattern& pattern = patterns[instancePattern[i]];
+        const glm::ivec3 lo = instances[i].transform.t + pattern.rotMin;
+        const glm::ivec3 hi = instances[i].transform.t + pattern.rotMax;
+        instanceMin[i] = glm::ivec3(lo.x - sceneMin.x, sceneMax.z - hi.z, lo.y - sceneMin.y);
+    }
+    const glm::uvec3 sceneExtent(sceneMax.x - sceneMin.x + 1, sceneMax.z - sceneMin.z + 1, sceneMax.y - sceneMin.y + 1);
+    std::cout << "Scene: " << models.size() << " models, " << instances.size() << " instances, "
+              << sceneExtent.x << "x" << sceneExtent.y << "x" << sceneExtent.z << std::endl;
+
+    // Add a single emissive voxel adjacent to the scene
+    const int32_t gridSize = static_cast<int32_t>(1u << m_depth);
+    const glm::ivec3 light(std::min<int32_t>(sceneExtent.x, gridSize - 1),
+                           std::min<int32_t>(sceneExtent.y / 2, gridSize - 1),
+                           std::min<int32_t>(sceneExtent.z / 2, gridSize - 1));
+
+    // Sharing candidates: instances of a pattern whose corners sit at the same
+    // offset inside an aligned block of the pattern's power-of-two size (or
+    // twice that). The block must hold nothing but its instance.
+    struct Placement {
+        uint32_t pattern;
+        uint32_t blockSize;
+        glm::ivec3 phase; // pattern corner inside the block
+        bool operator<(const Placement& o) const {
+            return std::tie(pattern, blockSize, phase.x, phase.y, phase.z) <
+                   std::tie(o.pattern, o.blockSize, o.phase.x, o.phase.y, o.phase.z);
+        }
+    };
+    auto inside = [](glm::ivec3 lo, glm::ivec3 hi, glm::ivec3 boxLo, glm::ivec3 boxHi) {
+        return lo.x <= boxHi.x && hi.x >= boxLo.x && lo.y <= boxHi.y && hi.y >= boxLo.y &&
+               lo.z <= boxHi.z && hi.z >= boxLo.z;
+    };
+    auto instanceMax = [&](size_t i) { return instanceMin[i] + glm::ivec3(patterns[instancePattern[i]].extent) - 1; };
+
+    // Bin the non-empty instances on a coarse grid over the scene (offsets
+    // into one list, like the triangle bins of the .obj voxelizer), so a
+    // block is only tested against the instances near it
+    uint32_t binShift = 6;
+    auto binGrid = [&](uint32_t shift) { return ((sceneExtent - 1u) >> shift) + 1u; };
+    while (static_cast<uint64_t>(binGrid(binShift).x) * binGrid(binShift).y * binGrid(binShift).z > (1u << 18)) {
+        ++binShift;
+    }
+    const glm::uvec3 bins = binGrid(binShift);
+    // Calls visit(bin) for every bin overlapping [lo, hi] until it returns false
+    auto forEachBin = [&](glm::ivec3 lo, glm::ivec3 hi, auto&& visit) {
+        const glm::uvec3 binLo = glm::min(glm::uvec3(glm::max(lo, glm::ivec3(0))) >> binShift, bins - 1u);
+        const glm::uvec3 binHi = glm::min(glm::uvec3(glm::max(hi, glm::ivec3(0))) >> binShift, bins - 1u);
+        for (uint32_t z = binLo.z; z <= binHi.z; ++z)
+            for (uint32_t y = binLo.y; y <= binHi.y; ++y)
+                for (uint32_t x = binLo.x; x <= binHi.x; ++x) {
+                    if (!visit((static_cast<size_t>(z) * bins.y + y) * bins.x + x)) return false;
+                }
+        return true;
+    };
+    std::vector<uint32_t> binStart(static_cast<size_t>(bins.x) * bins.y * bins.z + 1, 0u);
+    for (size_t j = 0; j < instances.size(); ++j) {
+        if (patterns[instancePattern[j]].voxelCount == 0) continue;
+        forEachBin(instanceMin[j], instanceMax(j), [&](size_t bin) {
+            binStart[bin + 1]++;
+            return true;
+        });
+    }
+    for (size_t b = 1; b < binStart.size(); ++b) binStart[b] += binStart[b - 1];
+    std::vector<uint32_t> binInstances(binStart.back());
+    {
+        std::vector<uint32_t> cursor(binStart.begin(), binStart.end() - 1);
+        for (size_t j = 0; j < instances.size(); ++j) {
+            if (patterns[instancePattern[j]].voxelCount == 0) continue;
+            forEachBin(instanceMin[j], instanceMax(j), [&](size_t bin) {
+                binInstances[cursor[bin]++] = static_cast<uint32_t>(j);
+                return true;
+            });
+        }
+    }
+
+    std::map<Placement, std::vector<size_t>> shared;
+    for (size_t i = 0; i < instances.size(); ++i) {
+        const Pattern& pattern = patterns[instancePattern[i]];
+        if (pattern.voxelCount < 64) continue; // cheaper to insert than to graft
+        const glm::ivec3 extent(pattern.extent);
+        uint32_t block = ceilPow2(std::max({pattern.extent.x, pattern.extent.y, pattern.extent.z, 4u}));
+        glm::ivec3 phase = instanceMin[i] & glm::ivec3(block - 1);
+        if (anyGreater(phase + extent, glm::ivec3(block))) {
+            block *= 2;
+            phase = instanceMin[i] & glm::ivec3(block - 1);
+            if (anyGreater(phase + extent, glm::ivec3(block))) continue;
+        }
+        const glm::ivec3 origin = instanceMin[i] - phase;
+        const glm::ivec3 originMax = origin + static_cast<int32_t>(block) - 1;
+        if (block >= static_cast<uint32_t>(gridSize) || anyGreater(originMax, glm::ivec3(gridSize - 1))) {
+            continue;
+        }
+        const bool alone = !inside(light, light, origin, originMax) &&
+                           forEachBin(origin, originMax, [&](size_t bin) {
+                               for (uint32_t k = binStart[bin]; k < binStart[bin + 1]; ++k) {
+                                   const uint32_t j = binInstances[k];
+                                   if (j != i && inside(instanceMin[j], instanceMax(j), origin, originMax)) return false;
+                               }
+                               return true;
+                           });
+        if (alone) shared[Placement{instancePattern[i], block, phase}].push_back(i);
+    }
+
+    // Everything not shared goes through the bulk build
+    std::vector<bool> grafted(instances.size(), false);
+    for (auto& entry : shared) {
+        if (entry.second.size() < 2) continue;
+        for (size_t i : entry.second) grafted[i] = true;
+    }
+    size_t bulkVoxels = 1; // plus the light
+    for (size_t i = 0; i < instances.size(); ++i) {
+        if (!grafted[i]) bulkVoxels += patterns[instancePattern[i]].voxelCount;
+    }
+    std::vector<Voxel> voxels;
+    voxels.reserve(bulkVoxels);
+    for (size_t i = 0; i < instances.size(); ++i) {
+        if (!grafted[i]) emitPattern(patterns[instancePattern[i]], instanceMin[i], gridSize, voxels);
+    }
+    const size_t insertedVoxels = voxels.size();
+
+    // The light color gets its own slot past the 256 file entries
+    palette.push_back(packColor(255, 255, 255, 255));
+    voxels.push_back({glm::uvec3(light), static_cast<uint32_t>(palette.size() - 1)});
+
+    // Voxels carry palette indices, so colors are resolved once per entry
+    buildFromVoxels(voxels.data(), voxels.size(), palette.data(), palette.size());
+
+    // Shared placements: one subtree per group, hung under every block
+    size_t sharedPlacements = 0, sharedVoxels = 0;
+    for (auto& entry : shared) {
+        if (entry.second.size() < 2) continue;
+        const Placement& placement = entry.first;
+        const Pattern& pattern = patterns[placement.pattern];
+        const uint32_t blockLevels = log2u(placement.blockSize);
+        SparseVoxelOctree sub(blockLevels);
+        sub.setBuildThreads(m_buildThreads, m_buildSplitLevel);
+        std::vector<Voxel> local;
+        local.reserve(pattern.voxelCount);
+        emitPattern(pattern, placement.phase, static_cast<int32_t>(placement.blockSize), local);
+        sub.buildFromVoxels(local.data(), local.size(), palette.data(), palette.size());
+        const uint32_t root = appendSubtree(sub);
+
+        std::vector<glm::ivec3> origins;
+        for (size_t i : entry.second) {
+            const glm::ivec3 origin = instanceMin[i] - placement.phase;
+            if (std::find(origins.begin(), origins.end(), origin) != origins.end()) continue; // exact duplicate
+            origins.push_back(origin);
+            if (!graftNode(glm::uvec3(origin), m_depth - blockLevels, root)) {
+                std::cerr << "Could not place instance of model " << pattern.model << " at block "
+                          << origin.x << "," << origin.y << "," << origin.z << std::endl;
+                continue;
+            }
+            for (const glm::uvec3& e : sub.m_emissiveVoxels) m_emissiveVoxels.push_back(e + glm::uvec3(origin));
+            sharedPlacements++;
+            sharedVoxels += pattern.voxelCount;
+        }
+    }
+    if (sharedPlacements > 0) {
+        // Grafted blocks have several parents and were appended after their
+        // children's parents; compaction restores the order
+        m_sharedBlocks = true;
+        m_sharedBlockLimit = m_nodes.size();
+        m_childOrderBroken = true;
+        m_emissiveDirty = true;
+    }
+
+    std::cout << "Successfully loaded " << filepath << " (" << insertedVoxels << " voxels inserted, "
+              << sharedVoxels << " placed through " << sharedPlacements << " shared subtrees)" << std::endl;
+    std::cout << "Octree has " << m_nodes.size() << " nodes and " << m_colors.size() << " unique colors (palette)" << std::endl;
+
+    // Mark homogeneous nodes for traversal optimization, then drop the
+    // children orphaned by collapsed nodes before GPU upload
+    markHomogeneousNodes();
+    compactNodes();
+    computeLodColors();
+
+    return true;
+}
+
+uint32_t SparseVoxelOctree::appendSubtree(const SparseVoxelOctree& sub) {
+    std::vector<uint32_t> colorRemap(sub.m_colors.size());
+    for (size_t c = 0; c < sub.m_colors.size(); ++c) colorRemap[c] = getOrAddColor(sub.m_colors[c]);
+
+    // Sub node i (past its root) lands at base + i - 1, keeping blocks 8-aligned
+    const uint64_t base = m_nodes.size();
+    if (base + sub.m_nodes.size() > UINT32_MAX) {
+        std::cerr << "Octree instancing: node count exceeds 32-bit node indices" << std::endl;
+        return 0;
+    }
+    auto remap = [&](uint32_t data) -> uint32_t {
+        if (data & OctreeNode::LEAF_BIT) {
+            return (data & ~OctreeNode::PAYLOAD_MASK) | colorRemap[data & OctreeNode::PAYLOAD_MASK];
+        }
+        const uint32_t child = sub.childPointer(data);
+        return child ? pointerWord(static_cast<uint32_t>(base + child - 1), m_farPointers) : 0u;
+    };
+    dropCachedEncoding();
+    m_levelOffsets.clear(); // appended blocks break the level-major layout
+    m_nodes.reserve(base + sub.m_nodes.size() - 1);
+    for (size_t i = 1; i < sub.m_nodes.size(); ++i) m_nodes.push_back({remap(sub.m_nodes[i].data)});
+    m_lodColors.clear();
+    markNodesDirty(base, m_nodes.size());
+    return remap(sub.m_nodes[0].data);
+}
+
+bool SparseVoxelOctree::graftNode(glm::uvec3 origin, uint32_t level, uint32_t word) {
+    uint32_t idx = 0;
+    for (uint32_t k = 0; k < level; ++k) {
+        const uint32_t data = m_nodes[idx].data;
+        if (data & OctreeNode::LEAF_BIT) return false;
+        uint32_t child = childPointer(data);
+        if (child == 0) {
+            const uint32_t words[8] = {};
+            child = appendChildBlock(words, nullptr);
+            if (child == 0) return false;
+            m_nodes[idx].data = pointerWord(child, m_farPointers);
+            markNodesDirty(idx, idx + 1);
+        } else if (child < m_sharedBlockLimit) {
+            return false; // inside another shared subtree
+        }
+        const uint32_t shift = m_depth - 1 - k;
+        idx = child + ((origin.x >> shift) & 1u) * 4 + ((origin.y >> shift) & 1u) * 2 + ((origin.z >> shift) & 1u);
+    }
+    if (m_nodes[idx].data != 0) return false;
+    m_nodes[idx].data = word;
+    markNodesDirty(idx, idx + 1);
+    return true;
+}
+
+} // namespace vox
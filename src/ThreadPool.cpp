@@ -0,0 +1,165 @@
+#include "vox/ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace vox {
+
+ThreadPool::ThreadPool(uint32_t threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    m_workers.reserve(threadCount);
+    for (uint32_t i = 0; i < threadCount; ++i) {
+        m_workers.emplace_back([this] { workerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_cv.notify_all();
+    for (auto& t : m_workers) t.join();
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tasks.push_back(std::move(task));
+    }
+    m_cv.notify_one();
+}
+
+void ThreadPool::workerLoop() {
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this] { return m_stopping || !m_tasks.empty(); });
+            if (m_stopping && m_tasks.empty()) return;
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+        task();
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& fn) {
+    if (count == 0) return;
+    if (count == 1 || m_workers.empty()) {
+        for (size_t i = 0; i < count; ++i) fn(i);
+        return;
+    }
+
+    // Shared state outlives this call: helpers queued behind other work may
+    // start after every index has already been claimed.
+    struct State {
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> done{0};
+        std::mutex mutex;
+        std::condition_variable cv;
+    };
+    auto state = std::make_shared<State>();
+    const std::function<void(size_t)>* body = &fn;
+
+    auto drain = [state, body, count] {
+        size_t finished = 0;
+        for (size_t i; (i = state->next.fetch_add(1)) < count; ++finished) {
+            (*body)(i);
+        }
+        if (finished && state->done.fetch_add(finished) + finished == count) {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->cv.notify_all();
+        }
+    };
+
+    size_t helpers = std::min<size_t>(m_workers.size(), count - 1);
+    for (size_t h = 0; h < helpers; ++h) submit(drain);
+    drain();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->cv.wait(lock, [&] { return state->done.load() == count; });
+}
+
+void ThreadPool::parallelForStealing(size_t count, const std::function<void(size_t)>& fn) {
+    if (count <= 1 || m_workers.empty() || count > UINT32_MAX) {
+        parallelFor(count, fn);
+        return;
+    }
+
+    // One [begin, end) slice per participant packed into a single word, so
+    // the owner taking its next index and a thief splitting off the upper
+    // half are both one compare-exchange. Slices get their own cache lines.
+    struct alignas(64) Slice {
+        std::atomic<uint64_t> range{0};
+    };
+    struct State {
+        explicit State(size_t participants) : slices(participants) {}
+        std::vector<Slice> slices;
+        std::atomic<size_t> done{0};
+        std::mutex mutex;
+        std::condition_variable cv;
+    };
+    auto pack = [](uint64_t begin, uint64_t end) { return (end << 32) | begin; };
+
+    const size_t participants = std::min<size_t>(m_workers.size() + 1, count);
+    auto state = std::make_shared<State>(participants);
+    for (size_t p = 0; p < participants; ++p) {
+        state->slices[p].range.store(pack(count * p / participants, count * (p + 1) / participants));
+    }
+    const std::function<void(size_t)>* body = &fn;
+
+    auto run = [state, body, count, pack](size_t self) {
+        std::vector<Slice>& slices = state->slices;
+        size_t finished = 0;
+        for (;;) {
+            // Own slice first, from the bottom
+            std::atomic<uint64_t>& own = slices[self].range;
+            uint64_t range = own.load();
+            uint32_t begin = static_cast<uint32_t>(range), end = static_cast<uint32_t>(range >> 32);
+            if (begin < end) {
+                if (own.compare_exchange_weak(range, pack(begin + 1, end))) {
+                    (*body)(begin);
+                    ++finished;
+                }
+                continue;
+            }
+
+            // Then the upper half of the largest slice left anywhere
+            size_t victim = slices.size();
+            uint32_t largest = 0;
+            for (size_t p = 0; p < slices.size(); ++p) {
+                const uint64_t r = slices[p].range.load();
+                const uint32_t left = static_cast<uint32_t>(r >> 32) - static_cast<uint32_t>(r);
+                if (static_cast<uint32_t>(r >> 32) > static_cast<uint32_t>(r) && left > largest) {
+                    largest = left;
+                    victim = p;
+                }
+            }
+            if (victim == slices.size()) break;
+            uint64_t stolen = slices[victim].range.load();
+            begin = static_cast<uint32_t>(stolen);
+            end = static_cast<uint32_t>(stolen >> 32);
+            if (begin >= end) continue;
+            const uint32_t mid = begin + (end - begin) / 2;
+            if (slices[victim].range.compare_exchange_strong(stolen, pack(begin, mid))) {
+                // Nobody else writes an empty slice, and thieves skip it
+                own.store(pack(mid, end));
+            }
+        }
+        if (finished && state->done.fetch_add(finished) + finished == count) {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->cv.notify_all();
+        }
+    };
+
+    for (size_t p = 1; p < participants; ++p) submit([run, p] { run(p); });
+    run(0);
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->cv.wait(lock, [&] { return state->done.load() == count; });
+}
+
+} // namespace vox
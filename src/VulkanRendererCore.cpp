@@ -1,12 +1,15 @@
 #include "vox/VulkanRenderer.h"
 #include "vox/SparseVoxelOctree.h"
+#include "vox/OctreePageCache.h"
+#include "vox/SceneLoader.h"
 #include "imgui.h"
 #include "imgui_impl_sdl2.h"
 #include "imgui_impl_vulkan.h"
 
 namespace vox {
 
-VulkanRenderer::VulkanRenderer(SDL_Window* window) : m_window(window) {}
+VulkanRenderer::VulkanRenderer(SDL_Window* window)
+    : m_window(window), m_nodeFormat(NodeFormat::SparseMask), m_nodeOrder(NodeOrder::BreadthFirst) {}
 
 VulkanRenderer::~VulkanRenderer() {
     if (!m_initialized) return;
@@ -41,10 +44,10 @@ VulkanRenderer::~VulkanRenderer() {
     if (m_postImageMemory != VK_NULL_HANDLE) vkFreeMemory(m_device, m_postImageMemory, nullptr);
 
     // Octree buffers
-    if (m_octreeNodesBuffer != VK_NULL_HANDLE) vkDestroyBuffer(m_device, m_octreeNodesBuffer, nullptr);
-    if (m_octreeNodesMemory != VK_NULL_HANDLE) vkFreeMemory(m_device, m_octreeNodesMemory, nullptr);
-    if (m_octreeColorsBuffer != VK_NULL_HANDLE) vkDestroyBuffer(m_device, m_octreeColorsBuffer, nullptr);
-    if (m_octreeColorsMemory != VK_NULL_HANDLE) vkFreeMemory(m_device, m_octreeColorsMemory, nullptr);
+    destroyOctreeBuffers();
+    destroyStaging();
+    destroyTraceStats();
+    destroyPageFeedback();
     if (m_emissiveBuffer != VK_NULL_HANDLE) vkDestroyBuffer(m_device, m_emissiveBuffer, nullptr);
     if (m_emissiveMemory != VK_NULL_HANDLE) vkFreeMemory(m_device, m_emissiveMemory, nullptr);
     if (m_spatialGridBuffer != VK_NULL_HANDLE) vkDestroyBuffer(m_device, m_spatialGridBuffer, nullptr);
@@ -1,4 +1,10 @@
 #include "vox/VulkanRenderer.h"
+#include "vox/SparseVoxelOctree.h"
+#include "vox/OctreePageCache.h"
+#include "vox/CpuRenderer.h"
+#include "vox/ImageWriter.h"
+#include "vox/SceneLoader.h"
+#include "vox/ThreadPool.h"
 #include "VulkanRendererCommon.h"
 #include "imgui.h"
 #include "imgui_impl_sdl2.h"
@@ -49,6 +55,8 @@ void VulkanRenderer::drawFrame() {
             vkWaitSemaphores(m_device, &waitInfo, UINT64_MAX);
         }
     }
+    // This image's previous frame has retired: read back its timestamps and fetch counter
+    collectTraceStats(std::min(imgIndex, kStatsSlots - 1));
 
     if (m_imguiInitialized) {
         ImGui_ImplVulkan_NewFrame();
@@ -58,6 +66,80 @@ void VulkanRenderer::drawFrame() {
         if (m_guiVisible) {
             ImGui::Begin("Debug & Lighting");
         ImGui::Checkbox("SVO overlay", &m_showSvoOverlay);
+        ImGui::Text("Octree nodes: %llu KB (%s)", static_cast<unsigned long long>(m_octreeNodesBytes / 1024),
+                    nodeFormatName(m_nodeFormat));
+        const char* nodeFormats[] = { nodeFormatName(NodeFormat::Dense), nodeFormatName(NodeFormat::SparseMask),
+                                      nodeFormatName(NodeFormat::Bricks) };
+        int nodeFormat = static_cast<int>(m_nodeFormat);
+        if (ImGui::Combo("Node format", &nodeFormat, nodeFormats, 3)) {
+            m_nodeFormat = static_cast<NodeFormat>(nodeFormat);
+            uploadOctree();
+        }
+        if (m_traceQueryPool != VK_NULL_HANDLE) ImGui::Text("GPU trace: %.2f ms", m_gpuTraceMs);
+        const char* nodeOrders[] = { nodeOrderName(NodeOrder::BreadthFirst), nodeOrderName(NodeOrder::DepthFirst),
+                                     nodeOrderName(NodeOrder::VanEmdeBoas) };
+        int nodeOrder = static_cast<int>(m_nodeOrder);
+        if (!m_bench.active && ImGui::Combo("Node order", &nodeOrder, nodeOrders, 3)) {
+            m_nodeOrder = static_cast<NodeOrder>(nodeOrder);
+            applyNodeOrder(m_nodeOrder);
+        }
+        if (m_bench.active) {
+            ImGui::Text("Benchmarking %s...", nodeOrderName(static_cast<NodeOrder>(m_bench.order)));
+        } else if (ImGui::Button("Benchmark node orders")) {
+            startNodeOrderBenchmark();
+        }
+        if (m_benchHasResults) {
+            for (uint32_t i = 0; i < 3; ++i) {
+                const double frames = std::max<uint32_t>(1u, m_bench.samples[i]);
+                ImGui::Text("  %-14s %.3f ms, %.2f M fetches", nodeOrderName(static_cast<NodeOrder>(i)),
+                            m_bench.gpuMs[i] / frames, static_cast<double>(m_bench.nodeFetches[i]) / frames * 1e-6);
+            }
+        }
+        if (ImGui::Button("Octree stats")) {
+            // Also printed as JSON so runs can be diffed
+            m_octreeStats = std::make_unique<OctreeStats>(m_octree->computeStats(m_nodeFormat));
+            std::cout << m_octreeStats->toJson() << std::endl;
+        }
+        if (m_octreeStats) {
+            const OctreeStats& st = *m_octreeStats;
+            ImGui::Text("  %llu nodes (%llu orphaned), %.1f%% leaves, %.1f%% empty",
+                        static_cast<unsigned long long>(st.totalNodes), static_cast<unsigned long long>(st.orphanedNodes),
+                        st.leafRatio * 100.0, st.emptyRatio * 100.0);
+            ImGui::Text("  %llu homogeneous, %llu shared blocks, %llu colors, %llu emissive",
+                        static_cast<unsigned long long>(st.homogeneousLeaves), static_cast<unsigned long long>(st.sharedBlocks),
+                        static_cast<unsigned long long>(st.paletteSize), static_cast<unsigned long long>(st.emissiveVoxels));
+            ImGui::Text("  host %.1f MB, GPU %.1f MB (%s)", st.hostBytes / (1024.0 * 1024.0),
+                        st.gpuBytes / (1024.0 * 1024.0), nodeFormatName(st.gpuFormat));
+            for (size_t l = 0; l < st.nodesPerLevel.size(); ++l) {
+                ImGui::Text("  level %2zu: %llu nodes, %llu leaves, %llu empty", l,
+                            static_cast<unsigned long long>(st.nodesPerLevel[l]),
+                            static_cast<unsigned long long>(st.leavesPerLevel[l]),
+                            static_cast<unsigned long long>(st.emptyPerLevel[l]));
+            }
+        }
+        if (m_pageCache) {
+            ImGui::Text("Pages: %u/%u resident (%u slots), host cache %llu MB, %llu hits / %llu misses",
+                        m_pagesResident, m_pageCache->pageCount(), m_pageSlotCount,
+                        static_cast<unsigned long long>(m_pageCache->residentBytes() >> 20),
+                        static_cast<unsigned long long>(m_pageCache->hits()),
+                        static_cast<unsigned long long>(m_pageCache->misses()));
+        } else if (ImGui::Button("Write paged octree")) {
+            savePagedOctree();
+        }
+        if (ImGui::Button("Render CPU reference")) {
+            renderCpuReference();
+        }
+        ImGui::InputText("Scene", m_scenePath, sizeof(m_scenePath));
+        if (m_sceneLoader->busy()) {
+            ImGui::Text("%s...", m_sceneLoader->status().c_str());
+        } else if (ImGui::Button("Load scene")) {
+            loadScene(m_scenePath);
+        }
+        ImGui::Checkbox("Hot reload", &m_hotReload);
+        ImGui::Checkbox("Solid meshes", &m_solidFillMeshes);
+        if (m_streamNodeCount != 0) {
+            ImGui::Text("Streaming nodes: %.0f%%", 100.0 * m_streamedNodes / m_streamNodeCount);
+        }
         ImGui::Separator();
         
         ImGui::SliderFloat("Resolution scale", &m_resolutionScale, 0.25f, 1.0f);
@@ -90,17 +172,50 @@ void VulkanRenderer::drawFrame() {
 
         ImGui::SliderFloat("DDA epsilon", &m_shaderParams.params1.w, 0.00001f, 0.001f, "%.5f");
         ImGui::SliderFloat("DDA step scale", &m_shaderParams.params2.x, 0.000001f, 0.001f, "%.6f");
+        ImGui::SliderFloat("LOD min occupancy", &m_shaderParams.params2.z, 0.0f, 1.0f);
 
         ImGui::Checkbox("Bloom", &m_bloomEnabled);
         ImGui::SliderFloat("Bloom threshold", &m_bloomThreshold, 0.0f, 2.0f);
         ImGui::SliderFloat("Bloom intensity", &m_bloomIntensity, 0.0f, 2.0f);
         ImGui::SliderFloat("Bloom radius", &m_bloomRadius, 1.0f, 6.0f);
+        ImGui::Separator();
+
+        ImGui::InputInt3("Edit min", m_editMin);
+        ImGui::InputInt3("Edit max", m_editMax);
+        ImGui::ColorEdit3("Edit color", m_editColor);
+        ImGui::SameLine();
+        ImGui::Checkbox("Emissive", &m_editEmissive);
+        glm::uvec3 editMin(glm::max(glm::ivec3(m_editMin[0], m_editMin[1], m_editMin[2]), glm::ivec3(0)));
+        glm::uvec3 editMax(glm::max(glm::ivec3(m_editMax[0], m_editMax[1], m_editMax[2]), glm::ivec3(0)));
+        if (ImGui::Button("Fill box")) {
+            uint32_t rgb = (static_cast<uint32_t>(m_editColor[0] * 255.0f) << 16) |
+                           (static_cast<uint32_t>(m_editColor[1] * 255.0f) << 8) |
+                            static_cast<uint32_t>(m_editColor[2] * 255.0f);
+            if (m_editEmissive) rgb |= 0xFF000000u; // high byte: emissive
+            m_octree->fillBox(editMin, editMax, rgb);
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Clear box")) {
+            m_octree->clearBox(editMin, editMax);
+        }
         ImGui::End();
         }
 
         ImGui::Render();
     }
 
+    // Swap in a finished background load and stream its next node range
+    pollSceneLoader();
+    // Push voxel edits made since the last frame
+    syncOctreeEdits();
+    // Stream in the pages rays asked for
+    updatePageResidency();
+
+    // Benchmark camera path and node-fetch counting (params2.w) for this frame
+    advanceNodeOrderBenchmark();
+    const uint32_t statsSlot = std::min(imgIndex, kStatsSlots - 1);
+    m_slotBenchOrder[statsSlot] = m_shaderParams.params2.w != 0.0f ? static_cast<int32_t>(m_bench.order) : -1;
+
     // Re-record compute command buffer for this frame
     DBGPRINT << "drawFrame: resetting command buffer\n";
     vkResetCommandBuffer(m_cmdBuffers[imgIndex], 0);
@@ -114,6 +229,9 @@ void VulkanRenderer::drawFrame() {
     vkBeginCommandBuffer(m_cmdBuffers[imgIndex], &cbbi);
     DBGPRINT << "drawFrame: command buffer begun\n";
 
+    // Octree and light writes staged since the last frame land before tracing
+    recordStagedCopies(m_cmdBuffers[imgIndex]);
+
     // Dispatch compute shader or trace rays (RTX)
     vkCmdBindPipeline(m_cmdBuffers[imgIndex],
                       m_useRTX ? VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR : VK_PIPELINE_BIND_POINT_COMPUTE,
@@ -126,49 +244,8 @@ void VulkanRenderer::drawFrame() {
     DBGPRINT << "drawFrame: descriptor sets bound\n";
 
     // Push time for camera orbit + debug mask + camera params + gridSize
-    struct PC { 
-        float time; 
-        uint32_t debugMask; 
-        float distance; 
-        float yaw; 
-        float pitch; 
-        float fov; 
-        float gridSize; 
-        uint32_t pad;
-        glm::vec3 cameraPos;
-        float pad2;
-        glm::vec3 cameraDir;
-        float pad3;
-    } pc;
-
-    auto nowTime = std::chrono::high_resolution_clock::now();
-    if (m_pauseOrbit) {
-        pc.time = m_pausedTime;
-    } else {
-        if (m_startTime.time_since_epoch().count() == 0) m_startTime = nowTime;
-        pc.time = std::chrono::duration<float>(nowTime - m_startTime).count();
-    }
-
-    // debugMask: bit0 = show subgrids, bit1 = show root bounds, bit2 = manual control, bit3 = free-fly camera
-    uint32_t debugFlags = m_showSvoOverlay ? 1u : 0u;  // Only bit0 for subgrids, no root bounds
-    if (m_manualControl) debugFlags |= 4u;
-    if (m_freeFlyCameraMode) debugFlags |= 8u;
-    pc.debugMask = debugFlags;
-
-    // ensure distance respects safety minimum (for orbit mode)
-    const float gridSize = static_cast<float>(m_gridSize);
-    float halfDiag = std::sqrt(3.0f) * (gridSize * 0.5f);
-    float minDist = halfDiag * 1.2f;
-    pc.distance = std::max(m_distance, minDist);
-    pc.yaw = m_yaw;
-    pc.pitch = m_pitch;
-    pc.fov = m_fov;
-    pc.gridSize = gridSize;
-    pc.pad = 0;
-    pc.cameraPos = m_cameraPosition;
-    pc.pad2 = 0.0f;
-    pc.cameraDir = m_cameraForward;
-    pc.pad3 = 0.0f;
+    CameraParams pc = currentCamera();
+    pc.statsSlot = statsSlot;
 
     VkShaderStageFlags pushStages = m_useRTX ?
         (VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR) :
@@ -189,11 +266,17 @@ void VulkanRenderer::drawFrame() {
         m_shaderParams.params1.z = static_cast<float>(m_debugMode);
 
         void* dst = nullptr;
-        vkMapMemory(m_device, m_shaderParamsMemory, 0, sizeof(ShaderParamsCPU), 0, &dst);
-        memcpy(dst, &m_shaderParams, sizeof(ShaderParamsCPU));
+        vkMapMemory(m_device, m_shaderParamsMemory, 0, sizeof(ShaderParams), 0, &dst);
+        memcpy(dst, &m_shaderParams, sizeof(ShaderParams));
         vkUnmapMemory(m_device, m_shaderParamsMemory);
     }
 
+    const bool timed = m_traceQueryPool != VK_NULL_HANDLE;
+    if (timed) {
+        vkCmdResetQueryPool(m_cmdBuffers[imgIndex], m_traceQueryPool, 2 * statsSlot, 2);
+        vkCmdWriteTimestamp2(m_cmdBuffers[imgIndex], VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, m_traceQueryPool, 2 * statsSlot);
+    }
+
     if (m_useRTX) {
         // Ray tracing dispatch
         uint32_t renderWidth = static_cast<uint32_t>(m_extent.width * m_resolutionScale);
@@ -222,6 +305,10 @@ void VulkanRenderer::drawFrame() {
 
     VkPipelineStageFlags2 shaderStage = m_useRTX ? VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR
                                                   : VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    if (timed) {
+        vkCmdWriteTimestamp2(m_cmdBuffers[imgIndex], shaderStage, m_traceQueryPool, 2 * statsSlot + 1);
+        m_slotTimed[statsSlot] = true;
+    }
 
     // Barrier: wait for raytrace output before postprocess
     {
@@ -556,6 +643,175 @@ void VulkanRenderer::drawFrame() {
     DBGPRINT << "drawFrame: complete!\n";
 }
 
+// Golden image of the current view for diffing against a GPU capture
+void VulkanRenderer::renderCpuReference() {
+    const char* const path = "../cpu_reference.png";
+    auto start = std::chrono::high_resolution_clock::now();
+    CpuImage image = renderCpuFrame();
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    if (writeImage(path, image.rgb.data(), image.width, image.height)) {
+        std::cout << "CPU reference written to " << path << " (" << ms << " ms)\n";
+    }
+}
+
+CpuImage VulkanRenderer::renderCpuFrame() {
+    CpuRenderer renderer(*m_octree);
+    ThreadPool pool;
+    return renderer.render(m_shaderParams, currentCamera(), m_extent.width, m_extent.height, pool);
+}
+
+void VulkanRenderer::setReferenceView() {
+    m_freeFlyCameraMode = false;
+    m_manualControl = true;
+    m_pauseOrbit = true;
+    m_pausedTime = 0.0f;
+    m_yaw = 0.0f;
+    m_pitch = 0.4f;
+    m_showSvoOverlay = false;
+    m_debugMode = 0;
+    m_bloomEnabled = false;
+    m_resolutionScale = 1.0f;
+    m_hotReload = false;
+}
+
+bool VulkanRenderer::sceneLoading() const {
+    return m_sceneLoader->busy() || m_streamNodeCount != 0;
+}
+
+bool VulkanRenderer::sceneLoaded(const std::string& voxPath) const {
+    return !sceneLoading() && m_loadedScenePath == voxPath;
+}
+
+bool VulkanRenderer::setNodeFormat(NodeFormat format) {
+    vkDeviceWaitIdle(m_device);
+    m_nodeFormat = format;
+    return uploadOctree() && m_nodeFormat == format;
+}
+
+bool VulkanRenderer::captureFrame(CpuImage& image) {
+    vkDeviceWaitIdle(m_device);
+    const VkDeviceSize bytes = static_cast<VkDeviceSize>(m_extent.width) * m_extent.height * 4;
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    void* mapped = nullptr;
+    if (!createMappedBuffer(bytes, VK_BUFFER_USAGE_TRANSFER_DST_BIT, buffer, memory, mapped)) return false;
+
+    VkCommandBufferAllocateInfo cbai{};
+    cbai.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    cbai.commandPool = m_cmdPool;
+    cbai.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    cbai.commandBufferCount = 1;
+
+    VkCommandBuffer copyCmd = VK_NULL_HANDLE;
+    vkAllocateCommandBuffers(m_device, &cbai, &copyCmd);
+
+    VkCommandBufferBeginInfo cbbi{};
+    cbbi.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    cbbi.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(copyCmd, &cbbi);
+
+    // The trace output stays in GENERAL; make its shader writes visible to the copy
+    VkImageMemoryBarrier2 imb{};
+    imb.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+    imb.srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+    imb.srcAccessMask = VK_ACCESS_2_SHADER_WRITE_BIT;
+    imb.dstStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+    imb.dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT;
+    imb.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+    imb.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    imb.image = m_rtImage;
+    imb.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    imb.subresourceRange.levelCount = 1;
+    imb.subresourceRange.layerCount = 1;
+
+    VkDependencyInfo depInfo{};
+    depInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    depInfo.imageMemoryBarrierCount = 1;
+    depInfo.pImageMemoryBarriers = &imb;
+    vkCmdPipelineBarrier2(copyCmd, &depInfo);
+
+    VkBufferImageCopy region{};
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent = {m_extent.width, m_extent.height, 1};
+    vkCmdCopyImageToBuffer(copyCmd, m_rtImage, VK_IMAGE_LAYOUT_GENERAL, buffer, 1, &region);
+
+    VkMemoryBarrier2 hostRead{};
+    hostRead.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+    hostRead.srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+    hostRead.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    hostRead.dstStageMask = VK_PIPELINE_STAGE_2_HOST_BIT;
+    hostRead.dstAccessMask = VK_ACCESS_2_HOST_READ_BIT;
+    VkDependencyInfo hostDep{};
+    hostDep.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    hostDep.memoryBarrierCount = 1;
+    hostDep.pMemoryBarriers = &hostRead;
+    vkCmdPipelineBarrier2(copyCmd, &hostDep);
+    vkEndCommandBuffer(copyCmd);
+
+    VkCommandBufferSubmitInfo cmdSubmit{};
+    cmdSubmit.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+    cmdSubmit.commandBuffer = copyCmd;
+
+    VkSubmitInfo2 si{};
+    si.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+    si.commandBufferInfoCount = 1;
+    si.pCommandBufferInfos = &cmdSubmit;
+    vkQueueSubmit2(m_graphicsQueue, 1, &si, VK_NULL_HANDLE);
+    vkQueueWaitIdle(m_graphicsQueue);
+    vkFreeCommandBuffers(m_device, m_cmdPool, 1, &copyCmd);
+
+    // The shader stores color.bgra into the BGRA image, so the bytes are in
+    // RGB order like the CPU image
+    image.width = m_extent.width;
+    image.height = m_extent.height;
+    image.rgb.resize(static_cast<size_t>(image.width) * image.height * 3);
+    const uint8_t* texels = static_cast<const uint8_t*>(mapped);
+    for (size_t i = 0; i < static_cast<size_t>(image.width) * image.height; ++i) {
+        image.rgb[i * 3 + 0] = texels[i * 4 + 0];
+        image.rgb[i * 3 + 1] = texels[i * 4 + 1];
+        image.rgb[i * 3 + 2] = texels[i * 4 + 2];
+    }
+
+    vkUnmapMemory(m_device, memory);
+    vkDestroyBuffer(m_device, buffer, nullptr);
+    vkFreeMemory(m_device, memory, nullptr);
+    return true;
+}
+
+CameraParams VulkanRenderer::currentCamera() {
+    CameraParams pc;
+    auto nowTime = std::chrono::high_resolution_clock::now();
+    if (m_pauseOrbit) {
+        pc.time = m_pausedTime;
+    } else {
+        if (m_startTime.time_since_epoch().count() == 0) m_startTime = nowTime;
+        pc.time = std::chrono::duration<float>(nowTime - m_startTime).count();
+    }
+
+    // debugMask: bit0 = show subgrids, bit1 = show root bounds, bit2 = manual control, bit3 = free-fly camera
+    uint32_t debugFlags = m_showSvoOverlay ? 1u : 0u;  // Only bit0 for subgrids, no root bounds
+    if (m_manualControl) debugFlags |= 4u;
+    if (m_freeFlyCameraMode) debugFlags |= 8u;
+    pc.debugMask = debugFlags;
+
+    // ensure distance respects safety minimum (for orbit mode)
+    const float gridSize = static_cast<float>(m_gridSize);
+    float halfDiag = std::sqrt(3.0f) * (gridSize * 0.5f);
+    float minDist = halfDiag * 1.2f;
+    pc.distance = std::max(m_distance, minDist);
+    pc.yaw = m_yaw;
+    pc.pitch = m_pitch;
+    pc.fov = m_fov;
+    pc.gridSize = gridSize;
+    pc.octreeDepth = m_octree ? m_octree->getDepth() : pc.octreeDepth;
+    // Per frame, so frames in flight keep the limit their node copies match
+    pc.streamedNodes = m_streamNodeCount != 0 ? static_cast<uint32_t>(m_streamedNodes) : 0u;
+    pc.cameraPos = m_cameraPosition;
+    pc.cameraDir = m_cameraForward;
+    return pc;
+}
+
 void VulkanRenderer::adjustDistance(float delta) {
     m_distance += delta;
     // clamp minimum so camera stays outside SVO
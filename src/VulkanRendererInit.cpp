@@ -1,5 +1,6 @@
 #include "vox/VulkanRenderer.h"
 #include "vox/SparseVoxelOctree.h"
+#include "vox/SceneLoader.h"
 #include "vox/Shader.h"
 #include "VulkanRendererCommon.h"
 #include "imgui.h"
@@ -392,15 +393,19 @@ bool VulkanRenderer::init() {
     semci.pNext = nullptr;
 
     m_cmdBufferValues.assign(m_cmdBuffers.size(), 0);
-
-    // Initialize octree
-    m_octree = std::make_unique<SparseVoxelOctree>(11);
-    if (!m_octree->loadFromVoxFile("../test.vox")) {
-        std::cerr << "Failed to load test.vox, using test scene instead" << std::endl;
-        m_octree->generateTestScene();
+    chooseBufferMemory();
+
+    // Initialize octree: a paged octree (written from the GUI) takes precedence.
+    // Otherwise test.vox loads in the background (test.svo caches the
+    // processed tree) while an empty grid of the same size is drawn
+    m_sceneLoader = std::make_unique<SceneLoader>();
+    if (!openPagedOctree()) {
+        m_octree = std::make_unique<SparseVoxelOctree>(11);
+        m_octree->setNodeOrder(m_nodeOrder);
+        loadScene(m_scenePath, true);
     }
     m_gridSize = 1u << m_octree->getDepth();
-    DBGPRINT << "Octree initialized with test scene\n";
+    DBGPRINT << "Octree initialized (scene loading in the background)\n";
     DBGPRINT << "  Nodes: " << m_octree->getNodes().size() << "\n";
     DBGPRINT << "  Colors: " << m_octree->getColors().size() << "\n";
 
@@ -530,83 +535,18 @@ bool VulkanRenderer::init() {
         DBGPRINT << "Post image created ("  << m_extent.width << "x" << m_extent.height << ")\n";
     }
 
-    // 2. Create octree GPU buffers
-    {
-        const auto& nodes = m_octree->getNodes();
-        const auto& colors = m_octree->getColors();
-
-        // Node buffer
-        VkDeviceSize nodeSize = nodes.size() * sizeof(uint32_t);
-        VkBufferCreateInfo bci{};
-        bci.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-        bci.size = nodeSize;
-        bci.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
-        bci.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-        if (vkCreateBuffer(m_device, &bci, nullptr, &m_octreeNodesBuffer) != VK_SUCCESS) {
-            std::cerr << "vkCreateBuffer (octree nodes) failed\n";
-            return false;
-        }
-
-        VkMemoryRequirements memReq{};
-        vkGetBufferMemoryRequirements(m_device, m_octreeNodesBuffer, &memReq);
-
-        VkPhysicalDeviceMemoryProperties memProps{};
-        vkGetPhysicalDeviceMemoryProperties(m_physicalDevice, &memProps);
-        auto findMemoryType = [&](uint32_t typeFilter, VkMemoryPropertyFlags props) -> uint32_t {
-            for (uint32_t i = 0; i < memProps.memoryTypeCount; ++i) {
-                if ((typeFilter & (1u << i)) && (memProps.memoryTypes[i].propertyFlags & props) == props) return i;
-            }
-            return 0;
-        };
-
-        VkMemoryAllocateInfo mai{};
-        mai.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        mai.allocationSize = memReq.size;
-        mai.memoryTypeIndex = findMemoryType(memReq.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-        if (vkAllocateMemory(m_device, &mai, nullptr, &m_octreeNodesMemory) != VK_SUCCESS) {
-            std::cerr << "vkAllocateMemory (octree nodes) failed\n";
-            return false;
-        }
-
-        vkBindBufferMemory(m_device, m_octreeNodesBuffer, m_octreeNodesMemory, 0);
-
-        void* dst = nullptr;
-        vkMapMemory(m_device, m_octreeNodesMemory, 0, nodeSize, 0, &dst);
-        memcpy(dst, nodes.data(), nodeSize);
-        vkUnmapMemory(m_device, m_octreeNodesMemory);
-
-        // Color buffer
-        VkDeviceSize colorSize = colors.size() * sizeof(uint32_t);
-        bci.size = colorSize;
-
-        if (vkCreateBuffer(m_device, &bci, nullptr, &m_octreeColorsBuffer) != VK_SUCCESS) {
-            std::cerr << "vkCreateBuffer (octree colors) failed\n";
-            return false;
-        }
+    // 2. Create octree GPU buffers (persistently mapped so edits can patch dirty ranges)
+    if (!uploadOctree()) return false;
 
-        vkGetBufferMemoryRequirements(m_device, m_octreeColorsBuffer, &memReq);
-        mai.allocationSize = memReq.size;
-        mai.memoryTypeIndex = findMemoryType(memReq.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    // 2d. Trace timestamps and node-fetch counters
+    if (!createTraceStats()) return false;
 
-        if (vkAllocateMemory(m_device, &mai, nullptr, &m_octreeColorsMemory) != VK_SUCCESS) {
-            std::cerr << "vkAllocateMemory (octree colors) failed\n";
-            return false;
-        }
-
-        vkBindBufferMemory(m_device, m_octreeColorsBuffer, m_octreeColorsMemory, 0);
-
-        dst = nullptr;
-        vkMapMemory(m_device, m_octreeColorsMemory, 0, colorSize, 0, &dst);
-        memcpy(dst, colors.data(), colorSize);
-        vkUnmapMemory(m_device, m_octreeColorsMemory);
-        DBGPRINT << "Octree GPU buffers created\n";
-    }
+    // 2e. Page requests and last-used stamps
+    if (!createPageFeedback()) return false;
 
     // 2c. Create shader params uniform buffer
     {
-        VkDeviceSize paramsSize = sizeof(ShaderParamsCPU);
+        VkDeviceSize paramsSize = sizeof(ShaderParams);
 
         VkBufferCreateInfo bci{};
         bci.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -650,157 +590,9 @@ bool VulkanRenderer::init() {
         vkUnmapMemory(m_device, m_shaderParamsMemory);
     }
 
-    // 2a. Create emissive voxel buffer (positions + intensity)
-    {
-        const auto& emissiveVoxels = m_octree->getEmissiveVoxels();
-        std::vector<glm::uvec4> emissiveData;
-        emissiveData.reserve(emissiveVoxels.size() + 1);
-        emissiveData.push_back(glm::uvec4(static_cast<uint32_t>(emissiveVoxels.size()), 0u, 0u, 0u));
-        for (const auto& pos : emissiveVoxels) {
-            emissiveData.push_back(glm::uvec4(pos, 255u));
-        }
-
-        VkDeviceSize emissiveSize = emissiveData.size() * sizeof(glm::uvec4);
-
-        VkBufferCreateInfo bci{};
-        bci.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-        bci.size = emissiveSize;
-        bci.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
-        bci.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-        if (vkCreateBuffer(m_device, &bci, nullptr, &m_emissiveBuffer) != VK_SUCCESS) {
-            std::cerr << "vkCreateBuffer (emissive) failed\n";
-            return false;
-        }
-
-        VkMemoryRequirements memReq{};
-        vkGetBufferMemoryRequirements(m_device, m_emissiveBuffer, &memReq);
-
-        VkPhysicalDeviceMemoryProperties memProps{};
-        vkGetPhysicalDeviceMemoryProperties(m_physicalDevice, &memProps);
-        auto findMemoryType = [&](uint32_t typeFilter, VkMemoryPropertyFlags props) -> uint32_t {
-            for (uint32_t i = 0; i < memProps.memoryTypeCount; ++i) {
-                if ((typeFilter & (1u << i)) && (memProps.memoryTypes[i].propertyFlags & props) == props) return i;
-            }
-            return 0;
-        };
-
-        VkMemoryAllocateInfo mai{};
-        mai.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        mai.allocationSize = memReq.size;
-        mai.memoryTypeIndex = findMemoryType(memReq.memoryTypeBits,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-        if (vkAllocateMemory(m_device, &mai, nullptr, &m_emissiveMemory) != VK_SUCCESS) {
-            std::cerr << "vkAllocateMemory (emissive) failed\n";
-            return false;
-        }
-
-        vkBindBufferMemory(m_device, m_emissiveBuffer, m_emissiveMemory, 0);
-
-        void* dst = nullptr;
-        vkMapMemory(m_device, m_emissiveMemory, 0, emissiveSize, 0, &dst);
-        memcpy(dst, emissiveData.data(), emissiveSize);
-        vkUnmapMemory(m_device, m_emissiveMemory);
-    }
-
-    // 2a2. Create spatial light grid for optimization
-    {
-        const auto& emissiveVoxels = m_octree->getEmissiveVoxels();
-        const uint32_t gridDim = 16; // 16x16x16 cells
-        const uint32_t totalCells = gridDim * gridDim * gridDim;
-        const float cellSize = static_cast<float>(m_gridSize) / gridDim;
-        const float lightRadius = cellSize * 1.5f; // Lights affect 1.5 cell radius
-
-        // Build spatial grid: for each cell, collect lights within range
-        std::vector<std::vector<uint32_t>> cellLights(totalCells);
-        
-        for (uint32_t lightIdx = 0; lightIdx < emissiveVoxels.size(); ++lightIdx) {
-            glm::vec3 lightPos = glm::vec3(emissiveVoxels[lightIdx]) + 0.5f;
-            
-            // Determine which cells this light affects
-            glm::ivec3 minCell = glm::max(glm::ivec3((lightPos - lightRadius) / cellSize), glm::ivec3(0));
-            glm::ivec3 maxCell = glm::min(glm::ivec3((lightPos + lightRadius) / cellSize), glm::ivec3(gridDim - 1));
-            
-            for (int z = minCell.z; z <= maxCell.z; ++z) {
-                for (int y = minCell.y; y <= maxCell.y; ++y) {
-                    for (int x = minCell.x; x <= maxCell.x; ++x) {
-                        uint32_t cellIdx = x + y * gridDim + z * gridDim * gridDim;
-                        cellLights[cellIdx].push_back(lightIdx);
-                    }
-                }
-            }
-        }
-
-        // Build buffer data: [gridDim.x, .y, .z, totalLightCount] + [cell offsets/counts] + [light indices]
-        std::vector<uint32_t> gridData;
-        gridData.push_back(gridDim);
-        gridData.push_back(gridDim);
-        gridData.push_back(gridDim);
-        gridData.push_back(static_cast<uint32_t>(emissiveVoxels.size()));
-        
-        // Reserve space for cell headers: [offset, count] per cell
-        uint32_t cellHeaderOffset = static_cast<uint32_t>(gridData.size());
-        gridData.resize(gridData.size() + totalCells * 2); // offset + count per cell
-        
-        // Write light indices
-        uint32_t lightDataOffset = static_cast<uint32_t>(gridData.size());
-        for (uint32_t cellIdx = 0; cellIdx < totalCells; ++cellIdx) {
-            uint32_t offset = static_cast<uint32_t>(gridData.size()) - lightDataOffset;
-            uint32_t count = static_cast<uint32_t>(cellLights[cellIdx].size());
-            
-            gridData[cellHeaderOffset + cellIdx * 2] = offset;
-            gridData[cellHeaderOffset + cellIdx * 2 + 1] = count;
-            
-            gridData.insert(gridData.end(), cellLights[cellIdx].begin(), cellLights[cellIdx].end());
-        }
-        
-        std::cout << "Spatial grid: " << gridDim << "^3 cells, " << gridData.size() << " uints, "
-                  << emissiveVoxels.size() << " lights\n";
-
-        VkDeviceSize gridSize = gridData.size() * sizeof(uint32_t);
-
-        VkBufferCreateInfo bci{};
-        bci.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-        bci.size = gridSize;
-        bci.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
-        bci.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-        if (vkCreateBuffer(m_device, &bci, nullptr, &m_spatialGridBuffer) != VK_SUCCESS) {
-            std::cerr << "vkCreateBuffer (spatial grid) failed\n";
-            return false;
-        }
-
-        VkMemoryRequirements memReq{};
-        vkGetBufferMemoryRequirements(m_device, m_spatialGridBuffer, &memReq);
-
-        VkPhysicalDeviceMemoryProperties memProps{};
-        vkGetPhysicalDeviceMemoryProperties(m_physicalDevice, &memProps);
-        auto findMemoryType = [&](uint32_t typeFilter, VkMemoryPropertyFlags props) -> uint32_t {
-            for (uint32_t i = 0; i < memProps.memoryTypeCount; ++i) {
-                if ((typeFilter & (1u << i)) && (memProps.memoryTypes[i].propertyFlags & props) == props) return i;
-            }
-            return 0;
-        };
-
-        VkMemoryAllocateInfo mai{};
-        mai.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        mai.allocationSize = memReq.size;
-        mai.memoryTypeIndex = findMemoryType(memReq.memoryTypeBits,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-        if (vkAllocateMemory(m_device, &mai, nullptr, &m_spatialGridMemory) != VK_SUCCESS) {
-            std::cerr << "vkAllocateMemory (spatial grid) failed\n";
-            return false;
-        }
-
-        vkBindBufferMemory(m_device, m_spatialGridBuffer, m_spatialGridMemory, 0);
-
-        void* dst = nullptr;
-        vkMapMemory(m_device, m_spatialGridMemory, 0, gridSize, 0, &dst);
-        memcpy(dst, gridData.data(), gridSize);
-        vkUnmapMemory(m_device, m_spatialGridMemory);
-    }
+    // 2a. Create emissive voxel buffer (positions + intensity) and the
+    // spatial light grid over it
+    if (!uploadLights()) return false;
 
     // 2b. Create acceleration structures for RTX (if enabled)
     if (m_useRTX) {
@@ -1167,6 +959,38 @@ bool VulkanRenderer::init() {
         binding6.stageFlags = m_useRTX ? VK_SHADER_STAGE_RAYGEN_BIT_KHR : VK_SHADER_STAGE_COMPUTE_BIT;
         bindings.push_back(binding6);
 
+        // binding 7: per-node LOD colors (occupancy + averaged RGB)
+        VkDescriptorSetLayoutBinding binding7{};
+        binding7.binding = 7;
+        binding7.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        binding7.descriptorCount = 1;
+        binding7.stageFlags = m_useRTX ? VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR : VK_SHADER_STAGE_COMPUTE_BIT;
+        bindings.push_back(binding7);
+
+        // binding 8: traversal statistics (node-fetch counters)
+        VkDescriptorSetLayoutBinding binding8{};
+        binding8.binding = 8;
+        binding8.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        binding8.descriptorCount = 1;
+        binding8.stageFlags = m_useRTX ? VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR : VK_SHADER_STAGE_COMPUTE_BIT;
+        bindings.push_back(binding8);
+
+        // binding 9: far pointer table of dense internal nodes
+        VkDescriptorSetLayoutBinding binding9{};
+        binding9.binding = 9;
+        binding9.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        binding9.descriptorCount = 1;
+        binding9.stageFlags = m_useRTX ? VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR : VK_SHADER_STAGE_COMPUTE_BIT;
+        bindings.push_back(binding9);
+
+        // binding 10: page requests and last-used frame stamps
+        VkDescriptorSetLayoutBinding binding10{};
+        binding10.binding = 10;
+        binding10.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        binding10.descriptorCount = 1;
+        binding10.stageFlags = m_useRTX ? VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR : VK_SHADER_STAGE_COMPUTE_BIT;
+        bindings.push_back(binding10);
+
         VkDescriptorSetLayoutCreateInfo dslci{};
         dslci.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
         dslci.bindingCount = static_cast<uint32_t>(bindings.size());
@@ -1190,7 +1014,7 @@ bool VulkanRenderer::init() {
 
         VkDescriptorPoolSize poolSize1{};
         poolSize1.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        poolSize1.descriptorCount = 4; // nodes, colors, emissive, spatial grid
+        poolSize1.descriptorCount = 8; // nodes, colors, emissive, spatial grid, LOD colors, trace stats, far pointers, page feedback
         poolSizes.push_back(poolSize1);
 
         VkDescriptorPoolSize poolSize3{};
@@ -1248,36 +1072,6 @@ bool VulkanRenderer::init() {
         write0.pImageInfo = &imgInfo;
         writes.push_back(write0);
 
-        // Octree nodes buffer write
-        VkDescriptorBufferInfo nodesBufInfo{};
-        nodesBufInfo.buffer = m_octreeNodesBuffer;
-        nodesBufInfo.offset = 0;
-        nodesBufInfo.range = VK_WHOLE_SIZE;
-
-        VkWriteDescriptorSet write1{};
-        write1.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        write1.dstSet = m_rtDescSet;
-        write1.dstBinding = 1;
-        write1.descriptorCount = 1;
-        write1.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        write1.pBufferInfo = &nodesBufInfo;
-        writes.push_back(write1);
-
-        // Octree colors buffer write
-        VkDescriptorBufferInfo colorsBufInfo{};
-        colorsBufInfo.buffer = m_octreeColorsBuffer;
-        colorsBufInfo.offset = 0;
-        colorsBufInfo.range = VK_WHOLE_SIZE;
-
-        VkWriteDescriptorSet write2{};
-        write2.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        write2.dstSet = m_rtDescSet;
-        write2.dstBinding = 2;
-        write2.descriptorCount = 1;
-        write2.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        write2.pBufferInfo = &colorsBufInfo;
-        writes.push_back(write2);
-
         // Acceleration structure write (RTX only)
         VkWriteDescriptorSetAccelerationStructureKHR asWrite{};
         if (m_useRTX) {
@@ -1313,7 +1107,7 @@ bool VulkanRenderer::init() {
         VkDescriptorBufferInfo paramsInfo{};
         paramsInfo.buffer = m_shaderParamsBuffer;
         paramsInfo.offset = 0;
-        paramsInfo.range = sizeof(ShaderParamsCPU);
+        paramsInfo.range = sizeof(ShaderParams);
 
         VkWriteDescriptorSet write5{};
         write5.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
@@ -1339,7 +1133,38 @@ bool VulkanRenderer::init() {
         write6.pBufferInfo = &gridInfo;
         writes.push_back(write6);
 
+        // Trace statistics buffer write
+        VkDescriptorBufferInfo statsInfo{};
+        statsInfo.buffer = m_traceStatsBuffer;
+        statsInfo.offset = 0;
+        statsInfo.range = VK_WHOLE_SIZE;
+
+        VkWriteDescriptorSet write8{};
+        write8.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write8.dstSet = m_rtDescSet;
+        write8.dstBinding = 8;
+        write8.descriptorCount = 1;
+        write8.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        write8.pBufferInfo = &statsInfo;
+        writes.push_back(write8);
+
+        // Page feedback buffer write
+        VkDescriptorBufferInfo pageInfo{};
+        pageInfo.buffer = m_pageFeedbackBuffer;
+        pageInfo.offset = 0;
+        pageInfo.range = VK_WHOLE_SIZE;
+
+        VkWriteDescriptorSet write10{};
+        write10.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write10.dstSet = m_rtDescSet;
+        write10.dstBinding = 10;
+        write10.descriptorCount = 1;
+        write10.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        write10.pBufferInfo = &pageInfo;
+        writes.push_back(write10);
+
         vkUpdateDescriptorSets(m_device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+        writeOctreeDescriptors(); // bindings 1, 2, 7 and 9; rewritten whenever the buffers grow
         DBGPRINT << "Descriptor sets updated\n";
     }
 
@@ -1604,7 +1429,7 @@ bool VulkanRenderer::init() {
         VkPushConstantRange pushRange{};
         pushRange.stageFlags = VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR;
         pushRange.offset = 0;
-        pushRange.size = sizeof(float) * 6; // time + debugMask + distance + yaw + pitch + fov
+        pushRange.size = sizeof(CameraParams); // read by raygen and closest hit
 
         // Pipeline layout
         VkPipelineLayoutCreateInfo  plci{};
@@ -1760,7 +1585,7 @@ bool VulkanRenderer::init() {
         VkPushConstantRange pushRange{};
         pushRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
         pushRange.offset = 0;
-        pushRange.size = sizeof(float) * 5 + sizeof(uint32_t); // time + (orbitRadius, camHeight, fov, orbitAngle) + debugMask (total 24 bytes)
+        pushRange.size = sizeof(CameraParams);
 
         VkPipelineLayoutCreateInfo plci{};
         plci.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
@@ -0,0 +1,173 @@
+#include "vox/VulkanRenderer.h"
+#include "vox/SparseVoxelOctree.h"
+#include "vox/OctreePageCache.h"
+#include "VulkanRendererCommon.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace vox {
+
+namespace {
+const char* const kPagedOctreePath = "../test.paged"; // .svo top tree + .pages
+constexpr uint32_t kNoPage = ~0u;
+}
+
+bool VulkanRenderer::openPagedOctree() {
+    auto cache = std::make_unique<OctreePageCache>();
+    if (!cache->open(std::string(kPagedOctreePath) + ".pages", m_pageCacheBytes)) return false;
+
+    auto top = std::make_unique<SparseVoxelOctree>();
+    if (!top->loadFromSvoFile(std::string(kPagedOctreePath) + ".svo") || !top->isPagedTop() ||
+        top->getFarPointers().size() != cache->pageCount()) {
+        std::cerr << "Paged octree top tree missing or mismatched: " << kPagedOctreePath << ".svo\n";
+        return false;
+    }
+
+    // Slots are sized for the largest page and must stay inside the 30-bit
+    // pointer range, since resident pages are addressed with plain pointers
+    const uint64_t slotNodes = std::max<uint32_t>(cache->maxPageNodes(), 8u);
+    const uint64_t slotBase = top->getNodes().size();
+    uint64_t slotCount = std::min<uint64_t>(m_pagePoolBytes / (slotNodes * sizeof(uint32_t)), cache->pageCount());
+    slotCount = std::min<uint64_t>(slotCount, (OctreeNode::PAYLOAD_MASK - slotBase) / slotNodes);
+    if (slotCount == 0) {
+        std::cerr << "Page pool of " << (m_pagePoolBytes >> 20) << " MB cannot hold a " << slotNodes << "-node page\n";
+        return false;
+    }
+
+    m_octree = std::move(top);
+    m_pageCache = std::move(cache);
+    m_nodeFormat = NodeFormat::Dense; // page words resolve through the dense far table
+    m_pageSlotNodes = static_cast<uint32_t>(slotNodes);
+    m_pageSlotBase = static_cast<uint32_t>(slotBase);
+    m_pageSlotCount = static_cast<uint32_t>(slotCount);
+    m_slotPage.assign(m_pageSlotCount, kNoPage);
+    m_pageSlot.assign(m_pageCache->pageCount(), kNoPage);
+    std::cout << "Paged octree: " << slotBase << " top nodes, " << m_pageCache->pageCount() << " pages, "
+              << m_pageSlotCount << " GPU slots of " << m_pageSlotNodes << " nodes\n";
+    return true;
+}
+
+void VulkanRenderer::savePagedOctree() {
+    if (m_octree->savePagedFiles(kPagedOctreePath)) {
+        std::cout << "Paged octree written; it is opened instead of test.vox on the next start\n";
+    }
+}
+
+bool VulkanRenderer::createPageFeedback() {
+    // Request counter, kPageRequestCapacity requested pages, then one
+    // last-used frame stamp per page
+    const uint32_t pageCount = m_pageCache ? m_pageCache->pageCount() : 0u;
+    const VkDeviceSize size = (1 + kPageRequestCapacity + static_cast<VkDeviceSize>(pageCount)) * sizeof(uint32_t);
+    if (!createMappedBuffer(size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                            m_pageFeedbackBuffer, m_pageFeedbackMemory, m_pageFeedbackMapped)) {
+        std::cerr << "Failed to create page feedback buffer\n";
+        return false;
+    }
+    std::memset(m_pageFeedbackMapped, 0, size);
+    m_shaderParams.paging = glm::uvec4(m_pageCache ? kPageRequestCapacity : 0u, m_pageFrame, 0u, 0u);
+    return true;
+}
+
+void VulkanRenderer::destroyPageFeedback() {
+    if (m_pageFeedbackMapped) vkUnmapMemory(m_device, m_pageFeedbackMemory);
+    if (m_pageFeedbackBuffer != VK_NULL_HANDLE) vkDestroyBuffer(m_device, m_pageFeedbackBuffer, nullptr);
+    if (m_pageFeedbackMemory != VK_NULL_HANDLE) vkFreeMemory(m_device, m_pageFeedbackMemory, nullptr);
+    m_pageFeedbackMapped = nullptr;
+    m_pageFeedbackBuffer = VK_NULL_HANDLE;
+    m_pageFeedbackMemory = VK_NULL_HANDLE;
+}
+
+// uploadOctree() rewrote the top tree and the (all zero) page table
+void VulkanRenderer::resetPageSlots() {
+    std::fill(m_slotPage.begin(), m_slotPage.end(), kNoPage);
+    std::fill(m_pageSlot.begin(), m_pageSlot.end(), kNoPage);
+    m_pagesResident = 0;
+}
+
+// Once per frame before recording: serve the page requests rays made in
+// earlier frames, evicting slots whose pages the last frame did not touch
+void VulkanRenderer::updatePageResidency() {
+    if (!m_pageCache || !m_pageFeedbackMapped) return;
+    m_pageFrame++;
+    m_shaderParams.paging = glm::uvec4(kPageRequestCapacity, m_pageFrame, 0u, 0u);
+
+    uint32_t* feedback = static_cast<uint32_t*>(m_pageFeedbackMapped);
+    const uint32_t requests = std::min(feedback[0], kPageRequestCapacity);
+    if (requests == 0) return;
+
+    // Every ray that misses a page asks for it; keep each page once, in request
+    // order. Requests racing with the reset below are simply repeated next frame.
+    std::vector<uint32_t> wanted;
+    for (uint32_t i = 0; i < requests; ++i) {
+        const uint32_t page = feedback[1 + i];
+        if (page < m_pageSlot.size() && m_pageSlot[page] == kNoPage &&
+            std::find(wanted.begin(), wanted.end(), page) == wanted.end()) {
+            wanted.push_back(page);
+        }
+    }
+    feedback[0] = 0;
+    if (wanted.empty()) return;
+
+    // Evicted slots may still be read by the frame in flight (staged copies
+    // wait for it on the GPU)
+    if (m_octreeNodesMapped || m_octreeLodMapped || m_octreeFarMapped) waitForLastFrame();
+
+    uint32_t* stamps = feedback + 1 + kPageRequestCapacity;
+    std::vector<uint32_t> slotNodes;
+    uint32_t uploaded = 0;
+    for (uint32_t page : wanted) {
+        if (uploaded == kPageUploadsPerFrame) break;
+
+        uint32_t slot = kNoPage;
+        uint32_t oldest = m_pageFrame - 1; // pages the last frame used stay
+        for (uint32_t s = 0; s < m_pageSlotCount; ++s) {
+            if (m_slotPage[s] == kNoPage) {
+                slot = s;
+                break;
+            }
+            if (stamps[m_slotPage[s]] < oldest) {
+                oldest = stamps[m_slotPage[s]];
+                slot = s;
+            }
+        }
+        if (slot == kNoPage) {
+            DBGPRINT << "Page pool full of visible pages; " << (wanted.size() - uploaded) << " requests deferred\n";
+            break;
+        }
+
+        std::shared_ptr<const OctreePage> data = m_pageCache->acquire(page);
+        if (!data) continue;
+        if (m_slotPage[slot] != kNoPage) {
+            const uint32_t missing = 0;
+            writeBuffer(m_octreeFarBuffer, m_octreeFarMapped, m_slotPage[slot] * sizeof(uint32_t), &missing,
+                        sizeof(uint32_t));
+            m_pageSlot[m_slotPage[slot]] = kNoPage;
+            m_pagesResident--;
+        }
+
+        // Page-local child indices become node buffer indices
+        const uint32_t base = m_pageSlotBase + slot * m_pageSlotNodes;
+        slotNodes.resize(data->nodes.size());
+        for (size_t i = 0; i < data->nodes.size(); ++i) {
+            const uint32_t word = data->nodes[i];
+            slotNodes[i] = (word != 0 && !(word & OctreeNode::LEAF_BIT)) ? word + base : word;
+        }
+        const VkDeviceSize slotOffset = static_cast<VkDeviceSize>(base) * sizeof(uint32_t);
+        writeBuffer(m_octreeNodesBuffer, m_octreeNodesMapped, slotOffset, slotNodes.data(),
+                    slotNodes.size() * sizeof(uint32_t));
+        writeBuffer(m_octreeLodBuffer, m_octreeLodMapped, slotOffset, data->lodColors.data(),
+                    data->lodColors.size() * sizeof(uint32_t));
+        writeBuffer(m_octreeFarBuffer, m_octreeFarMapped, page * sizeof(uint32_t), &base, sizeof(uint32_t));
+        stamps[page] = m_pageFrame;
+        m_pageSlot[page] = slot;
+        m_slotPage[slot] = page;
+        m_pagesResident++;
+        uploaded++;
+    }
+    DBGPRINT << "Paged in " << uploaded << " of " << wanted.size() << " requested pages\n";
+}
+
+} // namespace vox
@@ -0,0 +1,173 @@
+#include "vox/VulkanRenderer.h"
+#include "VulkanRendererCommon.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+namespace vox {
+
+// Shaders fetch octree words from device-local memory at full speed on a
+// discrete GPU; host-visible memory there sits across PCIe (or in a small
+// BAR window). Integrated GPUs and CPU implementations have nothing faster
+// than the memory the host already sees, so staging would only add a copy.
+void VulkanRenderer::chooseBufferMemory() {
+    VkPhysicalDeviceProperties props{};
+    vkGetPhysicalDeviceProperties(m_physicalDevice, &props);
+    VkPhysicalDeviceMemoryProperties memProps{};
+    vkGetPhysicalDeviceMemoryProperties(m_physicalDevice, &memProps);
+
+    bool unified = props.deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU ||
+                   props.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU;
+    bool allHeapsDeviceLocal = true;
+    for (uint32_t i = 0; i < memProps.memoryHeapCount; ++i) {
+        allHeapsDeviceLocal &= (memProps.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+    }
+    m_deviceLocalBuffers = !unified && !allHeapsDeviceLocal;
+    std::cout << "Octree buffers: "
+              << (m_deviceLocalBuffers ? "device-local, uploaded through staging" : "host-visible (unified memory)")
+              << "\n";
+}
+
+void VulkanRenderer::writeBuffer(VkBuffer buffer, void* mapped, VkDeviceSize offset, const void* data,
+                                 VkDeviceSize bytes) {
+    if (mapped) {
+        memcpy(static_cast<uint8_t*>(mapped) + offset, data, bytes);
+        return;
+    }
+    if (m_stagingBuffer == VK_NULL_HANDLE &&
+        !createMappedBuffer(2 * kStagingBytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, m_stagingBuffer, m_stagingMemory,
+                            m_stagingMapped)) {
+        std::cerr << "Failed to create the staging buffer; " << bytes << " bytes not uploaded\n";
+        return;
+    }
+
+    const uint8_t* src = static_cast<const uint8_t*>(data);
+    while (bytes > 0) {
+        if (m_stagingUsed == kStagingBytes) flushStagedCopies();
+        // A fresh half may still be copied from by a frame in flight
+        if (m_stagingUsed == 0 && m_stagingRetire[m_stagingHalf] != 0) {
+            waitForFrame(m_stagingRetire[m_stagingHalf]);
+            m_stagingRetire[m_stagingHalf] = 0;
+        }
+
+        const VkDeviceSize chunk = std::min(bytes, kStagingBytes - m_stagingUsed);
+        const VkDeviceSize srcOffset = m_stagingHalf * kStagingBytes + m_stagingUsed;
+        memcpy(static_cast<uint8_t*>(m_stagingMapped) + srcOffset, src, chunk);
+
+        // Consecutive writes (streamed ranges, chunks of one upload) become one region
+        StagedCopy* last = m_stagedCopies.empty() ? nullptr : &m_stagedCopies.back();
+        if (last && last->buffer == buffer && last->region.srcOffset + last->region.size == srcOffset &&
+            last->region.dstOffset + last->region.size == offset) {
+            last->region.size += chunk;
+        } else {
+            m_stagedCopies.push_back({buffer, {srcOffset, offset, chunk}});
+        }
+        m_stagingUsed += chunk;
+        src += chunk;
+        offset += chunk;
+        bytes -= chunk;
+    }
+}
+
+// Orders the copies after every earlier read and write of the destination
+// buffers and before this command buffer's shaders read them
+void VulkanRenderer::cmdCopyStaged(VkCommandBuffer cmd) {
+    const VkPipelineStageFlags2 shaderStage = m_useRTX ? VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR
+                                                       : VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    VkMemoryBarrier2 barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+    barrier.srcStageMask = shaderStage | VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+    barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    barrier.dstStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+    barrier.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+
+    VkDependencyInfo depInfo{};
+    depInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    depInfo.memoryBarrierCount = 1;
+    depInfo.pMemoryBarriers = &barrier;
+    vkCmdPipelineBarrier2(cmd, &depInfo);
+
+    std::vector<VkBufferCopy> regions;
+    for (size_t i = 0; i < m_stagedCopies.size();) {
+        const VkBuffer buffer = m_stagedCopies[i].buffer;
+        regions.clear();
+        for (; i < m_stagedCopies.size() && m_stagedCopies[i].buffer == buffer; ++i) {
+            regions.push_back(m_stagedCopies[i].region);
+        }
+        vkCmdCopyBuffer(cmd, m_stagingBuffer, buffer, static_cast<uint32_t>(regions.size()), regions.data());
+    }
+    m_stagedCopies.clear();
+
+    barrier.srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+    barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    barrier.dstStageMask = shaderStage;
+    barrier.dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT;
+    vkCmdPipelineBarrier2(cmd, &depInfo);
+}
+
+void VulkanRenderer::recordStagedCopies(VkCommandBuffer cmd) {
+    if (m_stagedCopies.empty()) return;
+    const VkDeviceSize staged = m_stagingUsed;
+    cmdCopyStaged(cmd);
+    // This frame signals the next timeline value once its copies are done
+    m_stagingRetire[m_stagingHalf] = m_frameValue + 1;
+    m_stagingHalf ^= 1u;
+    m_stagingUsed = 0;
+    DBGPRINT << "Staged " << (staged / 1024) << " KB of buffer writes into the frame\n";
+}
+
+void VulkanRenderer::flushStagedCopies() {
+    if (!m_stagedCopies.empty()) {
+        VkCommandBufferAllocateInfo cbai{};
+        cbai.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        cbai.commandPool = m_cmdPool;
+        cbai.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        cbai.commandBufferCount = 1;
+
+        VkCommandBuffer copyCmd = VK_NULL_HANDLE;
+        vkAllocateCommandBuffers(m_device, &cbai, &copyCmd);
+
+        VkCommandBufferBeginInfo cbbi{};
+        cbbi.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        cbbi.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(copyCmd, &cbbi);
+        cmdCopyStaged(copyCmd);
+        vkEndCommandBuffer(copyCmd);
+
+        VkCommandBufferSubmitInfo cmdSubmit{};
+        cmdSubmit.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+        cmdSubmit.commandBuffer = copyCmd;
+
+        VkSubmitInfo2 si{};
+        si.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+        si.commandBufferInfoCount = 1;
+        si.pCommandBufferInfos = &cmdSubmit;
+        vkQueueSubmit2(m_graphicsQueue, 1, &si, VK_NULL_HANDLE);
+        vkQueueWaitIdle(m_graphicsQueue);
+
+        vkFreeCommandBuffers(m_device, m_cmdPool, 1, &copyCmd);
+    }
+    // The queue is idle, so both halves are free again
+    m_stagingRetire[0] = 0;
+    m_stagingRetire[1] = 0;
+    m_stagingUsed = 0;
+}
+
+void VulkanRenderer::dropStagedCopies(VkBuffer buffer) {
+    m_stagedCopies.erase(std::remove_if(m_stagedCopies.begin(), m_stagedCopies.end(),
+                                        [buffer](const StagedCopy& copy) { return copy.buffer == buffer; }),
+                         m_stagedCopies.end());
+}
+
+void VulkanRenderer::destroyStaging() {
+    if (m_stagingMapped) vkUnmapMemory(m_device, m_stagingMemory);
+    if (m_stagingBuffer != VK_NULL_HANDLE) vkDestroyBuffer(m_device, m_stagingBuffer, nullptr);
+    if (m_stagingMemory != VK_NULL_HANDLE) vkFreeMemory(m_device, m_stagingMemory, nullptr);
+    m_stagingBuffer = VK_NULL_HANDLE;
+    m_stagingMemory = VK_NULL_HANDLE;
+    m_stagingMapped = nullptr;
+    m_stagedCopies.clear();
+}
+
+} // namespace vox
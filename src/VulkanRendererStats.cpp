@@ -0,0 +1,166 @@
+#include "vox/VulkanRenderer.h"
+#include "vox/SparseVoxelOctree.h"
+#include "VulkanRendererCommon.h"
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+namespace vox {
+
+namespace {
+constexpr uint32_t kBenchWarmupFrames = 30;   // per order, after the re-upload
+constexpr uint32_t kBenchMeasuredFrames = 240; // one full orbit
+constexpr uint32_t kBenchOrderCount = 3;
+}
+
+bool VulkanRenderer::createTraceStats() {
+    // Counters are host-visible so the CPU can read and clear a slot once its frame retired
+    if (!createMappedBuffer(kStatsSlots * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                            m_traceStatsBuffer, m_traceStatsMemory, m_traceStatsMapped)) {
+        std::cerr << "Failed to create trace stats buffer\n";
+        return false;
+    }
+    std::memset(m_traceStatsMapped, 0, kStatsSlots * sizeof(uint32_t));
+    for (uint32_t i = 0; i < kStatsSlots; ++i) m_slotBenchOrder[i] = -1;
+
+    uint32_t qCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(m_physicalDevice, &qCount, nullptr);
+    std::vector<VkQueueFamilyProperties> qprops(qCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(m_physicalDevice, &qCount, qprops.data());
+    if (m_graphicsQueueFamily >= qCount || qprops[m_graphicsQueueFamily].timestampValidBits == 0) {
+        std::cout << "Graphics queue has no timestamp support; GPU trace time unavailable\n";
+        return true;
+    }
+
+    VkPhysicalDeviceProperties props{};
+    vkGetPhysicalDeviceProperties(m_physicalDevice, &props);
+
+    VkQueryPoolCreateInfo qpci{};
+    qpci.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    qpci.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    qpci.queryCount = 2 * kStatsSlots;
+    if (vkCreateQueryPool(m_device, &qpci, nullptr, &m_traceQueryPool) != VK_SUCCESS) {
+        std::cerr << "vkCreateQueryPool (trace timestamps) failed\n";
+        return true; // timings are optional
+    }
+    m_timestampPeriod = props.limits.timestampPeriod;
+    DBGPRINT << "Trace stats created (timestamp period " << m_timestampPeriod << " ns)\n";
+    return true;
+}
+
+void VulkanRenderer::destroyTraceStats() {
+    if (m_traceQueryPool != VK_NULL_HANDLE) vkDestroyQueryPool(m_device, m_traceQueryPool, nullptr);
+    if (m_traceStatsMapped) vkUnmapMemory(m_device, m_traceStatsMemory);
+    if (m_traceStatsBuffer != VK_NULL_HANDLE) vkDestroyBuffer(m_device, m_traceStatsBuffer, nullptr);
+    if (m_traceStatsMemory != VK_NULL_HANDLE) vkFreeMemory(m_device, m_traceStatsMemory, nullptr);
+    m_traceQueryPool = VK_NULL_HANDLE;
+    m_traceStatsMapped = nullptr;
+    m_traceStatsBuffer = VK_NULL_HANDLE;
+    m_traceStatsMemory = VK_NULL_HANDLE;
+}
+
+// Call only once the slot's last submission has completed
+void VulkanRenderer::collectTraceStats(uint32_t slot) {
+    if (slot >= kStatsSlots) return;
+
+    double gpuMs = -1.0;
+    if (m_slotTimed[slot]) {
+        uint64_t ticks[2] = {};
+        if (vkGetQueryPoolResults(m_device, m_traceQueryPool, 2 * slot, 2, sizeof(ticks), ticks,
+                                  sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+            gpuMs = static_cast<double>(ticks[1] - ticks[0]) * m_timestampPeriod * 1e-6;
+            m_gpuTraceMs = static_cast<float>(gpuMs);
+        }
+        m_slotTimed[slot] = false;
+    }
+
+    uint32_t* counters = static_cast<uint32_t*>(m_traceStatsMapped);
+    const int32_t order = m_slotBenchOrder[slot];
+    if (order >= 0 && order < static_cast<int32_t>(kBenchOrderCount)) {
+        if (gpuMs >= 0.0) m_bench.gpuMs[order] += gpuMs;
+        m_bench.nodeFetches[order] += counters[slot];
+        m_bench.samples[order]++;
+    }
+    m_slotBenchOrder[slot] = -1;
+    counters[slot] = 0;
+}
+
+void VulkanRenderer::applyNodeOrder(NodeOrder order) {
+    vkDeviceWaitIdle(m_device);
+    // Frames already retired still hold stats for the previous layout
+    for (uint32_t slot = 0; slot < kStatsSlots; ++slot) collectTraceStats(slot);
+    m_octree->relayoutNodes(order);
+    uploadOctree();
+}
+
+void VulkanRenderer::startNodeOrderBenchmark() {
+    if (m_bench.active) return;
+    const bool manual = m_manualControl;
+    const bool freeFly = m_freeFlyCameraMode;
+    const float yaw = m_yaw;
+    const float pitch = m_pitch;
+    m_bench = NodeOrderBenchmark{};
+    m_bench.active = true;
+    m_bench.savedManual = manual;
+    m_bench.savedFreeFly = freeFly;
+    m_bench.savedYaw = yaw;
+    m_bench.savedPitch = pitch;
+    std::cout << "Node order benchmark: " << kBenchMeasuredFrames << " frames per order\n";
+    applyNodeOrder(static_cast<NodeOrder>(m_bench.order));
+}
+
+// Once per frame before recording: switch orders when one is done and put the
+// camera on the benchmark orbit. Returns with params2.w set for this frame.
+void VulkanRenderer::advanceNodeOrderBenchmark() {
+    m_shaderParams.params2.w = 0.0f;
+    if (!m_bench.active) return;
+
+    if (m_bench.frame == kBenchWarmupFrames + kBenchMeasuredFrames) {
+        if (m_bench.order + 1 == kBenchOrderCount) {
+            finishNodeOrderBenchmark();
+            return;
+        }
+        m_bench.order++;
+        m_bench.frame = 0;
+        applyNodeOrder(static_cast<NodeOrder>(m_bench.order));
+    }
+
+    // Same orbit for every order; the warmup frames retrace its start
+    const uint32_t step = m_bench.frame < kBenchWarmupFrames ? 0 : m_bench.frame - kBenchWarmupFrames;
+    m_manualControl = true;
+    m_freeFlyCameraMode = false;
+    m_yaw = 6.2831853f * static_cast<float>(step) / static_cast<float>(kBenchMeasuredFrames);
+    m_pitch = 0.4f;
+    if (m_bench.frame >= kBenchWarmupFrames) m_shaderParams.params2.w = 1.0f;
+    m_bench.frame++;
+}
+
+void VulkanRenderer::finishNodeOrderBenchmark() {
+    vkDeviceWaitIdle(m_device);
+    for (uint32_t slot = 0; slot < kStatsSlots; ++slot) collectTraceStats(slot);
+    m_bench.active = false;
+    m_benchHasResults = true;
+
+    const double pixels = static_cast<double>(m_extent.width * m_resolutionScale) *
+                          static_cast<double>(m_extent.height * m_resolutionScale);
+    std::cout << "Node order benchmark results (" << m_octree->getNodes().size() << " nodes):\n";
+    for (uint32_t i = 0; i < kBenchOrderCount; ++i) {
+        const double frames = std::max<uint32_t>(1u, m_bench.samples[i]);
+        const double fetches = static_cast<double>(m_bench.nodeFetches[i]) / frames;
+        std::cout << "  " << std::left << std::setw(15) << nodeOrderName(static_cast<NodeOrder>(i)) << std::right
+                  << std::fixed << std::setprecision(3) << std::setw(9) << (m_bench.gpuMs[i] / frames) << " ms GPU  "
+                  << std::setprecision(2) << std::setw(8) << (fetches * 1e-6) << " M node fetches/frame  "
+                  << std::setw(6) << (pixels > 0.0 ? fetches / pixels : 0.0) << " per pixel\n";
+    }
+    std::cout.unsetf(std::ios::floatfield);
+
+    m_manualControl = m_bench.savedManual;
+    m_freeFlyCameraMode = m_bench.savedFreeFly;
+    m_yaw = m_bench.savedYaw;
+    m_pitch = m_bench.savedPitch;
+    applyNodeOrder(m_nodeOrder);
+}
+
+} // namespace vox
@@ -321,7 +321,7 @@ void VulkanRenderer::recreateSwapchain() {
         VkDescriptorBufferInfo paramsInfo{};
         paramsInfo.buffer = m_shaderParamsBuffer;
         paramsInfo.offset = 0;
-        paramsInfo.range = sizeof(ShaderParamsCPU);
+        paramsInfo.range = sizeof(ShaderParams);
 
         writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
         writes[1].dstSet = m_rtDescSet;
@@ -0,0 +1,583 @@
+#include "vox/VulkanRenderer.h"
+#include "vox/SparseVoxelOctree.h"
+#include "vox/OctreePageCache.h"
+#include "vox/LightGrid.h"
+#include "vox/SceneLoader.h"
+#include "VulkanRendererCommon.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+namespace vox {
+
+// Last write time of a scene file, min() if it cannot be read
+static std::filesystem::file_time_type sceneWriteTime(const std::string& path) {
+    std::error_code ec;
+    const auto time = std::filesystem::last_write_time(path, ec);
+    return ec ? std::filesystem::file_time_type::min() : time;
+}
+
+bool VulkanRenderer::allocateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+                                    VkBuffer& buffer, VkDeviceMemory& memory) {
+    VkBufferCreateInfo bci{};
+    bci.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bci.size = size;
+    bci.usage = usage;
+    bci.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateBuffer(m_device, &bci, nullptr, &buffer) != VK_SUCCESS) {
+        std::cerr << "vkCreateBuffer failed (" << size << " bytes)\n";
+        return false;
+    }
+
+    VkMemoryRequirements memReq{};
+    vkGetBufferMemoryRequirements(m_device, buffer, &memReq);
+
+    VkPhysicalDeviceMemoryProperties memProps{};
+    vkGetPhysicalDeviceMemoryProperties(m_physicalDevice, &memProps);
+    auto findMemoryType = [&](uint32_t typeFilter, VkMemoryPropertyFlags props) -> uint32_t {
+        for (uint32_t i = 0; i < memProps.memoryTypeCount; ++i) {
+            if ((typeFilter & (1u << i)) && (memProps.memoryTypes[i].propertyFlags & props) == props) return i;
+        }
+        return UINT32_MAX;
+    };
+
+    VkMemoryAllocateFlagsInfo allocFlags{};
+    allocFlags.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
+    allocFlags.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT;
+
+    VkMemoryAllocateInfo mai{};
+    mai.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    mai.allocationSize = memReq.size;
+    mai.memoryTypeIndex = findMemoryType(memReq.memoryTypeBits, properties);
+    if (mai.memoryTypeIndex == UINT32_MAX) {
+        std::cerr << "No memory type with properties 0x" << std::hex << properties << std::dec
+                  << " for a " << size << " byte buffer\n";
+        vkDestroyBuffer(m_device, buffer, nullptr);
+        buffer = VK_NULL_HANDLE;
+        return false;
+    }
+    if (usage & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT) mai.pNext = &allocFlags;
+
+    if (vkAllocateMemory(m_device, &mai, nullptr, &memory) != VK_SUCCESS) {
+        std::cerr << "vkAllocateMemory failed (" << memReq.size << " bytes)\n";
+        vkDestroyBuffer(m_device, buffer, nullptr);
+        buffer = VK_NULL_HANDLE;
+        return false;
+    }
+
+    vkBindBufferMemory(m_device, buffer, memory, 0);
+    return true;
+}
+
+bool VulkanRenderer::createMappedBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
+                                        VkBuffer& buffer, VkDeviceMemory& memory, void*& mapped) {
+    if (!allocateBuffer(size, usage, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                        buffer, memory)) {
+        return false;
+    }
+    if (vkMapMemory(m_device, memory, 0, size, 0, &mapped) != VK_SUCCESS) {
+        std::cerr << "vkMapMemory failed\n";
+        vkDestroyBuffer(m_device, buffer, nullptr);
+        vkFreeMemory(m_device, memory, nullptr);
+        buffer = VK_NULL_HANDLE;
+        memory = VK_NULL_HANDLE;
+        mapped = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool VulkanRenderer::createDeviceBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer& buffer,
+                                        VkDeviceMemory& memory) {
+    return allocateBuffer(size, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                          buffer, memory);
+}
+
+void VulkanRenderer::destroyOctreeBuffers() {
+    auto destroy = [&](VkBuffer& buffer, VkDeviceMemory& memory, void*& mapped) {
+        dropStagedCopies(buffer);
+        if (mapped) vkUnmapMemory(m_device, memory);
+        if (buffer != VK_NULL_HANDLE) vkDestroyBuffer(m_device, buffer, nullptr);
+        if (memory != VK_NULL_HANDLE) vkFreeMemory(m_device, memory, nullptr);
+        buffer = VK_NULL_HANDLE;
+        memory = VK_NULL_HANDLE;
+        mapped = nullptr;
+    };
+    destroy(m_octreeNodesBuffer, m_octreeNodesMemory, m_octreeNodesMapped);
+    destroy(m_octreeColorsBuffer, m_octreeColorsMemory, m_octreeColorsMapped);
+    destroy(m_octreeLodBuffer, m_octreeLodMemory, m_octreeLodMapped);
+    destroy(m_octreeFarBuffer, m_octreeFarMemory, m_octreeFarMapped);
+    m_octreeNodesCapacity = 0;
+    m_octreeColorsCapacity = 0;
+    m_octreeFarCapacity = 0;
+    m_octreeFarCount = 0;
+}
+
+// Grow the node/LOD, color and far buffers to at least these sizes. New
+// buffers start out empty and are bound right away.
+bool VulkanRenderer::reserveOctreeBuffers(VkDeviceSize nodeCapacity, VkDeviceSize colorCapacity,
+                                          VkDeviceSize farCapacity) {
+    if (nodeCapacity <= m_octreeNodesCapacity && colorCapacity <= m_octreeColorsCapacity &&
+        farCapacity <= m_octreeFarCapacity) {
+        return true;
+    }
+    destroyOctreeBuffers();
+    const VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    const VkBufferUsageFlags nodeUsage = usage | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+    // Device-local where that is faster, host-visible if it does not fit
+    auto create = [&](VkDeviceSize size, VkBufferUsageFlags bufferUsage, VkBuffer& buffer, VkDeviceMemory& memory,
+                      void*& mapped) {
+        if (m_deviceLocalBuffers) {
+            if (createDeviceBuffer(size, bufferUsage, buffer, memory)) return true;
+            std::cerr << "Falling back to host-visible memory for " << (size >> 20) << " MB of octree data\n";
+        }
+        return createMappedBuffer(size, bufferUsage, buffer, memory, mapped);
+    };
+    if (!create(nodeCapacity, nodeUsage, m_octreeNodesBuffer, m_octreeNodesMemory, m_octreeNodesMapped) ||
+        !create(colorCapacity, usage, m_octreeColorsBuffer, m_octreeColorsMemory, m_octreeColorsMapped) ||
+        !create(nodeCapacity, nodeUsage, m_octreeLodBuffer, m_octreeLodMemory, m_octreeLodMapped) ||
+        !create(farCapacity, usage, m_octreeFarBuffer, m_octreeFarMemory, m_octreeFarMapped)) {
+        std::cerr << "Failed to create octree GPU buffers\n";
+        return false;
+    }
+    m_octreeNodesCapacity = nodeCapacity;
+    m_octreeColorsCapacity = colorCapacity;
+    m_octreeFarCapacity = farCapacity;
+    if (m_rtDescSet != VK_NULL_HANDLE) writeOctreeDescriptors();
+
+    // Past the binding range the shaders read node and LOD words by address
+    m_shaderParams.nodeAddress = glm::uvec4(0u);
+    if (nodeCapacity > m_maxStorageBufferRange) {
+        VkBufferDeviceAddressInfo bdai{};
+        bdai.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+        bdai.buffer = m_octreeNodesBuffer;
+        const VkDeviceAddress nodesAddress = vkGetBufferDeviceAddressKHR(m_device, &bdai);
+        bdai.buffer = m_octreeLodBuffer;
+        const VkDeviceAddress lodAddress = vkGetBufferDeviceAddressKHR(m_device, &bdai);
+        m_shaderParams.nodeAddress = glm::uvec4(static_cast<uint32_t>(nodesAddress), static_cast<uint32_t>(nodesAddress >> 32),
+                                                static_cast<uint32_t>(lodAddress), static_cast<uint32_t>(lodAddress >> 32));
+        std::cout << "Octree nodes exceed maxStorageBufferRange (" << (m_maxStorageBufferRange >> 20)
+                  << " MB): reading them by device address\n";
+    }
+    return true;
+}
+
+bool VulkanRenderer::uploadOctree() {
+    // Buffers may be in use by frames still in flight
+    if (m_octreeNodesBuffer != VK_NULL_HANDLE) vkDeviceWaitIdle(m_device);
+
+    const auto& nodes = m_octree->getNodes();
+    const auto& colors = m_octree->getColors();
+    const auto& farPointers = m_octree->getFarPointers();
+    if (m_maxStorageBufferRange == 0) {
+        VkPhysicalDeviceProperties props{};
+        vkGetPhysicalDeviceProperties(m_physicalDevice, &props);
+        m_maxStorageBufferRange = props.limits.maxStorageBufferRange;
+    }
+
+    // Page slots resolve through the dense far table
+    if (m_pageCache) m_nodeFormat = NodeFormat::Dense;
+
+    // Node buffer: upload the sparse child-mask encoding unless dense is requested.
+    // LOD colors are indexed like the uploaded node words.
+    if (m_octree->getLodColors().size() != nodes.size()) {
+        m_octree->computeLodColors();
+    }
+    std::vector<uint32_t> sparseNodes;
+    std::vector<uint32_t> sparseLod;
+    const void* nodeData = nodes.data();
+    const void* lodData = m_octree->getLodColors().data();
+    VkDeviceSize nodeSize = nodes.size() * sizeof(uint32_t);
+    if (m_nodeFormat == NodeFormat::SparseMask) {
+        // A .svo cache hit hands over the encoding straight from the mapping
+        SparseNodeSpan cached = m_octree->getCachedSparseNodes();
+        if (cached.count) {
+            nodeData = cached.nodes;
+            lodData = cached.lodColors;
+            nodeSize = cached.count * sizeof(uint32_t);
+        } else {
+            sparseNodes = m_octree->encodeSparseNodes(&sparseLod);
+            nodeData = sparseNodes.data();
+            lodData = sparseLod.data();
+            nodeSize = sparseNodes.size() * sizeof(uint32_t);
+        }
+        if (nodeSize == 0) {
+            std::cout << "Octree too large for sparse pointers: using the dense format\n";
+            m_nodeFormat = NodeFormat::Dense;
+            nodeData = nodes.data();
+            lodData = m_octree->getLodColors().data();
+            nodeSize = nodes.size() * sizeof(uint32_t);
+        } else {
+            DBGPRINT << "Sparse node encoding: " << nodes.size() << " -> " << nodeSize / sizeof(uint32_t)
+                     << " words (" << (nodes.size() * sizeof(uint32_t) / 1024) << " KB -> "
+                     << (nodeSize / 1024) << " KB)\n";
+        }
+    }
+    if (m_nodeFormat == NodeFormat::Bricks) {
+        sparseNodes = m_octree->encodeBrickNodes(&sparseLod);
+        if (sparseNodes.empty()) {
+            std::cout << "No brick encoding for this octree: using the dense format\n";
+            m_nodeFormat = NodeFormat::Dense;
+        } else {
+            nodeData = sparseNodes.data();
+            lodData = sparseLod.data();
+            nodeSize = sparseNodes.size() * sizeof(uint32_t);
+            DBGPRINT << "Brick node encoding: " << nodes.size() << " -> " << sparseNodes.size() << " words (brick level "
+                     << m_octree->getBrickLevel() << ")\n";
+        }
+    }
+    const VkDeviceSize colorSize = colors.size() * sizeof(uint32_t);
+    const VkDeviceSize farSize = farPointers.size() * sizeof(uint32_t);
+
+    // The full copy below covers every pending edit and ends a scene stream
+    m_octree->takeDirtyNodeRanges();
+    m_octree->takeDirtyColorsBegin();
+    m_octree->takeDirtyFarBegin();
+    m_streamNodeCount = 0;
+
+    // Dense nodes are edited in place, so leave room for appended blocks. A
+    // paged top tree is read-only; the page slot pool follows its nodes.
+    const VkDeviceSize poolSize = static_cast<VkDeviceSize>(m_pageSlotCount) * m_pageSlotNodes * sizeof(uint32_t);
+    VkDeviceSize nodeCapacity = std::max<VkDeviceSize>(nodeSize + poolSize, 256);
+    VkDeviceSize colorCapacity = std::max<VkDeviceSize>(colorSize, 256);
+    VkDeviceSize farCapacity = std::max<VkDeviceSize>(farSize, 256);
+    if (m_nodeFormat == NodeFormat::Dense && !m_pageCache) {
+        nodeCapacity = std::max<VkDeviceSize>(nodeSize + nodeSize / 2, 64 * 1024);
+        colorCapacity = std::max<VkDeviceSize>(colorSize * 2, 4 * 1024);
+        farCapacity = std::max<VkDeviceSize>(farSize * 2, 256);
+    }
+
+    if (!reserveOctreeBuffers(nodeCapacity, colorCapacity, farCapacity)) return false;
+
+    writeBuffer(m_octreeNodesBuffer, m_octreeNodesMapped, 0, nodeData, nodeSize);
+    writeBuffer(m_octreeLodBuffer, m_octreeLodMapped, 0, lodData, nodeSize);
+    writeBuffer(m_octreeColorsBuffer, m_octreeColorsMapped, 0, colors.data(), colorSize);
+    if (farSize) writeBuffer(m_octreeFarBuffer, m_octreeFarMapped, 0, farPointers.data(), farSize);
+    m_octreeFarCount = farPointers.size();
+    m_octreeNodesBytes = nodeSize;
+    m_shaderParams.params2.y = static_cast<float>(static_cast<uint32_t>(m_nodeFormat));
+    if (m_pageCache) resetPageSlots(); // the page table was just rewritten as all missing
+    DBGPRINT << "Octree GPU buffers uploaded (" << (nodeSize / 1024) << " KB nodes, capacity "
+             << (m_octreeNodesCapacity / 1024) << " KB)\n";
+    return true;
+}
+
+void VulkanRenderer::writeOctreeDescriptors() {
+    VkDescriptorBufferInfo infos[4]{};
+    infos[0].buffer = m_octreeNodesBuffer;
+    infos[1].buffer = m_octreeColorsBuffer;
+    infos[2].buffer = m_octreeLodBuffer;
+    infos[3].buffer = m_octreeFarBuffer;
+    const uint32_t bindings[4] = { 1, 2, 7, 9 };
+    const bool clampNodes = m_octreeNodesCapacity > m_maxStorageBufferRange; // read by address instead
+
+    VkWriteDescriptorSet writes[4]{};
+    for (uint32_t i = 0; i < 4; ++i) {
+        infos[i].offset = 0;
+        infos[i].range = (clampNodes && (i == 0 || i == 2)) ? m_maxStorageBufferRange : VK_WHOLE_SIZE;
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = m_rtDescSet;
+        writes[i].dstBinding = bindings[i];
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[i].pBufferInfo = &infos[i];
+    }
+    vkUpdateDescriptorSets(m_device, 4, writes, 0, nullptr);
+}
+
+void VulkanRenderer::syncOctreeEdits() {
+    // Edits made while a scene streams in stay queued until it is complete
+    if (m_streamNodeCount != 0) return;
+
+    // Edits that add or remove emitters replace the light buffers, which
+    // frames in flight may still read
+    if (m_octree->takeEmissiveDirty()) {
+        vkDeviceWaitIdle(m_device);
+        uploadLights();
+    }
+
+    const bool nodesDirty = m_octree->hasDirtyNodes();
+    const size_t colorsBegin = m_octree->takeDirtyColorsBegin();
+    const auto& colors = m_octree->getColors();
+    if (!nodesDirty && colorsBegin >= colors.size()) return;
+
+    // Edits patch the dense array in place; the sparse encoding would need a
+    // full re-encode per edit, so editable scenes switch to dense once
+    if (m_nodeFormat != NodeFormat::Dense) {
+        std::cout << "Octree edited: switching GPU nodes to the dense format\n";
+        m_nodeFormat = NodeFormat::Dense;
+        uploadOctree();
+        return;
+    }
+
+    const auto& nodes = m_octree->getNodes();
+    const auto& lodColors = m_octree->getLodColors();
+    const auto& farPointers = m_octree->getFarPointers();
+    const VkDeviceSize nodeSize = nodes.size() * sizeof(uint32_t);
+    if (nodeSize > m_octreeNodesCapacity || colors.size() * sizeof(uint32_t) > m_octreeColorsCapacity ||
+        farPointers.size() * sizeof(uint32_t) > m_octreeFarCapacity || lodColors.size() != nodes.size()) {
+        uploadOctree(); // grows the buffers and rewrites the descriptors
+        return;
+    }
+
+    // No in-flight dispatch may read a half-patched tree. Staged writes are
+    // ordered behind it on the GPU, so only mapped buffers need the wait.
+    if (m_octreeNodesMapped || m_octreeLodMapped || m_octreeColorsMapped || m_octreeFarMapped) waitForLastFrame();
+
+    VkDeviceSize patched = 0;
+    bool wholeTree = false;
+    for (const DirtyRange& range : m_octree->takeDirtyNodeRanges()) {
+        wholeTree |= range.begin == 0 && range.end >= nodes.size();
+        const size_t offset = range.begin * sizeof(uint32_t);
+        const size_t bytes = (range.end - range.begin) * sizeof(uint32_t);
+        writeBuffer(m_octreeNodesBuffer, m_octreeNodesMapped, offset, nodes.data() + range.begin, bytes);
+        writeBuffer(m_octreeLodBuffer, m_octreeLodMapped, offset, lodColors.data() + range.begin, bytes);
+        patched += bytes;
+    }
+    if (colorsBegin < colors.size()) {
+        writeBuffer(m_octreeColorsBuffer, m_octreeColorsMapped, colorsBegin * sizeof(uint32_t),
+                    colors.data() + colorsBegin, (colors.size() - colorsBegin) * sizeof(uint32_t));
+    }
+    // Edits append far slots or rewrite reused ones; passes that rewrite the
+    // whole tree rebuild the table
+    const size_t farBegin = wholeTree ? 0 : std::min(m_octree->takeDirtyFarBegin(), m_octreeFarCount);
+    if (farPointers.size() > farBegin) {
+        writeBuffer(m_octreeFarBuffer, m_octreeFarMapped, farBegin * sizeof(uint32_t),
+                    farPointers.data() + farBegin, (farPointers.size() - farBegin) * sizeof(uint32_t));
+    }
+    m_octreeFarCount = farPointers.size();
+    m_octreeNodesBytes = nodeSize;
+    DBGPRINT << "Patched " << (patched / 1024) << " KB of octree nodes\n";
+}
+
+bool VulkanRenderer::loadScene(const std::string& voxPath, bool fallbackToTestScene) {
+    SceneLoadRequest request;
+    request.voxPath = voxPath;
+    const size_t ext = voxPath.rfind(".vox");
+    if (ext != std::string::npos && ext + 4 == voxPath.size()) request.svoPath = voxPath.substr(0, ext) + ".svo";
+    request.nodeOrder = m_nodeOrder;
+    request.cacheFormat = m_nodeFormat;
+    request.mergeIdenticalSubtrees = m_mergeIdenticalSubtrees;
+    request.fallbackToTestScene = fallbackToTestScene;
+    request.solidFill = m_solidFillMeshes;
+    const auto writeTime = sceneWriteTime(voxPath);
+    if (!m_sceneLoader->start(request)) {
+        std::cerr << "A scene is still loading; " << voxPath << " not started\n";
+        return false;
+    }
+    m_requestedSceneTime = writeTime;
+    std::cout << "Loading " << voxPath << " in the background\n";
+    return true;
+}
+
+// Once per frame before the edit sync: apply or swap in a finished load,
+// keep streaming its nodes and watch the scene file
+void VulkanRenderer::pollSceneLoader() {
+    if (m_sceneLoader) {
+        SceneLoadRequest request;
+        std::unique_ptr<SparseVoxelOctree> tree = m_sceneLoader->takeResult(&request);
+        if (tree && request.diffSource && applySceneReload(*tree)) tree.reset();
+        if (tree) {
+            if (!request.diffSource) {
+                m_loadedScenePath = request.voxPath;
+                m_loadedSceneTime = m_requestedSceneTime;
+            }
+            m_octree = std::move(tree);
+            if (!beginSceneStream()) std::cerr << "Failed to upload the loaded scene\n";
+        }
+        checkSceneReload();
+    }
+    if (m_streamNodeCount != 0) streamOctreeNodes();
+}
+
+void VulkanRenderer::checkSceneReload() {
+    if (!m_hotReload || m_loadedScenePath.empty() || m_sceneLoader->busy()) return;
+    const auto now = std::chrono::high_resolution_clock::now();
+    if (now < m_nextReloadCheck) return;
+    m_nextReloadCheck = now + std::chrono::milliseconds(250);
+
+    const auto writeTime = sceneWriteTime(m_loadedScenePath);
+    if (writeTime == m_loadedSceneTime || writeTime == std::filesystem::file_time_type::min()) return;
+    // Taken now, so a save that fails to import waits for the next one
+    m_loadedSceneTime = writeTime;
+
+    SceneLoadRequest request;
+    request.voxPath = m_loadedScenePath;
+    request.depth = m_octree->getDepth();
+    request.mergeIdenticalSubtrees = false;
+    request.diffSource = true;
+    request.solidFill = m_solidFillMeshes;
+    if (m_sceneLoader->start(request)) std::cout << m_loadedScenePath << " changed, reloading\n";
+}
+
+// A re-imported scene is edited into the current tree, and the edit sync
+// patches the touched pages. False if it has to be swapped in whole instead:
+// while streaming, on a paged octree or when the grid size changed.
+bool VulkanRenderer::applySceneReload(const SparseVoxelOctree& tree) {
+    if (m_streamNodeCount != 0 || m_octree->isPagedTop() || tree.getDepth() != m_octree->getDepth()) return false;
+    const auto start = std::chrono::high_resolution_clock::now();
+    size_t regions = 0;
+    if (!m_octree->applyDiff(tree, &regions)) return false;
+    syncOctreeEdits(); // lights too, if the emissive list changed
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    std::cout << "Hot reload: " << regions << " regions changed, applied in " << ms << " ms\n";
+    return true;
+}
+
+// A tree finished by the scene loader replaces the current one between
+// frames: every binding switches over at once, with the node words still to
+// come hidden behind the streamed-node limit (CameraParams::streamedNodes)
+bool VulkanRenderer::beginSceneStream() {
+    // Frames in flight still read the old scene's buffers
+    vkDeviceWaitIdle(m_device);
+    m_streamNodeCount = 0;
+
+    // A loaded scene replaces a paged octree as well
+    if (m_pageCache) {
+        m_pageCache.reset();
+        m_pageSlotCount = 0;
+        m_pageSlotNodes = 0;
+        m_slotPage.clear();
+        m_pageSlot.clear();
+        m_pagesResident = 0;
+        m_shaderParams.paging = glm::uvec4(0u);
+    }
+    m_octreeStats.reset();
+    m_gridSize = 1u << m_octree->getDepth();
+
+    const auto& nodes = m_octree->getNodes();
+    const auto& colors = m_octree->getColors();
+    const auto& farPointers = m_octree->getFarPointers();
+    if (m_octree->getLodColors().size() != nodes.size()) {
+        m_octree->computeLodColors();
+    }
+    m_octree->takeDirtyNodeRanges();
+    m_octree->takeDirtyColorsBegin();
+    m_octree->takeDirtyFarBegin();
+
+    // Streamed as dense words, sized like uploadOctree() sizes dense trees
+    const VkDeviceSize nodeSize = nodes.size() * sizeof(uint32_t);
+    const VkDeviceSize colorSize = colors.size() * sizeof(uint32_t);
+    const VkDeviceSize farSize = farPointers.size() * sizeof(uint32_t);
+    if (!reserveOctreeBuffers(std::max<VkDeviceSize>(nodeSize + nodeSize / 2, 64 * 1024),
+                              std::max<VkDeviceSize>(colorSize * 2, 4 * 1024),
+                              std::max<VkDeviceSize>(farSize * 2, 256))) {
+        return false;
+    }
+    writeBuffer(m_octreeColorsBuffer, m_octreeColorsMapped, 0, colors.data(), colorSize);
+    if (farSize) writeBuffer(m_octreeFarBuffer, m_octreeFarMapped, 0, farPointers.data(), farSize);
+    m_octreeFarCount = farPointers.size();
+    m_shaderParams.params2.y = static_cast<float>(static_cast<uint32_t>(NodeFormat::Dense));
+    if (!uploadLights()) return false;
+
+    m_streamedNodes = 0;
+    m_streamNodeCount = nodes.size();
+    std::cout << "Scene swapped in: streaming " << (nodeSize >> 10) << " KB of nodes, "
+              << m_octree->getEmissiveVoxels().size() << " lights\n";
+    return true;
+}
+
+// Once per frame while streaming: copy the next node/LOD range and raise the
+// limit. Each frame pushes its own limit, recorded after its staged copies,
+// and frames still in flight keep their older one, so nothing has to wait.
+void VulkanRenderer::streamOctreeNodes() {
+    const auto& nodes = m_octree->getNodes();
+    const auto& lodColors = m_octree->getLodColors();
+    const size_t begin = m_streamedNodes;
+    const size_t end = std::min<size_t>(m_streamNodeCount, begin + kStreamBytesPerFrame / sizeof(uint32_t));
+    const size_t bytes = (end - begin) * sizeof(uint32_t);
+    writeBuffer(m_octreeNodesBuffer, m_octreeNodesMapped, begin * sizeof(uint32_t), nodes.data() + begin, bytes);
+    writeBuffer(m_octreeLodBuffer, m_octreeLodMapped, begin * sizeof(uint32_t), lodColors.data() + begin, bytes);
+    m_streamedNodes = end;
+    m_octreeNodesBytes = end * sizeof(uint32_t);
+    if (end < m_streamNodeCount) return;
+
+    m_streamNodeCount = 0;
+    std::cout << "Scene streamed in (" << (m_octreeNodesBytes >> 10) << " KB of nodes)\n";
+    // Other encodings are built from the complete tree in one go
+    if (m_nodeFormat != NodeFormat::Dense) {
+        uploadOctree();
+    } else {
+        m_shaderParams.params2.y = static_cast<float>(static_cast<uint32_t>(m_nodeFormat));
+    }
+}
+
+// Emissive list (binding 4: count, then uvec4(position, intensity)) and the
+// light grid over it (binding 6), rebuilt whenever the scene changes
+bool VulkanRenderer::uploadLights() {
+    m_octree->takeEmissiveDirty();
+    auto replace = [&](VkBuffer& buffer, VkDeviceMemory& memory, const void* data, VkDeviceSize size) {
+        dropStagedCopies(buffer);
+        if (buffer != VK_NULL_HANDLE) vkDestroyBuffer(m_device, buffer, nullptr);
+        if (memory != VK_NULL_HANDLE) vkFreeMemory(m_device, memory, nullptr);
+        buffer = VK_NULL_HANDLE;
+        memory = VK_NULL_HANDLE;
+        void* mapped = nullptr;
+        const VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+        if (!(m_deviceLocalBuffers && createDeviceBuffer(size, usage, buffer, memory)) &&
+            !createMappedBuffer(size, usage, buffer, memory, mapped)) {
+            return false;
+        }
+        writeBuffer(buffer, mapped, 0, data, size);
+        if (mapped) vkUnmapMemory(m_device, memory);
+        return true;
+    };
+
+    const auto& emissiveVoxels = m_octree->getEmissiveVoxels();
+    std::vector<glm::uvec4> emissiveData;
+    emissiveData.reserve(emissiveVoxels.size() + 1);
+    emissiveData.push_back(glm::uvec4(static_cast<uint32_t>(emissiveVoxels.size()), 0u, 0u, 0u));
+    for (const auto& pos : emissiveVoxels) {
+        emissiveData.push_back(glm::uvec4(pos, 255u));
+    }
+
+    std::vector<uint32_t> gridData = buildLightGrid(emissiveVoxels, m_gridSize);
+    std::cout << "Spatial grid: " << gridData[0] << "^3 cells, " << gridData.size() << " uints, "
+              << emissiveVoxels.size() << " lights\n";
+
+    if (!replace(m_emissiveBuffer, m_emissiveMemory, emissiveData.data(), emissiveData.size() * sizeof(glm::uvec4)) ||
+        !replace(m_spatialGridBuffer, m_spatialGridMemory, gridData.data(), gridData.size() * sizeof(uint32_t))) {
+        std::cerr << "Failed to create light buffers\n";
+        return false;
+    }
+    if (m_rtDescSet == VK_NULL_HANDLE) return true;
+
+    VkDescriptorBufferInfo infos[2]{};
+    infos[0].buffer = m_emissiveBuffer;
+    infos[1].buffer = m_spatialGridBuffer;
+    const uint32_t bindings[2] = { 4, 6 };
+    VkWriteDescriptorSet writes[2]{};
+    for (uint32_t i = 0; i < 2; ++i) {
+        infos[i].offset = 0;
+        infos[i].range = VK_WHOLE_SIZE;
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = m_rtDescSet;
+        writes[i].dstBinding = bindings[i];
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[i].pBufferInfo = &infos[i];
+    }
+    vkUpdateDescriptorSets(m_device, 2, writes, 0, nullptr);
+    return true;
+}
+
+void VulkanRenderer::waitForLastFrame() {
+    waitForFrame(m_frameValue);
+}
+
+void VulkanRenderer::waitForFrame(uint64_t frameValue) {
+    if (m_frameTimeline != VK_NULL_HANDLE && frameValue > 0) {
+        VkSemaphoreWaitInfo waitInfo{};
+        waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores = &m_frameTimeline;
+        waitInfo.pValues = &frameValue;
+        vkWaitSemaphores(m_device, &waitInfo, UINT64_MAX);
+    } else {
+        vkDeviceWaitIdle(m_device);
+    }
+}
+
+} // namespace vox
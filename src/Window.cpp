@@ -41,6 +41,10 @@ void Window::pollEvents(bool &running) {
         ImGui_ImplSDL2_ProcessEvent(&ev);
         if (ev.type == SDL_QUIT) running = false;
         if (ev.type == SDL_KEYDOWN && ev.key.keysym.sym == SDLK_ESCAPE) running = false;
+        if (ev.type == SDL_DROPFILE && ev.drop.file) {
+            m_droppedFile = ev.drop.file;
+            SDL_free(ev.drop.file);
+        }
 
         if (ev.type == SDL_KEYDOWN) {
             if (ev.key.keysym.sym == SDLK_g) m_gridTogglePressed = true;
@@ -117,6 +121,13 @@ bool Window::consumeDebugLightingToggle() { bool v = m_debugLightingPressed; m_d
 bool Window::consumeCameraToggle() { bool v = m_cameraTogglePressed; m_cameraTogglePressed = false; return v; }
 bool Window::consumeGUIToggle() { bool v = m_guiTogglePressed; m_guiTogglePressed = false; return v; }
 
+bool Window::consumeDroppedFile(std::string &outPath) {
+    if (m_droppedFile.empty()) return false;
+    outPath.swap(m_droppedFile);
+    m_droppedFile.clear();
+    return true;
+}
+
 bool Window::consumeMouseDrag(int &outDx, int &outDy) {
     outDx = m_mouseDx;
     outDy = m_mouseDy;
@@ -1,3 +1,5 @@
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <vector>
 
@@ -7,9 +9,20 @@
 #include <vulkan/vulkan.h>
 
 #include "vox/Application.h"
+#include "vox/Headless.h"
+
+int main(int argc, char** argv) {
+    // Headless commands (Headless.h) need no window or GPU
+    int headless = vox::runHeadlessCommand(argc, argv);
+    if (headless >= 0) return headless;
+
+    // GPU frames against the CPU reference: vox --compare-gpu scene [maxDiffPercent]
+    if (argc >= 3 && std::strcmp(argv[1], "--compare-gpu") == 0) {
+        vox::Application app;
+        return app.compareWithCpuReference(argv[2], argc >= 4 ? std::strtof(argv[3], nullptr) : 2.0f);
+    }
 
-int main() {
     vox::Application app;
     if (!app.init()) return 1;
     return app.run();
-}
\ No newline at end of file
+}
@@ -0,0 +1,10 @@
+#include "vox/Headless.h"
+
+// vox-cpu: the headless commands of vox, built without SDL2 or Vulkan so
+// they run on machines with neither
+int main(int argc, char** argv) {
+    int result = vox::runHeadlessCommand(argc, argv);
+    if (result >= 0) return result;
+    vox::printHeadlessUsage();
+    return 1;
+}
@@ -0,0 +1,118 @@
+// Hot reload: applyDiff() turns a tree into a re-imported one in place
+#include "TestSupport.h"
+#include <random>
+#include <vector>
+
+using namespace vox;
+
+namespace {
+
+constexpr uint32_t kDepth = 7;
+
+std::vector<Voxel> baseVoxels() {
+    std::mt19937 rng(13);
+    std::uniform_int_distribution<uint32_t> coord(0, (1u << kDepth) - 1), color(0, 3);
+    const uint32_t colors[] = {0x00AA0000u, 0x0000AA00u, 0x000000AAu, 0x00AAAA00u};
+    std::vector<Voxel> voxels;
+    for (int i = 0; i < 20000; ++i) voxels.push_back({glm::uvec3(coord(rng), coord(rng), coord(rng)), colors[color(rng)]});
+    return voxels;
+}
+
+// The same scene after a small edit in the source file: a few voxels
+// recolored, a corner removed and a new emissive block
+SparseVoxelOctree editedScene() {
+    std::vector<Voxel> voxels = baseVoxels();
+    for (size_t i = 0; i < voxels.size(); i += 500) voxels[i].color = 0x00FFFFFFu;
+    std::vector<Voxel> kept;
+    for (const Voxel& v : voxels) {
+        if (v.pos.x >= 16 || v.pos.y >= 16 || v.pos.z >= 16) kept.push_back(v);
+    }
+    SparseVoxelOctree tree(kDepth);
+    tree.buildFromVoxels(kept);
+    tree.fillBox(glm::uvec3(100, 100, 100), glm::uvec3(107, 103, 101), 0xFF00FFFFu);
+    return tree;
+}
+
+size_t dirtyNodes(SparseVoxelOctree& tree) {
+    size_t count = 0;
+    for (const DirtyRange& range : tree.takeDirtyNodeRanges()) count += range.end - range.begin;
+    return count;
+}
+
+void testDiffReachesTarget() {
+    SparseVoxelOctree tree(kDepth);
+    tree.buildFromVoxels(baseVoxels());
+    tree.computeLodColors();
+    tree.takeDirtyNodeRanges();
+    const SparseVoxelOctree target = editedScene();
+
+    size_t regions = 0;
+    CHECK(tree.applyDiff(target, &regions));
+    CHECK(regions > 0);
+    CHECK(voxtest::sameVoxels(tree, target));
+    CHECK(tree.getEmissiveVoxels() == target.getEmissiveVoxels());
+    CHECK(tree.takeEmissiveDirty());
+
+    // Only the edited regions were touched
+    const size_t dirty = dirtyNodes(tree);
+    CHECK(dirty > 0 && dirty < tree.getNodes().size() / 2);
+
+    // A second pass finds nothing left to change
+    CHECK(tree.applyDiff(target, &regions));
+    CHECK(regions == 0);
+    CHECK(!tree.hasDirtyNodes());
+}
+
+void testUnchangedSceneTouchesNothing() {
+    SparseVoxelOctree tree(kDepth), same(kDepth);
+    tree.buildFromVoxels(baseVoxels());
+    same.buildFromVoxels(baseVoxels());
+    tree.takeDirtyNodeRanges();
+    size_t regions = 1;
+    CHECK(tree.applyDiff(same, &regions));
+    CHECK(regions == 0);
+    CHECK(!tree.hasDirtyNodes());
+}
+
+void testCollapsedAndMergedTrees() {
+    // Collapsed nodes on one side and shared blocks on the other still diff
+    // down to the same voxels
+    SparseVoxelOctree tree(kDepth);
+    tree.buildFromVoxels(baseVoxels());
+    tree.fillBox(glm::uvec3(32u), glm::uvec3(63u), 0x00AA0000u);
+    tree.markHomogeneousNodes();
+    tree.mergeIdenticalSubtrees();
+    tree.compactNodes();
+    SparseVoxelOctree target = editedScene();
+    target.markHomogeneousNodes();
+    target.compactNodes();
+
+    CHECK(tree.applyDiff(target));
+    CHECK(voxtest::sameVoxels(tree, target));
+}
+
+void testDepthMismatchIsRefused() {
+    SparseVoxelOctree tree(kDepth), deeper(kDepth + 1);
+    tree.buildFromVoxels(baseVoxels());
+    deeper.fillBox(glm::uvec3(0u), glm::uvec3(9u), 0x00123456u);
+    const std::vector<OctreeNode> before = tree.getNodes();
+    size_t regions = 1;
+    CHECK(!tree.applyDiff(deeper, &regions));
+    CHECK(regions == 0);
+    CHECK(tree.getNodes().size() == before.size());
+    bool unchanged = true;
+    for (size_t i = 0; i < before.size() && i < tree.getNodes().size(); ++i) {
+        unchanged = unchanged && before[i].data == tree.getNodes()[i].data;
+    }
+    CHECK(unchanged);
+}
+
+} // namespace
+
+int main() {
+    testDiffReachesTarget();
+    testUnchangedSceneTouchesNothing();
+    testCollapsedAndMergedTrees();
+    testDepthMismatchIsRefused();
+    return voxtest::finish("ApplyDiffTest");
+}
@@ -0,0 +1,96 @@
+// Bulk Morton build (buildFromVoxels) against the same voxels set one by one
+#include "TestSupport.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace vox;
+
+namespace {
+
+constexpr uint32_t kDepth = 6;
+const uint32_t kColors[] = {0x00FF0000u, 0x0000FF00u, 0x000000FFu, 0x00FFFF00u, 0x00808080u, 0x00102030u};
+
+// Clustered, so cells repeat (later voxels must win) and blocks fill up
+std::vector<Voxel> randomVoxels(uint32_t seed, size_t count) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<uint32_t> coord(0, (1u << kDepth) - 1), near(0, 7), color(0, 5);
+    std::vector<Voxel> voxels;
+    glm::uvec3 center(0u);
+    for (size_t i = 0; i < count; ++i) {
+        if (i % 64 == 0) center = glm::uvec3(coord(rng), coord(rng), coord(rng));
+        const glm::uvec3 pos = glm::min(center + glm::uvec3(near(rng), near(rng), near(rng)), glm::uvec3((1u << kDepth) - 1));
+        voxels.push_back({pos, kColors[color(rng)]});
+    }
+    return voxels;
+}
+
+bool sameNodes(const SparseVoxelOctree& a, const SparseVoxelOctree& b) {
+    if (a.getNodes().size() != b.getNodes().size()) return false;
+    for (size_t i = 0; i < a.getNodes().size(); ++i) {
+        if (a.getNodes()[i].data != b.getNodes()[i].data) return false;
+    }
+    return true;
+}
+
+void testMatchesSetVoxel() {
+    for (uint32_t seed = 1; seed <= 3; ++seed) {
+        const std::vector<Voxel> voxels = randomVoxels(seed, 4000);
+        SparseVoxelOctree edited(kDepth), built(kDepth);
+        for (const Voxel& v : voxels) edited.setVoxel(v.pos, v.color);
+        built.buildFromVoxels(voxels);
+        CHECK(voxtest::sameVoxels(edited, built));
+    }
+}
+
+void testPaletteIndices() {
+    const std::vector<Voxel> voxels = randomVoxels(7, 3000);
+    const size_t paletteSize = 4; // indices 4 and 5 are skipped
+    std::vector<Voxel> indexed;
+    SparseVoxelOctree edited(kDepth), built(kDepth);
+    for (const Voxel& v : voxels) {
+        const uint32_t index = static_cast<uint32_t>(std::find(std::begin(kColors), std::end(kColors), v.color) - kColors);
+        indexed.push_back({v.pos, index});
+        if (index < paletteSize) edited.setVoxel(v.pos, v.color);
+    }
+    built.buildFromVoxels(indexed.data(), indexed.size(), kColors, paletteSize);
+    CHECK(voxtest::sameVoxels(edited, built));
+    CHECK(built.getColors().size() <= paletteSize);
+}
+
+void testThreadedBuildIsIdentical() {
+    const std::vector<Voxel> voxels = randomVoxels(11, 6000);
+    SparseVoxelOctree serial(kDepth), threaded(kDepth);
+    serial.setBuildThreads(1);
+    serial.buildFromVoxels(voxels);
+    threaded.setBuildThreads(4, 2);
+    threaded.buildFromVoxels(voxels);
+    CHECK(sameNodes(serial, threaded));
+    CHECK(serial.getColors() == threaded.getColors());
+}
+
+void testEmptyAndFullBuilds() {
+    SparseVoxelOctree empty(kDepth);
+    empty.buildFromVoxels(std::vector<Voxel>{});
+    CHECK(empty.getNodes().size() == 1 && empty.getNodes()[0].data == 0u);
+
+    // Every leaf cell, against one fillBox over the grid
+    std::vector<Voxel> all;
+    for (uint32_t z = 0; z < (1u << kDepth); z += 2)
+        for (uint32_t y = 0; y < (1u << kDepth); y += 2)
+            for (uint32_t x = 0; x < (1u << kDepth); x += 2) all.push_back({glm::uvec3(x, y, z), kColors[0]});
+    SparseVoxelOctree full(kDepth), filled(kDepth);
+    full.buildFromVoxels(all);
+    filled.fillBox(glm::uvec3(0u), glm::uvec3((1u << kDepth) - 1), kColors[0]);
+    CHECK(voxtest::sameVoxels(full, filled));
+}
+
+} // namespace
+
+int main() {
+    testMatchesSetVoxel();
+    testPaletteIndices();
+    testThreadedBuildIsIdentical();
+    testEmptyAndFullBuilds();
+    return voxtest::finish("OctreeBuildTest");
+}
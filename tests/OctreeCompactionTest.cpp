@@ -0,0 +1,121 @@
+// Node-array compaction (compactNodes, relayoutNodes) after collapses and edits
+#include "TestSupport.h"
+#include <random>
+#include <vector>
+
+using namespace vox;
+
+namespace {
+
+constexpr uint32_t kDepth = 7;
+
+// Solid aligned boxes (which collapse) with scattered voxels around them
+std::vector<Voxel> sceneVoxels() {
+    std::vector<Voxel> voxels;
+    auto box = [&](glm::uvec3 lo, uint32_t size, uint32_t color) {
+        for (uint32_t z = 0; z < size; ++z)
+            for (uint32_t y = 0; y < size; ++y)
+                for (uint32_t x = 0; x < size; ++x) voxels.push_back({lo + glm::uvec3(x, y, z), color});
+    };
+    box(glm::uvec3(0u), 32, 0x00FF0000u);
+    box(glm::uvec3(64, 0, 32), 16, 0x0000FF00u);
+    box(glm::uvec3(96, 96, 96), 32, 0x000000FFu);
+    std::mt19937 rng(5);
+    std::uniform_int_distribution<uint32_t> coord(0, (1u << kDepth) - 1);
+    for (int i = 0; i < 3000; ++i) voxels.push_back({glm::uvec3(coord(rng), coord(rng), coord(rng)), 0x00808080u});
+    return voxels;
+}
+
+void testCompactAfterCollapse() {
+    const std::vector<Voxel> voxels = sceneVoxels();
+    SparseVoxelOctree reference(kDepth), tree(kDepth);
+    reference.buildFromVoxels(voxels);
+    tree.buildFromVoxels(voxels);
+
+    tree.markHomogeneousNodes();
+    const OctreeStats collapsed = tree.computeStats();
+    CHECK(collapsed.orphanedNodes > 0);
+
+    const size_t oldCount = tree.getNodes().size();
+    const size_t saved = tree.compactNodes();
+    CHECK(saved == (oldCount - tree.getNodes().size()) * sizeof(OctreeNode));
+    const OctreeStats compacted = tree.computeStats();
+    CHECK(compacted.orphanedNodes == 0);
+    CHECK(compacted.totalNodes == collapsed.reachableNodes);
+    CHECK(voxtest::sameVoxels(reference, tree));
+    CHECK(tree.compactNodes() == 0); // nothing left to drop
+}
+
+void testLodColorsFollowNodes() {
+    SparseVoxelOctree tree(kDepth);
+    tree.buildFromVoxels(sceneVoxels());
+    tree.computeLodColors();
+    tree.markHomogeneousNodes();
+    tree.compactNodes();
+    const std::vector<uint32_t> moved = tree.getLodColors();
+    CHECK(moved.size() == tree.getNodes().size());
+    tree.computeLodColors();
+    CHECK(moved == tree.getLodColors());
+}
+
+void testRelayoutOrders() {
+    const std::vector<Voxel> voxels = sceneVoxels();
+    SparseVoxelOctree reference(kDepth);
+    reference.buildFromVoxels(voxels);
+    for (NodeOrder order : {NodeOrder::DepthFirst, NodeOrder::VanEmdeBoas, NodeOrder::BreadthFirst}) {
+        SparseVoxelOctree tree(kDepth);
+        tree.buildFromVoxels(voxels);
+        tree.markHomogeneousNodes();
+        const uint64_t reachable = tree.computeStats().reachableNodes;
+        tree.relayoutNodes(order);
+        CHECK(tree.getNodeOrder() == order);
+        CHECK(tree.getNodes().size() == reachable);
+        CHECK(tree.computeStats().orphanedNodes == 0);
+        CHECK(voxtest::sameVoxels(reference, tree));
+    }
+}
+
+void testCompactAfterEdits() {
+    const std::vector<Voxel> voxels = sceneVoxels();
+    SparseVoxelOctree reference(kDepth), tree(kDepth);
+    reference.buildFromVoxels(voxels);
+    tree.buildFromVoxels(voxels);
+
+    // Clearing a whole box leaves its subtrees unreachable
+    for (SparseVoxelOctree* t : {&reference, &tree}) {
+        t->clearBox(glm::uvec3(0u), glm::uvec3(63u));
+        t->fillBox(glm::uvec3(70, 70, 70), glm::uvec3(90, 80, 75), 0x00FFFF00u);
+    }
+    CHECK(tree.computeStats().orphanedNodes > 0);
+    tree.compactNodes();
+    CHECK(tree.computeStats().orphanedNodes == 0);
+    CHECK(voxtest::sameVoxels(reference, tree));
+}
+
+void testCompactMergedSubtrees() {
+    // Repeated identical blocks merge into shared ones, which compaction keeps
+    std::vector<Voxel> voxels;
+    for (uint32_t i = 0; i < 8; ++i) {
+        const glm::uvec3 base(16 * i, 32, 48);
+        for (uint32_t k = 0; k < 8; ++k) voxels.push_back({base + glm::uvec3(k, 2 * (k % 3), k / 2), 0x00FF00FFu});
+    }
+    SparseVoxelOctree reference(kDepth), tree(kDepth);
+    reference.buildFromVoxels(voxels);
+    tree.buildFromVoxels(voxels);
+    tree.mergeIdenticalSubtrees();
+    tree.compactNodes();
+    CHECK(tree.computeStats().sharedBlocks > 0);
+    CHECK(tree.getNodes().size() < reference.getNodes().size());
+    CHECK(voxtest::sameVoxels(reference, tree));
+}
+
+} // namespace
+
+int main() {
+    testCompactAfterCollapse();
+    testLodColorsFollowNodes();
+    testRelayoutOrders();
+    testCompactAfterEdits();
+    testCompactMergedSubtrees();
+    return voxtest::finish("OctreeCompactionTest");
+}
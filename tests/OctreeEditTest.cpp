@@ -0,0 +1,180 @@
+// Voxel edits and the dirty ranges an upload relies on
+#include "TestSupport.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace vox;
+
+namespace {
+
+constexpr uint32_t kDepth = 7;
+constexpr uint32_t kCells = 1u << (kDepth - 1); // leaf cells per axis
+
+// Leaf cell colors edited alongside the tree (0 = empty)
+struct ReferenceGrid {
+    std::vector<uint32_t> cells = std::vector<uint32_t>(static_cast<size_t>(kCells) * kCells * kCells, 0u);
+    bool fill(glm::uvec3 lo, glm::uvec3 hi, uint32_t color) { // true if a cell changed
+        bool changed = false;
+        for (uint32_t z = lo.z / 2; z <= hi.z / 2; ++z)
+            for (uint32_t y = lo.y / 2; y <= hi.y / 2; ++y)
+                for (uint32_t x = lo.x / 2; x <= hi.x / 2; ++x) {
+                    uint32_t& cell = cells[(static_cast<size_t>(z) * kCells + y) * kCells + x];
+                    changed = changed || cell != color;
+                    cell = color;
+                }
+        return changed;
+    }
+    bool matches(const SparseVoxelOctree& tree) const {
+        for (uint32_t z = 0; z < kCells; ++z)
+            for (uint32_t y = 0; y < kCells; ++y)
+                for (uint32_t x = 0; x < kCells; ++x) {
+                    uint32_t color = 0;
+                    const bool solid = tree.getColor(glm::uvec3(x, y, z) * 2u, color);
+                    const uint32_t expected = cells[(static_cast<size_t>(z) * kCells + y) * kCells + x];
+                    if (solid != (expected != 0) || (solid && color != expected)) return false;
+                }
+        return true;
+    }
+};
+
+// Node words and LOD colors as an uploader keeps them: rewritten only
+// inside the ranges the tree reports
+struct Mirror {
+    std::vector<uint32_t> nodes, lod;
+    bool sync(SparseVoxelOctree& tree) {
+        const std::vector<DirtyRange> ranges = tree.takeDirtyNodeRanges();
+        nodes.resize(tree.getNodes().size());
+        lod.resize(tree.getLodColors().size());
+        size_t lastEnd = 0;
+        bool ordered = true;
+        for (size_t r = 0; r < ranges.size(); ++r) {
+            const DirtyRange& range = ranges[r];
+            ordered = ordered && range.begin < range.end && range.end <= nodes.size() && (r == 0 || range.begin > lastEnd);
+            lastEnd = range.end;
+            for (size_t i = range.begin; i < std::min(range.end, nodes.size()); ++i) {
+                nodes[i] = tree.getNodes()[i].data;
+                lod[i] = tree.getLodColors()[i];
+            }
+        }
+        return ordered;
+    }
+    bool matches(const SparseVoxelOctree& tree) const {
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            if (nodes[i] != tree.getNodes()[i].data || lod[i] != tree.getLodColors()[i]) return false;
+        }
+        return true;
+    }
+};
+
+void testRandomEditsStayInDirtyRanges() {
+    SparseVoxelOctree tree(kDepth);
+    ReferenceGrid reference;
+    std::mt19937 rng(9);
+    std::uniform_int_distribution<uint32_t> coord(0, (1u << kDepth) - 1), span(0, 12), color(1, 0xFFFFFFu), op(0, 3);
+    std::vector<Voxel> voxels;
+    for (int i = 0; i < 4000; ++i) {
+        const glm::uvec3 pos(coord(rng), coord(rng), coord(rng));
+        const uint32_t c = color(rng);
+        voxels.push_back({pos, c});
+        reference.fill(pos, pos, c);
+    }
+    tree.buildFromVoxels(voxels);
+    tree.computeLodColors();
+
+    Mirror mirror;
+    CHECK(mirror.sync(tree)); // a build marks everything
+    CHECK(mirror.matches(tree));
+    for (int step = 0; step < 200; ++step) {
+        const glm::uvec3 lo(coord(rng), coord(rng), coord(rng));
+        const glm::uvec3 hi = glm::min(lo + glm::uvec3(span(rng), span(rng), span(rng)), glm::uvec3((1u << kDepth) - 1));
+        const uint32_t c = color(rng);
+        bool changed = false;
+        switch (op(rng)) {
+        case 0: tree.setVoxel(lo, c); changed = reference.fill(lo, lo, c); break;
+        case 1: tree.clearVoxel(lo); changed = reference.fill(lo, lo, 0u); break;
+        case 2: tree.fillBox(lo, hi, c); changed = reference.fill(lo, hi, c); break;
+        default: tree.clearBox(lo, hi); changed = reference.fill(lo, hi, 0u); break;
+        }
+        CHECK(tree.hasDirtyNodes() || !changed);
+        CHECK(mirror.sync(tree));
+        CHECK(mirror.matches(tree));
+        CHECK(!tree.hasDirtyNodes());
+    }
+    CHECK(reference.matches(tree));
+}
+
+void testSingleEditIsLocal() {
+    SparseVoxelOctree tree(kDepth);
+    std::mt19937 rng(4);
+    std::uniform_int_distribution<uint32_t> coord(0, (1u << kDepth) - 1);
+    std::vector<Voxel> voxels;
+    for (int i = 0; i < 30000; ++i) voxels.push_back({glm::uvec3(coord(rng), coord(rng), coord(rng)), 0x00AABBCCu});
+    tree.buildFromVoxels(voxels);
+    tree.computeLodColors();
+    tree.takeDirtyNodeRanges();
+    tree.setVoxel(glm::uvec3(5, 70, 33), 0x00123456u);
+    size_t dirty = 0;
+    for (const DirtyRange& range : tree.takeDirtyNodeRanges()) dirty += range.end - range.begin;
+    // One node per level along the path, plus the blocks the edit appended
+    CHECK(dirty > 0);
+    CHECK(dirty <= (kDepth + 2) * SparseVoxelOctree::kDirtyPageNodes);
+    CHECK(dirty < tree.getNodes().size());
+}
+
+void testPaletteAndLights() {
+    SparseVoxelOctree tree(kDepth);
+    tree.fillBox(glm::uvec3(0u), glm::uvec3(7u), 0x00FF0000u);
+    tree.takeDirtyColorsBegin();
+    tree.takeEmissiveDirty();
+
+    tree.setVoxel(glm::uvec3(20u), 0x00FF0000u); // known color
+    CHECK(tree.takeDirtyColorsBegin() == tree.getColors().size());
+    const size_t before = tree.getColors().size();
+    tree.setVoxel(glm::uvec3(22u), 0x0000FF00u);
+    CHECK(tree.takeDirtyColorsBegin() == before);
+    CHECK(tree.getColors().size() == before + 1);
+
+    // An emissive fill lights the shell of its box; clearing the box removes them
+    tree.fillBox(glm::uvec3(40u), glm::uvec3(49u), 0xFFFFFFFFu);
+    CHECK(tree.takeEmissiveDirty());
+    CHECK(!tree.takeEmissiveDirty());
+    const size_t lights = tree.getEmissiveVoxels().size();
+    CHECK(lights > 0 && lights <= SparseVoxelOctree::kMaxEditLights);
+    tree.clearBox(glm::uvec3(40u), glm::uvec3(49u));
+    CHECK(tree.takeEmissiveDirty());
+    CHECK(tree.getEmissiveVoxels().empty());
+    CHECK(tree.takeDirtyFarBegin() == tree.getFarPointers().size());
+}
+
+void testSharedBlocksAreCopiedOnWrite() {
+    // Two identical blocks merged into one: editing one copy leaves the other
+    SparseVoxelOctree tree(kDepth);
+    ReferenceGrid reference;
+    for (uint32_t base : {0u, 64u}) {
+        tree.fillBox(glm::uvec3(base + 2, 4, 4), glm::uvec3(base + 9, 11, 5), 0x00336699u);
+        reference.fill(glm::uvec3(base + 2, 4, 4), glm::uvec3(base + 9, 11, 5), 0x00336699u);
+    }
+    tree.mergeIdenticalSubtrees();
+    tree.compactNodes();
+    CHECK(tree.computeStats().sharedBlocks > 0);
+    tree.computeLodColors();
+    Mirror mirror;
+    mirror.sync(tree);
+
+    tree.clearVoxel(glm::uvec3(70, 4, 4));
+    reference.fill(glm::uvec3(70, 4, 4), glm::uvec3(70, 4, 4), 0u);
+    CHECK(reference.matches(tree));
+    CHECK(mirror.sync(tree));
+    CHECK(mirror.matches(tree));
+}
+
+} // namespace
+
+int main() {
+    testRandomEditsStayInDirtyRanges();
+    testSingleEditIsLocal();
+    testPaletteAndLights();
+    testSharedBlocksAreCopiedOnWrite();
+    return voxtest::finish("OctreeEditTest");
+}
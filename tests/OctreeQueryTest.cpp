@@ -0,0 +1,177 @@
+// CPU point and ray queries against a dense reference grid
+#include "TestSupport.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+using namespace vox;
+
+namespace {
+
+constexpr uint32_t kDepth = 7;
+constexpr uint32_t kSize = 1u << kDepth;
+constexpr uint32_t kCells = kSize / 2; // leaf cells per axis
+
+struct Scene {
+    SparseVoxelOctree tree{kDepth};
+    std::vector<uint32_t> cells = std::vector<uint32_t>(static_cast<size_t>(kCells) * kCells * kCells, 0u);
+
+    uint32_t cellColor(glm::uvec3 voxel) const {
+        const glm::uvec3 c = voxel / 2u;
+        return cells[(static_cast<size_t>(c.z) * kCells + c.y) * kCells + c.x];
+    }
+};
+
+// Sparse clusters, so rays cross long empty stretches between hits
+Scene makeScene() {
+    Scene scene;
+    std::mt19937 rng(21);
+    std::uniform_int_distribution<uint32_t> coord(0, kSize - 1), near(0, 9), color(1, 0xFFFFFFu);
+    std::vector<Voxel> voxels;
+    for (int cluster = 0; cluster < 40; ++cluster) {
+        const glm::uvec3 center(coord(rng), coord(rng), coord(rng));
+        for (int i = 0; i < 60; ++i) {
+            const glm::uvec3 pos = glm::min(center + glm::uvec3(near(rng), near(rng), near(rng)), glm::uvec3(kSize - 1));
+            voxels.push_back({pos, color(rng)});
+        }
+    }
+    scene.tree.buildFromVoxels(voxels);
+    for (const Voxel& v : voxels) {
+        const glm::uvec3 c = v.pos / 2u;
+        scene.cells[(static_cast<size_t>(c.z) * kCells + c.y) * kCells + c.x] = v.color; // later voxels win
+    }
+    return scene;
+}
+
+// Voxel-by-voxel DDA with the semantics documented on RayHit
+RayHit referenceRay(const Scene& scene, glm::vec3 origin, glm::vec3 dir, float maxT) {
+    RayHit hit;
+    const float gridMax = static_cast<float>(kSize);
+    float t = 0.0f, tExit = maxT;
+    int entryAxis = -1;
+    for (int a = 0; a < 3; ++a) {
+        if (dir[a] == 0.0f) {
+            if (origin[a] < 0.0f || origin[a] >= gridMax) return hit;
+            continue;
+        }
+        const float tNear = ((dir[a] > 0.0f ? 0.0f : gridMax) - origin[a]) / dir[a];
+        const float tFar = ((dir[a] > 0.0f ? gridMax : 0.0f) - origin[a]) / dir[a];
+        if (tNear > t) {
+            t = tNear;
+            entryAxis = a;
+        }
+        tExit = std::min(tExit, tFar);
+    }
+    if (t > tExit) return hit;
+
+    glm::ivec3 voxel, normal(0);
+    for (int a = 0; a < 3; ++a) {
+        voxel[a] = static_cast<int>(std::min(std::max(std::floor(origin[a] + dir[a] * t), 0.0f), gridMax - 1.0f));
+    }
+    if (entryAxis >= 0) {
+        voxel[entryAxis] = dir[entryAxis] > 0.0f ? 0 : static_cast<int>(kSize) - 1;
+        normal[entryAxis] = dir[entryAxis] > 0.0f ? -1 : 1;
+    }
+    for (;;) {
+        if (const uint32_t color = scene.cellColor(glm::uvec3(voxel))) {
+            hit.hit = true;
+            hit.t = t;
+            hit.voxel = glm::uvec3(voxel);
+            hit.normal = normal;
+            hit.color = color;
+            return hit;
+        }
+        int axis = 0;
+        float tNext = std::numeric_limits<float>::infinity();
+        for (int a = 0; a < 3; ++a) {
+            if (dir[a] == 0.0f) continue;
+            const float plane = static_cast<float>(dir[a] > 0.0f ? voxel[a] + 1 : voxel[a]);
+            const float tPlane = (plane - origin[a]) / dir[a];
+            if (tPlane < tNext) {
+                tNext = tPlane;
+                axis = a;
+            }
+        }
+        if (tNext > maxT) return hit;
+        voxel[axis] += dir[axis] > 0.0f ? 1 : -1;
+        if (voxel[axis] < 0 || voxel[axis] >= static_cast<int>(kSize)) return hit;
+        t = tNext;
+        normal = glm::ivec3(0);
+        normal[axis] = dir[axis] > 0.0f ? -1 : 1;
+    }
+}
+
+std::vector<Ray> randomRays(uint32_t seed, size_t count) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> inside(0.0f, static_cast<float>(kSize)), around(-40.0f, kSize + 40.0f),
+        axis(-1.0f, 1.0f), length(10.0f, 400.0f);
+    std::vector<Ray> rays;
+    for (size_t i = 0; i < count; ++i) {
+        const glm::vec3 origin = i % 2 ? glm::vec3(inside(rng), inside(rng), inside(rng))
+                                       : glm::vec3(around(rng), around(rng), around(rng));
+        glm::vec3 dir(axis(rng), axis(rng), axis(rng));
+        if (i % 7 == 0) dir[i % 3] = 0.0f; // axis-parallel planes
+        rays.push_back({origin, dir, length(rng)});
+    }
+    return rays;
+}
+
+bool sameHit(const RayHit& a, const RayHit& b) {
+    if (a.hit != b.hit) return false;
+    if (!a.hit) return true;
+    return a.voxel == b.voxel && a.normal == b.normal && a.color == b.color && std::abs(a.t - b.t) <= 1e-3f * (1.0f + a.t);
+}
+
+void testPointQueries() {
+    const Scene scene = makeScene();
+    for (uint32_t z = 0; z < kSize; ++z)
+        for (uint32_t y = 0; y < kSize; ++y)
+            for (uint32_t x = 0; x < kSize; ++x) {
+                const glm::uvec3 pos(x, y, z);
+                uint32_t color = 0;
+                const bool solid = scene.tree.getColor(pos, color);
+                const uint32_t expected = scene.cellColor(pos);
+                if (!CHECK(solid == (expected != 0) && (!solid || color == expected) && scene.tree.isSolid(pos) == solid)) return;
+            }
+    uint32_t color = 0;
+    CHECK(!scene.tree.isSolid(glm::uvec3(kSize, 0, 0)) && !scene.tree.getColor(glm::uvec3(0, 0, kSize), color));
+}
+
+void testRaysMatchReference() {
+    const Scene scene = makeScene();
+    size_t hits = 0, mismatches = 0;
+    for (const Ray& ray : randomRays(2, 20000)) {
+        const RayHit expected = referenceRay(scene, ray.origin, ray.dir, ray.maxT);
+        const RayHit hit = scene.tree.raycast(ray.origin, ray.dir, ray.maxT);
+        hits += expected.hit;
+        mismatches += !sameHit(expected, hit);
+    }
+    CHECK(hits > 1000); // the scene is not trivially empty along the rays
+    CHECK(mismatches == 0);
+}
+
+void testBatchedRaysMatchSingleRays() {
+    const Scene scene = makeScene();
+    std::vector<Ray> rays = randomRays(3, 4000);
+    // Coherent fan from one corner, the case the batch is built for
+    for (int i = 0; i < 1000; ++i) {
+        rays.push_back({glm::vec3(-5.0f, 60.0f, -5.0f), glm::vec3(1.0f, 0.001f * (i - 500), 0.3f + 0.0007f * i), 500.0f});
+    }
+    const std::vector<RayHit> batched = scene.tree.raycast(rays);
+    size_t mismatches = 0;
+    for (size_t i = 0; i < rays.size(); ++i) {
+        mismatches += !sameHit(batched[i], scene.tree.raycast(rays[i].origin, rays[i].dir, rays[i].maxT));
+    }
+    CHECK(mismatches == 0);
+}
+
+} // namespace
+
+int main() {
+    testPointQueries();
+    testRaysMatchReference();
+    testBatchedRaysMatchSingleRays();
+    return voxtest::finish("OctreeQueryTest");
+}
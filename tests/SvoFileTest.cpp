@@ -0,0 +1,145 @@
+// Native .svo cache: round trip, staleness and damaged sections
+#include "TestSupport.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace vox;
+
+namespace {
+
+constexpr uint32_t kDepth = 7;
+
+// Byte offsets into the file header (SvoFileHeader in SparseVoxelOctree.cpp):
+// 24 bytes of magic, version, depth, flags and source hash, then one
+// {offset, count, checksum} entry per section
+constexpr size_t kDepthField = 8;
+constexpr size_t kNodesSection = 24;
+constexpr size_t kColorsSection = 48;
+constexpr size_t kSparseSection = 120;
+
+SparseVoxelOctree makeTree() {
+    SparseVoxelOctree tree(kDepth);
+    std::mt19937 rng(3);
+    std::uniform_int_distribution<uint32_t> coord(0, (1u << kDepth) - 1), color(0, 0xFFFFFFu);
+    std::vector<Voxel> voxels;
+    for (int i = 0; i < 5000; ++i) voxels.push_back({glm::uvec3(coord(rng), coord(rng), coord(rng)), color(rng) & 0xF0F0F0u});
+    tree.buildFromVoxels(voxels);
+    tree.fillBox(glm::uvec3(10, 10, 10), glm::uvec3(13, 13, 13), 0xFFFFFFFFu); // emissive
+    tree.computeLodColors();
+    return tree;
+}
+
+std::vector<char> readFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+void writeFile(const std::string& path, const std::vector<char>& bytes) {
+    std::ofstream(path, std::ios::binary).write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+// Copy of path with one byte flipped in the middle of a section
+std::string corruptSection(const std::string& path, size_t sectionField, const char* suffix) {
+    std::vector<char> bytes = readFile(path);
+    uint64_t offset = 0, count = 0;
+    std::memcpy(&offset, bytes.data() + sectionField, sizeof(offset));
+    std::memcpy(&count, bytes.data() + sectionField + sizeof(offset), sizeof(count));
+    const std::string damaged = path + suffix;
+    if (offset == 0 || count == 0) return damaged;
+    bytes[offset + count * 2] ^= 0x5A; // inside even for 4-byte elements
+    writeFile(damaged, bytes);
+    return damaged;
+}
+
+bool sameTree(const SparseVoxelOctree& a, const SparseVoxelOctree& b) {
+    if (a.getDepth() != b.getDepth() || a.getNodes().size() != b.getNodes().size()) return false;
+    for (size_t i = 0; i < a.getNodes().size(); ++i) {
+        if (a.getNodes()[i].data != b.getNodes()[i].data) return false;
+    }
+    return a.getColors() == b.getColors() && a.getLodColors() == b.getLodColors() &&
+           a.getEmissiveVoxels() == b.getEmissiveVoxels() && a.getFarPointers() == b.getFarPointers();
+}
+
+void testRoundTrip() {
+    const SparseVoxelOctree tree = makeTree();
+    CHECK(!tree.getEmissiveVoxels().empty());
+    CHECK(tree.saveSvoFile("roundtrip.svo", 42));
+
+    SparseVoxelOctree loaded(3);
+    CHECK(loaded.loadFromSvoFile("roundtrip.svo"));
+    CHECK(sameTree(tree, loaded));
+    CHECK(voxtest::sameVoxels(tree, loaded));
+
+    // The sparse encoding is stored and mapped back as is
+    std::vector<uint32_t> sparseLod;
+    const std::vector<uint32_t> sparse = tree.encodeSparseNodes(&sparseLod);
+    const SparseNodeSpan cached = loaded.getCachedSparseNodes();
+    CHECK(cached.count == sparse.size());
+    CHECK(cached.count && std::equal(sparse.begin(), sparse.end(), cached.nodes));
+    CHECK(cached.count && std::equal(sparseLod.begin(), sparseLod.end(), cached.lodColors));
+
+    // A dense save carries no sparse encoding
+    CHECK(tree.saveSvoFile("dense.svo", 0, NodeFormat::Dense));
+    SparseVoxelOctree dense;
+    CHECK(dense.loadFromSvoFile("dense.svo"));
+    CHECK(sameTree(tree, dense));
+    CHECK(dense.getCachedSparseNodes().count == 0);
+}
+
+void testSourceHash() {
+    SparseVoxelOctree tree;
+    CHECK(tree.loadFromSvoFile("roundtrip.svo", 42));
+    CHECK(!tree.loadFromSvoFile("roundtrip.svo", 43));
+    CHECK(tree.loadFromSvoFile("roundtrip.svo", 0)); // 0 accepts any source
+}
+
+void testDamagedFilesAreRejected() {
+    const SparseVoxelOctree original = makeTree();
+    SparseVoxelOctree tree;
+    CHECK(tree.loadFromSvoFile("roundtrip.svo"));
+
+    CHECK(!tree.loadFromSvoFile("missing.svo"));
+    CHECK(!tree.loadFromSvoFile(corruptSection("roundtrip.svo", kNodesSection, ".nodes")));
+    CHECK(!tree.loadFromSvoFile(corruptSection("roundtrip.svo", kColorsSection, ".colors")));
+
+    std::vector<char> bytes = readFile("roundtrip.svo");
+    bytes[kDepthField] ^= 1;
+    writeFile("roundtrip.svo.header", bytes);
+    CHECK(!tree.loadFromSvoFile("roundtrip.svo.header"));
+
+    bytes = readFile("roundtrip.svo");
+    bytes.resize(bytes.size() - 100);
+    writeFile("roundtrip.svo.short", bytes);
+    CHECK(!tree.loadFromSvoFile("roundtrip.svo.short"));
+
+    // Failed loads leave the tree as it was
+    CHECK(sameTree(original, tree));
+}
+
+void testDamagedSparseEncodingIsDropped() {
+    const SparseVoxelOctree original = makeTree();
+    SparseVoxelOctree tree;
+    CHECK(tree.loadFromSvoFile(corruptSection("roundtrip.svo", kSparseSection, ".sparse")));
+    CHECK(tree.getCachedSparseNodes().count == 0);
+    CHECK(sameTree(original, tree));
+}
+
+} // namespace
+
+int main() {
+    testRoundTrip();
+    testSourceHash();
+    testDamagedFilesAreRejected();
+    testDamagedSparseEncodingIsDropped();
+    for (const char* path : {"roundtrip.svo", "dense.svo", "roundtrip.svo.nodes", "roundtrip.svo.colors",
+                             "roundtrip.svo.header", "roundtrip.svo.short", "roundtrip.svo.sparse"}) {
+        std::remove(path);
+    }
+    return voxtest::finish("SvoFileTest");
+}
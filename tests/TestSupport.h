@@ -0,0 +1,56 @@
+#pragma once
+
+#include "vox/SparseVoxelOctree.h"
+#include <cstdint>
+#include <iostream>
+
+// Checks for the vox_core tests (no framework): a failed CHECK prints its
+// expression and location, and the test exits non-zero once its cases ran.
+namespace voxtest {
+
+inline int& failureCount() {
+    static int count = 0;
+    return count;
+}
+
+inline bool check(bool ok, const char* expr, const char* file, int line) {
+    if (!ok) {
+        std::cerr << file << ":" << line << ": CHECK failed: " << expr << std::endl;
+        failureCount()++;
+    }
+    return ok;
+}
+
+// Exit code for main()
+inline int finish(const char* test) {
+    if (failureCount() == 0) {
+        std::cout << test << ": all checks passed" << std::endl;
+        return 0;
+    }
+    std::cerr << test << ": " << failureCount() << " checks failed" << std::endl;
+    return 1;
+}
+
+// Whether both trees (of one depth) hold the same color in every leaf cell
+inline bool sameVoxels(const vox::SparseVoxelOctree& a, const vox::SparseVoxelOctree& b) {
+    if (a.getDepth() != b.getDepth()) return false;
+    const uint32_t size = 1u << a.getDepth();
+    for (uint32_t z = 0; z < size; z += 2) {
+        for (uint32_t y = 0; y < size; y += 2) {
+            for (uint32_t x = 0; x < size; x += 2) {
+                uint32_t ca = 0, cb = 0;
+                const bool sa = a.getColor(glm::uvec3(x, y, z), ca);
+                const bool sb = b.getColor(glm::uvec3(x, y, z), cb);
+                if (sa != sb || ca != cb) {
+                    std::cerr << "  leaf cell " << x << "," << y << "," << z << " differs" << std::endl;
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace voxtest
+
+#define CHECK(expr) voxtest::check(static_cast<bool>(expr), #expr, __FILE__, __LINE__)